@@ -218,3 +218,168 @@ void draw_ufunc_object(ivl_expr_t expr)
 
       draw_ufunc_epilogue(expr);
 }
+
+/*
+ * These functions test whether a function is pure in the sense that
+ * the run time may call it at any time that no other thread is
+ * running without the difference being visible. That is, the function
+ * reads only its arguments and its own variables, writes only its own
+ * variables, and does nothing else that can be seen from outside. It
+ * may call other functions that are pure in the same sense. Anything
+ * that is not understood here is taken to be impure.
+ */
+static int scope_is_within(ivl_scope_t scope, ivl_scope_t def)
+{
+      while (scope) {
+	    if (scope == def)
+		  return 1;
+	    scope = ivl_scope_parent(scope);
+      }
+      return 0;
+}
+
+static int func_def_is_pure_(ivl_scope_t def, unsigned depth);
+
+static int expr_is_pure(ivl_expr_t expr, ivl_scope_t def, unsigned depth)
+{
+      unsigned idx;
+
+      if (expr == 0)
+	    return 1;
+
+      switch (ivl_expr_type(expr)) {
+	  case IVL_EX_NUMBER:
+	  case IVL_EX_REALNUM:
+	  case IVL_EX_STRING:
+	  case IVL_EX_ULONG:
+	    return 1;
+
+	  case IVL_EX_SIGNAL:
+	    if (! scope_is_within(ivl_signal_scope(ivl_expr_signal(expr)), def))
+		  return 0;
+	    return expr_is_pure(ivl_expr_oper1(expr), def, depth);
+
+	  case IVL_EX_SELECT:
+	  case IVL_EX_BINARY:
+	    return expr_is_pure(ivl_expr_oper1(expr), def, depth)
+		  && expr_is_pure(ivl_expr_oper2(expr), def, depth);
+
+	  case IVL_EX_UNARY:
+	    return expr_is_pure(ivl_expr_oper1(expr), def, depth);
+
+	  case IVL_EX_TERNARY:
+	    return expr_is_pure(ivl_expr_oper1(expr), def, depth)
+		  && expr_is_pure(ivl_expr_oper2(expr), def, depth)
+		  && expr_is_pure(ivl_expr_oper3(expr), def, depth);
+
+	  case IVL_EX_CONCAT:
+	    for (idx = 0 ; idx < ivl_expr_parms(expr) ; idx += 1) {
+		  if (! expr_is_pure(ivl_expr_parm(expr, idx), def, depth))
+			return 0;
+	    }
+	    return 1;
+
+	  case IVL_EX_UFUNC:
+	    for (idx = 0 ; idx < ivl_expr_parms(expr) ; idx += 1) {
+		  if (! expr_is_pure(ivl_expr_parm(expr, idx), def, depth))
+			return 0;
+	    }
+	    return func_def_is_pure_(ivl_expr_def(expr), depth+1);
+
+	  default:
+	    return 0;
+      }
+}
+
+static int lval_is_pure(ivl_lval_t lval, ivl_scope_t def, unsigned depth)
+{
+      ivl_signal_t sig = ivl_lval_sig(lval);
+
+	/* Nested l-values are class properties. */
+      if (sig == 0 || ivl_lval_property_idx(lval) >= 0)
+	    return 0;
+      if (! scope_is_within(ivl_signal_scope(sig), def))
+	    return 0;
+
+      return expr_is_pure(ivl_lval_idx(lval), def, depth)
+	    && expr_is_pure(ivl_lval_part_off(lval), def, depth);
+}
+
+static int stmt_is_pure(ivl_statement_t net, ivl_scope_t def, unsigned depth)
+{
+      unsigned idx;
+
+      if (net == 0)
+	    return 1;
+
+      switch (ivl_statement_type(net)) {
+	  case IVL_ST_NOOP:
+	  case IVL_ST_ALLOC:
+	  case IVL_ST_FREE:
+	    return 1;
+
+	  case IVL_ST_ASSIGN:
+	    if (ivl_stmt_delay_expr(net))
+		  return 0;
+	    for (idx = 0 ; idx < ivl_stmt_lvals(net) ; idx += 1) {
+		  if (! lval_is_pure(ivl_stmt_lval(net, idx), def, depth))
+			return 0;
+	    }
+	    return expr_is_pure(ivl_stmt_rval(net), def, depth);
+
+	  case IVL_ST_BLOCK:
+	    for (idx = 0 ; idx < ivl_stmt_block_count(net) ; idx += 1) {
+		  if (! stmt_is_pure(ivl_stmt_block_stmt(net, idx), def, depth))
+			return 0;
+	    }
+	    return 1;
+
+	  case IVL_ST_CASE:
+	  case IVL_ST_CASEX:
+	  case IVL_ST_CASEZ:
+	  case IVL_ST_CASER:
+	    if (! expr_is_pure(ivl_stmt_cond_expr(net), def, depth))
+		  return 0;
+	    for (idx = 0 ; idx < ivl_stmt_case_count(net) ; idx += 1) {
+		  if (! expr_is_pure(ivl_stmt_case_expr(net, idx), def, depth))
+			return 0;
+		  if (! stmt_is_pure(ivl_stmt_case_stmt(net, idx), def, depth))
+			return 0;
+	    }
+	    return 1;
+
+	  case IVL_ST_CONDIT:
+	    return expr_is_pure(ivl_stmt_cond_expr(net), def, depth)
+		  && stmt_is_pure(ivl_stmt_cond_true(net), def, depth)
+		  && stmt_is_pure(ivl_stmt_cond_false(net), def, depth);
+
+	  case IVL_ST_DISABLE:
+	    return scope_is_within(ivl_stmt_call(net), def);
+
+	  case IVL_ST_DO_WHILE:
+	  case IVL_ST_REPEAT:
+	  case IVL_ST_WHILE:
+	    return expr_is_pure(ivl_stmt_cond_expr(net), def, depth)
+		  && stmt_is_pure(ivl_stmt_sub_stmt(net), def, depth);
+
+	  case IVL_ST_FOREVER:
+	    return stmt_is_pure(ivl_stmt_sub_stmt(net), def, depth);
+
+	  default:
+	    return 0;
+      }
+}
+
+static int func_def_is_pure_(ivl_scope_t def, unsigned depth)
+{
+	/* Give up on deeply nested (or recursive) function calls. */
+      if (depth > 8)
+	    return 0;
+
+      return stmt_is_pure(ivl_scope_def(def), def, depth);
+}
+
+int func_def_is_pure(ivl_scope_t def)
+{
+      return func_def_is_pure_(def, 0);
+}
@@ -112,6 +112,14 @@ extern void draw_ufunc_real(ivl_expr_t expr);
 extern void draw_ufunc_string(ivl_expr_t expr);
 extern void draw_ufunc_object(ivl_expr_t expr);
 
+/*
+ * Return true if the function reads only its arguments and its own
+ * variables, and writes only its own variables. A .ufunc of such a
+ * function is drawn as .ufunc/i so that the run time may evaluate it
+ * without scheduling a thread.
+ */
+extern int func_def_is_pure(ivl_scope_t def);
+
 extern char* process_octal_codes(const char*txt, unsigned wid);
 
 /*
@@ -640,6 +640,74 @@ static int show_stmt_block_named(ivl_statement_t net, ivl_scope_t scope)
 }
 
 
+/*
+ * If all the guards of a case statement are constants that are the
+ * width of the case expression, then the branch table can be drawn as
+ * a single %case/vec4 (or %casex/vec4 or %casez/vec4) instruction,
+ * which vvp turns into a lookup table.
+ */
+static int case_stmt_is_table(ivl_statement_t net, ivl_expr_t expr)
+{
+      unsigned count = ivl_stmt_case_count(net);
+      unsigned items = 0;
+      unsigned idx;
+
+      for (idx = 0 ;  idx < count ;  idx += 1) {
+	    ivl_expr_t cex = ivl_stmt_case_expr(net, idx);
+
+	    if (cex == 0)
+		  continue;
+	    if (ivl_expr_type(cex) != IVL_EX_NUMBER)
+		  return 0;
+	    if (ivl_expr_width(cex) != ivl_expr_width(expr))
+		  return 0;
+
+	    items += 1;
+      }
+
+      return items > 0;
+}
+
+static void draw_case_table(ivl_statement_t net, unsigned local_base,
+			    unsigned default_label)
+{
+      unsigned count = ivl_stmt_case_count(net);
+      const char*opcode = "%case/vec4";
+      unsigned idx;
+
+      switch (ivl_statement_type(net)) {
+	  case IVL_ST_CASE:
+	    break;
+	  case IVL_ST_CASEX:
+	    opcode = "%casex/vec4";
+	    break;
+	  case IVL_ST_CASEZ:
+	    opcode = "%casez/vec4";
+	    break;
+	  default:
+	    assert(0);
+      }
+
+      fprintf(vvp_out, "    %s T_%u.%u", opcode, thread_count, default_label);
+
+      for (idx = 0 ;  idx < count ;  idx += 1) {
+	    ivl_expr_t cex = ivl_stmt_case_expr(net, idx);
+	    const char*bits;
+	    unsigned bdx;
+
+	    if (cex == 0)
+		  continue;
+
+	    bits = ivl_expr_bits(cex);
+	    fprintf(vvp_out, ", C4<");
+	    for (bdx = ivl_expr_width(cex) ;  bdx > 0 ;  bdx -= 1)
+		  fputc(bits[bdx-1], vvp_out);
+	    fprintf(vvp_out, ">, T_%u.%u", thread_count, local_base+idx);
+      }
+
+      fprintf(vvp_out, ";\n");
+}
+
 static int show_stmt_case(ivl_statement_t net, ivl_scope_t sscope)
 {
       int rc = 0;
@@ -649,6 +717,7 @@ static int show_stmt_case(ivl_statement_t net, ivl_scope_t sscope)
       unsigned local_base = local_count;
 
       unsigned idx, default_case;
+      int use_table = case_stmt_is_table(net, expr);
 
       show_stmt_file_line(net, "Case statement.");
 
@@ -659,18 +728,43 @@ static int show_stmt_case(ivl_statement_t net, ivl_scope_t sscope)
 	   each case guard. */
       draw_eval_vec4(expr);
 
+      default_case = count;
+      for (idx = 0 ;  idx < count ;  idx += 1) {
+	    if (ivl_stmt_case_expr(net, idx) == 0)
+		  default_case = idx;
+      }
+
+	/* If the guards are all constants, then the whole branch
+	   table is one instruction. It pops the case expression and
+	   branches to the first matching item, or to the default. The
+	   item statements are drawn below, same as for the compare
+	   chain, with the default as just another labeled item. */
+      if (use_table) {
+	    draw_case_table(net, local_base, local_base+default_case);
+
+	    for (idx = 0 ;  idx < count ;  idx += 1) {
+		  ivl_statement_t cst = ivl_stmt_case_stmt(net, idx);
+
+		  fprintf(vvp_out, "T_%u.%u ;\n", thread_count,
+			  local_base+idx);
+		  rc += show_statement(cst, sscope);
+
+		  fprintf(vvp_out, "    %%jmp T_%u.%u;\n", thread_count,
+			  local_base+count);
+	    }
+
+	    fprintf(vvp_out, "T_%u.%u ;\n",  thread_count, local_base+count);
+	    return rc;
+      }
+
 	/* First draw the branch table.  All the non-default cases
 	   generate a branch out of here, to the code that implements
 	   the case. The default will fall through all the tests. */
-      default_case = count;
-
       for (idx = 0 ;  idx < count ;  idx += 1) {
 	    ivl_expr_t cex = ivl_stmt_case_expr(net, idx);
 
-	    if (cex == 0) {
-		  default_case = idx;
+	    if (cex == 0)
 		  continue;
-	    }
 
 	      /* Duplicate the case expression so that the cmp
 		 instructions below do not completely erase the
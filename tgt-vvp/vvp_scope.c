@@ -1926,7 +1926,8 @@ static void draw_lpm_ufunc(ivl_lpm_t net)
                     vvp_mangle_id(ivl_scope_name(def)),
                     ivl_lpm_width(net), ivl_lpm_trigger(net));
       else
-            fprintf(vvp_out, "L_%p%s .ufunc TD_%s, %u", net, dly,
+            fprintf(vvp_out, "L_%p%s .ufunc%s TD_%s, %u", net, dly,
+                    func_def_is_pure(def)? "/i" : "",
                     vvp_mangle_id(ivl_scope_name(def)),
                     ivl_lpm_width(net));
 
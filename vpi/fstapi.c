@@ -43,7 +43,11 @@
 #include "fastlz.h"
 #include "lz4.h"
 
-#ifndef HAVE_LIBPTHREAD
+#ifdef HAVE_LIBPTHREAD
+#ifndef FST_WRITER_PARALLEL
+#define FST_WRITER_PARALLEL
+#endif
+#else
 #undef FST_WRITER_PARALLEL
 #endif
 
@@ -766,10 +770,13 @@ unsigned char already_in_flush; /* in case control-c handlers interrupt */
 unsigned char already_in_close; /* in case control-c handlers interrupt */
 
 #ifdef FST_WRITER_PARALLEL
-pthread_mutex_t mutex;
 pthread_t thread;
-pthread_attr_t thread_attr;
 struct fstWriterContext *xc_parent;
+unsigned char in_pthread;               /* a writer thread owns the previous section */
+
+/* written by the writer thread, applied by the parent when it joins the thread */
+unsigned char pthread_section_header_only;
+unsigned char pthread_size_limit_locked;
 #endif
 
 size_t fst_orig_break_size;
@@ -1138,11 +1145,6 @@ if((!nam)||
 
                 fstWriterEmitHdrBytes(xc);
                 xc->nan = strtod("NaN", NULL);
-#ifdef FST_WRITER_PARALLEL
-                pthread_mutex_init(&xc->mutex, NULL);
-                pthread_attr_init(&xc->thread_attr);
-                pthread_attr_setdetachstate(&xc->thread_attr, PTHREAD_CREATE_DETACHED);
-#endif
                 }
                 else
                 {
@@ -1733,16 +1735,17 @@ if(xc->dump_size_limit)
         {
         if(endpos >= ((off_t)xc->dump_size_limit))
                 {
-                xc2->skip_writing_section_hdr = 1;
-                xc2->size_limit_locked = 1;
-                xc2->is_initial_time = 1; /* to trick emit value and emit time change */
+                /* in a writer thread these go to the copy and are passed back to the parent on join */
+                xc->skip_writing_section_hdr = 1;
+                xc->size_limit_locked = 1;
+                xc->is_initial_time = 1; /* to trick emit value and emit time change */
 #ifdef FST_DEBUG
                 fprintf(stderr, "<< dump file size limit reached, stopping dumping >>\n");
 #endif
                 }
         }
 
-if(!xc2->skip_writing_section_hdr)
+if(!xc->skip_writing_section_hdr)
         {
         fstWriterEmitSectionHeader(xc);                         /* emit next section header */
         }
@@ -1759,7 +1762,9 @@ struct fstWriterContext *xc = (struct fstWriterContext *)ctx;
 
 fstWriterFlushContextPrivate2(xc);
 
-pthread_mutex_unlock(&(xc->xc_parent->mutex));
+/* the parent does not look at these until it has joined this thread */
+xc->xc_parent->pthread_section_header_only = xc->section_header_only;
+xc->xc_parent->pthread_size_limit_locked = xc->size_limit_locked;
 
 #ifdef FST_REMOVE_DUPLICATE_VC
 free(xc->curval_mem);
@@ -1773,18 +1778,51 @@ return(NULL);
 }
 
 
+/*
+ * Wait for the writer thread (if any) to finish the section it was
+ * given, then take back the state that it changed. Only one section
+ * is ever in flight: the simulation fills the next section while the
+ * thread compresses and writes the previous one, and the next flush
+ * blocks here until the thread is done. That bounds the memory to two
+ * sections and makes a slow disk hold back the simulation instead of
+ * queueing unwritten sections without limit.
+ */
+static void fstWriterFlushResults(struct fstWriterContext *xc)
+{
+xc->section_header_only = xc->pthread_section_header_only;
+if(xc->pthread_size_limit_locked)
+        {
+        xc->skip_writing_section_hdr = 1;
+        xc->size_limit_locked = 1;
+        xc->is_initial_time = 1; /* to trick emit value and emit time change */
+        }
+}
+
+static void fstWriterJoinFlush(struct fstWriterContext *xc)
+{
+if(xc->in_pthread)
+        {
+        pthread_join(xc->thread, NULL);
+        xc->in_pthread = 0;
+        fstWriterFlushResults(xc);
+        }
+}
+
+
 static void fstWriterFlushContextPrivate(void *ctx)
 {
 struct fstWriterContext *xc = (struct fstWriterContext *)ctx;
 
+fstWriterJoinFlush(xc);
+
 if(xc->parallel_enabled)
         {
-        struct fstWriterContext *xc2 = malloc(sizeof(struct fstWriterContext));
+        struct fstWriterContext *xc2;
         unsigned int i;
 
-        pthread_mutex_lock(&xc->mutex);
-        pthread_mutex_unlock(&xc->mutex);
+        if((xc->vchg_siz <= 1) || (xc->size_limit_locked)) return;
 
+        xc2 = malloc(sizeof(struct fstWriterContext));
         xc->xc_parent = xc;
         memcpy(xc2, xc, sizeof(struct fstWriterContext));
 
@@ -1816,18 +1854,18 @@ if(xc->parallel_enabled)
         xc->section_header_only = 0;
         xc->secnum++;
 
-        pthread_mutex_lock(&xc->mutex);
-
-        pthread_create(&xc->thread, &xc->thread_attr, fstWriterFlushContextPrivate1, xc2);
+        if(pthread_create(&xc->thread, NULL, fstWriterFlushContextPrivate1, xc2) == 0)
+                {
+                xc->in_pthread = 1;
+                }
+                else
+                {
+                fstWriterFlushContextPrivate1(xc2); /* no thread to be had, so write it in line */
+                fstWriterFlushResults(xc);
+                }
         }
         else
         {
-        if(xc->parallel_was_enabled) /* conservatively block */
-                {
-                pthread_mutex_lock(&xc->mutex);
-                pthread_mutex_unlock(&xc->mutex);
-                }
-
         xc->xc_parent = xc;
         fstWriterFlushContextPrivate2(xc);
         }
@@ -1861,8 +1899,7 @@ struct fstWriterContext *xc = (struct fstWriterContext *)ctx;
 #ifdef FST_WRITER_PARALLEL
 if(xc)
         {
-        pthread_mutex_lock(&xc->mutex);
-        pthread_mutex_unlock(&xc->mutex);
+        fstWriterJoinFlush(xc);
         }
 #endif
 
@@ -1896,8 +1933,7 @@ if(xc && !xc->already_in_close && !xc->already_in_flush)
                                 }
                         fstWriterFlushContextPrivate(xc);
 #ifdef FST_WRITER_PARALLEL
-                        pthread_mutex_lock(&xc->mutex);
-                        pthread_mutex_unlock(&xc->mutex);
+                        fstWriterJoinFlush(xc);
 #endif
                         }
                 }
@@ -2171,10 +2207,6 @@ if(xc && !xc->already_in_close && !xc->already_in_flush)
         }
 #endif
 
-#ifdef FST_WRITER_PARALLEL
-        pthread_mutex_destroy(&xc->mutex);
-        pthread_attr_destroy(&xc->thread_attr);
-#endif
 
         if(xc->path_array)
                 {
@@ -2536,6 +2568,9 @@ if(xc && nam)
         {
         if(xc->valpos_mem)
                 {
+#ifdef FST_WRITER_PARALLEL
+                fstWriterJoinFlush(xc); /* the writer thread may still be checkpointing into curval_mem */
+#endif
                 fstDestroyMmaps(xc, 0);
                 }
 
@@ -2915,8 +2950,17 @@ if(xc)
                 {
                 if((xc->vchg_siz >= xc->fst_break_size) || (xc->flush_context_pending))
                         {
+#ifdef FST_WRITER_PARALLEL
+                        int flush_requested = xc->flush_context_pending;
+#endif
                         xc->flush_context_pending = 0;
                         fstWriterFlushContextPrivate(xc);
+#ifdef FST_WRITER_PARALLEL
+                        if(flush_requested) /* an explicit flush must reach the file before the caller moves on */
+                                {
+                                fstWriterJoinFlush(xc);
+                                }
+#endif
                         xc->tchn_cnt++;
                         fstWriterVarint(xc->tchn_handle, xc->curtime);
                         }
@@ -1059,6 +1059,694 @@ static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
   return rtn;
 }
 
+/*
+ * Most calls to the display tasks have constant format strings, so
+ * the compiletf routines compile the arguments of each call into a
+ * display program that is kept in the user data of the call. The
+ * program is a list of steps, one for each piece of the output:
+ * literal text from a format string, a format code and the argument
+ * it uses, or an argument that is displayed in the default format.
+ * Running the program only needs to fetch the argument values, and
+ * the output is collected in a buffer that is reused by every call.
+ *
+ * The common codes (%b, %o, %h, %d and %t) are formatted here. For
+ * the rest, and whenever something would cause a warning, the step
+ * falls back to get_format_char() or get_display(), so the output is
+ * always the same as an uncompiled call would make.
+ */
+enum display_step_kind {
+      DS_TEXT,     /* Literal text from a format string. */
+      DS_FORMAT,   /* A format code from a format string. */
+      DS_NUMERIC,  /* An argument in the default (numeric) format. */
+      DS_ITEM      /* Any other argument, done by get_display(). */
+};
+
+struct display_step {
+      enum display_step_kind kind;
+	/* The argument, or for DS_FORMAT the argument index just
+	   before the argument that the format code uses. */
+      unsigned idx;
+	/* DS_TEXT */
+      char*text;
+      unsigned text_len;
+	/* DS_FORMAT */
+      int ljust, plus, ld_zero, width, prec;
+      char fmt;
+	/* Properties of the argument for DS_FORMAT and DS_NUMERIC. */
+      int dec_size;
+      int dec_fast;  /* vpiSigned matches the vpiDecStrVal value. */
+      int is_signed;
+      int is_real;
+      PLI_INT32 vec_size;  /* The vector width, or 0 if not a vector. */
+};
+
+/* Format string arguments that the program was compiled from. These
+   are checked on each call in case the "constant" is really a string
+   expression that the run time evaluated. */
+struct display_fmt_arg {
+      vpiHandle arg;
+      char*text;
+};
+
+struct display_prog {
+      struct strobe_cb_info info;
+	/* The file descriptor/MCD or target register argument. */
+      vpiHandle lead_arg;
+      PLI_INT32 time_units;
+	/* For $sformat, the arguments that are not used. */
+      unsigned extra_args;
+      struct display_fmt_arg*fmt_args;
+      unsigned nfmt_args;
+      struct display_step*steps;
+      unsigned nsteps;
+};
+
+static struct display_prog**display_progs = 0;
+static unsigned display_progs_count = 0;
+
+/* The output of the display programs is collected here. */
+static struct {
+      char*text;
+      unsigned len;
+      unsigned size;
+} display_buf = { 0, 0, 0 };
+
+/* This is the scratch buffer for get_time(). */
+static char*display_tbuf = 0;
+static unsigned display_tbuf_size = 0;
+
+static char*display_buf_reserve(unsigned cnt)
+{
+      if (display_buf.len + cnt + 1 > display_buf.size) {
+	    display_buf.size = 2*(display_buf.len + cnt + 1);
+	    if (display_buf.size < 512) display_buf.size = 512;
+	    display_buf.text = realloc(display_buf.text, display_buf.size);
+      }
+      return display_buf.text + display_buf.len;
+}
+
+static void display_buf_append(const char*text, unsigned cnt)
+{
+      memcpy(display_buf_reserve(cnt), text, cnt);
+      display_buf.len += cnt;
+}
+
+static void display_buf_fill(char ch, unsigned cnt)
+{
+      memset(display_buf_reserve(cnt), ch, cnt);
+      display_buf.len += cnt;
+}
+
+/* Append a string right justified in the width, or left justified if
+   ljust is set, with zpad zeros in front of the string. */
+static void display_buf_justify(const char*text, unsigned zpad,
+                                int ljust, int width)
+{
+      unsigned len = strlen(text);
+      unsigned fill = 0;
+      if (width > 0 && (unsigned)width > zpad+len)
+	    fill = (unsigned)width - zpad - len;
+
+      if (! ljust) display_buf_fill(' ', fill);
+      display_buf_fill('0', zpad);
+      display_buf_append(text, len);
+      if (ljust) display_buf_fill(' ', fill);
+}
+
+static struct display_step*display_prog_add(struct display_prog*prog,
+                                            enum display_step_kind kind,
+                                            unsigned idx)
+{
+      struct display_step*step;
+      prog->steps = realloc(prog->steps,
+                            (prog->nsteps+1)*sizeof(struct display_step));
+      step = prog->steps + prog->nsteps;
+      prog->nsteps += 1;
+      memset(step, 0, sizeof(struct display_step));
+      step->kind = kind;
+      step->idx = idx;
+      return step;
+}
+
+/* Look up the properties of an argument that the fast paths need. */
+static void display_step_arg(struct display_step*step,
+                             const struct strobe_cb_info*info, unsigned idx)
+{
+      vpiHandle item;
+      PLI_INT32 type;
+
+      if (idx >= info->nitems) return;
+      item = info->items[idx];
+      type = vpi_get(vpiType, item);
+      switch (type) {
+	  case vpiConstant:
+	  case vpiParameter:
+	    switch (vpi_get(vpiConstType, item)) {
+		case vpiStringConst:
+		  return;
+		case vpiRealConst:
+		  step->is_real = 1;
+		  return;
+		default:
+		  break;
+	    }
+	    /* fall through */
+	  case vpiNet:
+	  case vpiReg:
+	  case vpiBitVar:
+	  case vpiByteVar:
+	  case vpiShortIntVar:
+	  case vpiIntVar:
+	  case vpiLongIntVar:
+	  case vpiIntegerVar:
+	  case vpiMemoryWord:
+	  case vpiPartSelect:
+	    step->vec_size = vpi_get(vpiSize, item);
+	    step->is_signed = vpi_get(vpiSigned, item) == 1;
+	    step->dec_size = calc_dec_size(step->vec_size, step->is_signed);
+	      /* Array words display as signed if the array is signed,
+		 but do not say so through vpiSigned. */
+	    step->dec_fast = type != vpiMemoryWord;
+	    break;
+	  case vpiRealVar:
+	    step->is_real = 1;
+	    break;
+	  case vpiSysFuncCall:
+	    step->is_real = vpi_get(vpiFuncType, item) == vpiRealFunc;
+	    break;
+	  default:
+	    break;
+      }
+}
+
+/* Compile a format string, following the parse in get_format(). */
+static void display_prog_format(struct display_prog*prog, const char*fmt,
+                                unsigned*idx)
+{
+      const char*cp = fmt;
+
+      while (*cp) {
+	    size_t cnt = strcspn(cp, "%");
+	    struct display_step*step;
+
+	    if (cnt > 0) {
+		  step = display_prog_add(prog, DS_TEXT, *idx);
+		  step->text = malloc(cnt+1);
+		  memcpy(step->text, cp, cnt);
+		  step->text[cnt] = 0;
+		  step->text_len = cnt;
+		  cp += cnt;
+		  continue;
+	    }
+
+	    step = display_prog_add(prog, DS_FORMAT, *idx);
+	    step->width = -1;
+	    step->prec = -1;
+	    cp += 1;
+	    while ((*cp == '-') || (*cp == '+')) {
+		  if (*cp == '-') step->ljust = 1;
+		  else step->plus = 1;
+		  cp += 1;
+	    }
+	    if (*cp == '0') {
+		  step->ld_zero = 1;
+		  cp += 1;
+	    }
+	    if (isdigit((int)*cp)) step->width = strtoul(cp, (char**)&cp, 10);
+	    if (*cp == '.') {
+		  cp += 1;
+		  step->prec = strtoul(cp, (char**)&cp, 10);
+	    }
+	    step->fmt = *cp;
+
+	      /* A plain %% is just text. */
+	    if (step->fmt == '%' && !step->ljust && !step->plus &&
+	        !step->ld_zero && step->width == -1 && step->prec == -1) {
+		  step->kind = DS_TEXT;
+		  step->text = strdup("%");
+		  step->text_len = 1;
+	    }
+
+	      /* These are the codes that get_format_char() takes an
+		 argument for. */
+	    switch (step->fmt) {
+		case '%':
+		case '\0':
+		case 'l':
+		case 'L':
+		case 'm':
+		case 'M':
+		  break;
+		default:
+		  if (strchr("bBoOhHxXcCdDeEfFgGsStTuUvVzZ", step->fmt)) {
+			*idx += 1;
+			display_step_arg(step, &prog->info, *idx);
+		  }
+		  break;
+	    }
+	    if (*cp) cp += 1;
+      }
+}
+
+/* Compile a constant format string argument. */
+static void display_prog_fmt_arg(struct display_prog*prog, vpiHandle arg,
+                                 unsigned*idx)
+{
+      struct display_fmt_arg*fmt;
+      s_vpi_value value;
+
+      value.format = vpiStringVal;
+      vpi_get_value(arg, &value);
+
+      prog->fmt_args = realloc(prog->fmt_args, (prog->nfmt_args+1)*
+                               sizeof(struct display_fmt_arg));
+      fmt = prog->fmt_args + prog->nfmt_args;
+      prog->nfmt_args += 1;
+      fmt->arg = arg;
+      fmt->text = strdup(value.value.str);
+      display_prog_format(prog, fmt->text, idx);
+}
+
+static void display_prog_free(struct display_prog*prog)
+{
+      unsigned idx;
+      for (idx = 0 ; idx < prog->nsteps ; idx += 1)
+	    free(prog->steps[idx].text);
+      for (idx = 0 ; idx < prog->nfmt_args ; idx += 1)
+	    free(prog->fmt_args[idx].text);
+      free(prog->steps);
+      free(prog->fmt_args);
+      free(prog->info.filename);
+      free(prog->info.items);
+      free(prog);
+}
+
+/*
+ * Compile the display program for the call. The argv is the argument
+ * iterator, already past any file descriptor, target register or
+ * format. The fmt is the format argument of $sformat, and if it is
+ * given the arguments are only used by its format codes. This returns
+ * nil if the arguments cannot be compiled, and the calltf must then
+ * do it the slow way every time.
+ */
+static struct display_prog*display_prog_compile(vpiHandle callh,
+                                                vpiHandle argv,
+                                                const char*name,
+                                                vpiHandle fmt)
+{
+      struct display_prog*prog = calloc(1, sizeof(struct display_prog));
+      unsigned idx;
+
+      prog->info.name = name;
+      prog->info.filename = strdup(vpi_get_str(vpiFile, callh));
+      prog->info.lineno = (int)vpi_get(vpiLineNo, callh);
+      prog->info.default_format = get_default_format(name);
+      prog->info.scope = vpi_handle(vpiScope, callh);
+      array_from_iterator(&prog->info, argv);
+      prog->time_units = vpi_get(vpiTimeUnit, prog->info.scope);
+
+      if (fmt) {
+	    PLI_INT32 type = vpi_get(vpiType, fmt);
+	    if ((type != vpiConstant && type != vpiParameter) ||
+	        vpi_get(vpiConstType, fmt) != vpiStringConst) {
+		  display_prog_free(prog);
+		  return 0;
+	    }
+	      /* As in sys_sformat_calltf(), the first format code uses
+		 the first argument. */
+	    idx = -1;
+	    display_prog_fmt_arg(prog, fmt, &idx);
+	    if (idx+1 < prog->info.nitems)
+		  prog->extra_args = prog->info.nitems - idx - 1;
+	    return prog;
+      }
+
+      for (idx = 0 ; idx < prog->info.nitems ; idx += 1) {
+	    vpiHandle item = prog->info.items[idx];
+	    struct display_step*step;
+
+	    switch (vpi_get(vpiType, item)) {
+
+		case vpiConstant:
+		case vpiParameter:
+		  switch (vpi_get(vpiConstType, item)) {
+		      case vpiStringConst:
+			display_prog_fmt_arg(prog, item, &idx);
+			break;
+		      case vpiRealConst:
+			display_prog_add(prog, DS_ITEM, idx);
+			break;
+		      default:
+			step = display_prog_add(prog, DS_NUMERIC, idx);
+			display_step_arg(step, &prog->info, idx);
+			break;
+		  }
+		  break;
+
+		case vpiNet:
+		case vpiReg:
+		case vpiBitVar:
+		case vpiByteVar:
+		case vpiShortIntVar:
+		case vpiIntVar:
+		case vpiLongIntVar:
+		case vpiIntegerVar:
+		case vpiMemoryWord:
+		case vpiPartSelect:
+		  step = display_prog_add(prog, DS_NUMERIC, idx);
+		  display_step_arg(step, &prog->info, idx);
+		  break;
+
+		  /* A string variable is a format string that can change
+		     from call to call, so there is no telling which
+		     arguments its format codes will use. */
+		case vpiStringVar:
+		  display_prog_free(prog);
+		  return 0;
+
+		default:
+		  display_prog_add(prog, DS_ITEM, idx);
+		  break;
+	    }
+      }
+
+      return prog;
+}
+
+static void display_prog_save(vpiHandle callh, struct display_prog*prog)
+{
+      vpi_put_userdata(callh, prog);
+      if (prog == 0) return;
+      display_progs = realloc(display_progs, (display_progs_count+1)*
+                              sizeof(struct display_prog*));
+      display_progs[display_progs_count] = prog;
+      display_progs_count += 1;
+}
+
+/*
+ * Get the decimal string for a vector argument of 64 bits or less
+ * without going through vpiDecStrVal. This returns 0 if the value
+ * has x or z bits, and the caller must then use vpiDecStrVal to get
+ * the proper x/z display.
+ */
+static int display_vec_dec(char*buf, vpiHandle item,
+                           const struct display_step*step)
+{
+      s_vpi_value value;
+      PLI_UINT64 bits, mask;
+      int neg = 0;
+      char tmp[24];
+      char*cp = tmp + sizeof tmp;
+
+      if (!step->dec_fast || step->vec_size <= 0 || step->vec_size > 64)
+	    return 0;
+
+      value.format = vpiVectorVal;
+      vpi_get_value(item, &value);
+      if (value.format != vpiVectorVal) return 0;
+      if (value.value.vector[0].bval) return 0;
+      bits = (PLI_UINT32)value.value.vector[0].aval;
+      if (step->vec_size > 32) {
+	    if (value.value.vector[1].bval) return 0;
+	    bits |= (PLI_UINT64)(PLI_UINT32)value.value.vector[1].aval << 32;
+      }
+
+      mask = step->vec_size == 64? ~(PLI_UINT64)0 :
+             ((PLI_UINT64)1 << step->vec_size) - 1;
+      bits &= mask;
+      if (step->is_signed && (bits >> (step->vec_size-1)) & 1) {
+	    neg = 1;
+	    bits = (~bits + 1) & mask;
+	      /* The most negative value is its own negation. */
+	    if (bits == 0) bits = (PLI_UINT64)1 << (step->vec_size-1);
+      }
+
+      *--cp = 0;
+      do {
+	    *--cp = '0' + (char)(bits % 10);
+	    bits /= 10;
+      } while (bits);
+      if (neg) *--cp = '-';
+      strcpy(buf, cp);
+      return 1;
+}
+
+/* Get the decimal string of an argument, the fast way if possible. */
+static const char*display_dec_str(char*buf, vpiHandle item,
+                                  const struct display_step*step)
+{
+      s_vpi_value value;
+
+      if (display_vec_dec(buf, item, step)) return buf;
+
+      value.format = vpiDecStrVal;
+      vpi_get_value(item, &value);
+      if (value.format == vpiSuppressVal) return 0;
+      return value.value.str;
+}
+
+/* Run get_format_char() for the step and collect its result. */
+static void display_step_slow(const struct display_step*step,
+                              const struct strobe_cb_info*info)
+{
+      char*result;
+      unsigned idx = step->idx;
+      unsigned cnt = get_format_char(&result, step->ljust, step->plus,
+                                     step->ld_zero, step->width, step->prec,
+                                     step->fmt, info, &idx);
+      display_buf_append(result, cnt);
+      free(result);
+}
+
+/* The %b, %o and %h codes. This follows get_format_char(). */
+static int display_step_vec(const struct display_step*step,
+                            const struct strobe_cb_info*info)
+{
+      s_vpi_value value;
+      const char*cp;
+      unsigned zpad = 0;
+
+      switch (step->fmt) {
+	  case 'b':
+	  case 'B':
+	    value.format = vpiBinStrVal;
+	    break;
+	  case 'o':
+	  case 'O':
+	    value.format = vpiOctStrVal;
+	    break;
+	  default:
+	    value.format = vpiHexStrVal;
+	    break;
+      }
+      vpi_get_value(info->items[step->idx+1], &value);
+      if (value.format == vpiSuppressVal) return 0;
+
+      cp = value.value.str;
+      if (step->ld_zero) {
+	    unsigned swidth = strlen(cp);
+	    if (step->width == -1 || step->ljust) {
+		  while (*cp == '0' && *(cp+1) != '\0') cp++;
+	    } else if ((signed)swidth < step->width) {
+		  zpad = (unsigned)step->width - swidth;
+	    }
+      }
+      display_buf_justify(cp, zpad, step->ljust, step->width);
+      return 1;
+}
+
+/* The %d code. This follows get_format_char(). */
+static int display_step_dec(const struct display_step*step,
+                            const struct strobe_cb_info*info)
+{
+      char buf[24];
+      const char*cp;
+      int width = step->width;
+      unsigned swidth, zpad = 0, len;
+      char sign = 0;
+
+      cp = display_dec_str(buf, info->items[step->idx+1], step);
+      if (cp == 0) return 0;
+
+      if (*cp == '-') {
+	    sign = '-';
+	    cp += 1;
+      } else if (step->plus) {
+	    sign = '+';
+      }
+      swidth = strlen(cp) + (sign? 1 : 0);
+      if (!step->ljust && step->ld_zero && (signed)swidth < width)
+	    zpad = (unsigned)width - swidth;
+
+      if (width == -1) {
+	    if (step->ld_zero) width = 0;
+	    else if (step->vec_size > 0) width = step->dec_size;
+	    else width = vpi_get_dec_size(info->items[step->idx+1]);
+      }
+
+      len = swidth + zpad;
+      if (!step->ljust && width > 0 && (unsigned)width > len)
+	    display_buf_fill(' ', (unsigned)width - len);
+      if (sign) display_buf_append(&sign, 1);
+      display_buf_fill('0', zpad);
+      display_buf_append(cp, strlen(cp));
+      if (step->ljust && width > 0 && (unsigned)width > len)
+	    display_buf_fill(' ', (unsigned)width - len);
+      return 1;
+}
+
+/* The %t code. This follows get_format_char(). */
+static int display_step_time(const struct display_step*step,
+                             const struct strobe_cb_info*info,
+                             PLI_INT32 time_units)
+{
+      vpiHandle item = info->items[step->idx+1];
+      s_vpi_value value;
+      char buf[24];
+      unsigned swidth, zpad = 0;
+      int width = step->width;
+      int prec = step->prec;
+
+      if (prec == -1) prec = timeformat_info.prec;
+      if (prec < 0 || prec > 64) return 0;
+
+	/* The get_time() result fits in this much room, as long as
+	   the value is a reasonable time. */
+      if (513 + strlen(timeformat_info.suff) > display_tbuf_size) {
+	    display_tbuf_size = 513 + strlen(timeformat_info.suff);
+	    display_tbuf = realloc(display_tbuf, display_tbuf_size);
+      }
+      if (step->is_real) {
+	    value.format = vpiRealVal;
+	    vpi_get_value(item, &value);
+	    if (value.format == vpiSuppressVal) return 0;
+	    get_time_real(display_tbuf, value.value.real, prec, time_units);
+      } else {
+	    const char*cp = display_dec_str(buf, item, step);
+	    if (cp == 0) return 0;
+	    get_time(display_tbuf, cp, prec, time_units);
+      }
+
+      swidth = strlen(display_tbuf);
+      if (step->ld_zero) {
+	    if (width == -1) width = 0;
+	    else if (!step->ljust && (signed)swidth < width)
+		  zpad = (unsigned)width - swidth;
+      }
+      if (width == -1) width = timeformat_info.width;
+
+      display_buf_justify(display_tbuf, zpad, step->ljust, width);
+      return 1;
+}
+
+/*
+ * Run the display program and return the result, which is only good
+ * until the next display program is run. As with get_display(), the
+ * result may contain NULL characters (from %u and %z), so the size
+ * is returned through rtnsz. If a format argument is not what the
+ * program was compiled from, this returns nil and the caller must
+ * use get_display() instead.
+ */
+static char*display_prog_run(struct display_prog*prog, unsigned*rtnsz)
+{
+      const struct strobe_cb_info*info = &prog->info;
+      s_vpi_value value;
+      unsigned idx;
+
+      for (idx = 0 ; idx < prog->nfmt_args ; idx += 1) {
+	    value.format = vpiStringVal;
+	    vpi_get_value(prog->fmt_args[idx].arg, &value);
+	    if (strcmp(value.value.str, prog->fmt_args[idx].text) != 0)
+		  return 0;
+      }
+
+      display_buf.len = 0;
+      for (idx = 0 ; idx < prog->nsteps ; idx += 1) {
+	    const struct display_step*step = prog->steps + idx;
+	    int done = 0;
+
+	    switch (step->kind) {
+
+		case DS_TEXT:
+		  display_buf_append(step->text, step->text_len);
+		  done = 1;
+		  break;
+
+		case DS_FORMAT:
+		  if (step->idx+1 < info->nitems) switch (step->fmt) {
+		      case 'b':
+		      case 'B':
+		      case 'o':
+		      case 'O':
+		      case 'h':
+		      case 'H':
+		      case 'x':
+		      case 'X':
+			if (step->plus == 0 && step->prec == -1)
+			      done = display_step_vec(step, info);
+			break;
+		      case 'd':
+		      case 'D':
+			if (step->prec == -1)
+			      done = display_step_dec(step, info);
+			break;
+		      case 't':
+		      case 'T':
+			if (step->plus == 0)
+			      done = display_step_time(step, info,
+			                               prog->time_units);
+			break;
+		      default:
+			break;
+		  }
+		  if (! done) {
+			display_step_slow(step, info);
+			done = 1;
+		  }
+		  break;
+
+		case DS_NUMERIC:
+		  if (info->default_format == vpiDecStrVal) {
+			char buf[24];
+			const char*cp = display_dec_str(buf, info->items[step->idx],
+			                                step);
+			if (cp) {
+			      display_buf_justify(cp, 0, 0, step->dec_size);
+			      done = 1;
+			}
+		  } else {
+			value.format = info->default_format;
+			vpi_get_value(info->items[step->idx], &value);
+			if (value.format != vpiSuppressVal) {
+			      display_buf_append(value.value.str,
+			                         strlen(value.value.str));
+			      done = 1;
+			}
+		  }
+		  break;
+
+		case DS_ITEM:
+		  break;
+	    }
+
+	    if (! done) {
+		  struct strobe_cb_info item_info = *info;
+		  char*result;
+		  unsigned cnt;
+		  item_info.items = info->items + step->idx;
+		  item_info.nitems = 1;
+		  result = get_display(&cnt, &item_info);
+		  display_buf_append(result, cnt);
+		  free(result);
+	    }
+      }
+
+      display_buf_reserve(0);
+      display_buf.text[display_buf.len] = 0;
+      *rtnsz = display_buf.len;
+      return display_buf.text;
+}
+
 #ifdef BR916_STOPGAP_FIX
 static char br916_hint_issued = 0;
 #endif
@@ -1188,26 +1876,47 @@ static PLI_INT32 sys_common_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name, int no_au
 /* Check the $display, $write, $fdisplay and $fwrite based tasks. */
 static PLI_INT32 sys_display_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
+      vpiHandle callh, argv, fd_arg = 0;
+      struct display_prog*prog;
+      PLI_INT32 rc;
+
 	/* These tasks can have automatic variables and are not monitor. */
-      return sys_common_compiletf(name, 0, 0);
+      rc = sys_common_compiletf(name, 0, 0);
+      if (rc != 0) return rc;
+
+	/* Compile the display program for the call. */
+      callh = vpi_handle(vpiSysTfCall, 0);
+      argv = vpi_iterate(vpiArgument, callh);
+      if (name[1] == 'f') {
+	    if (argv == 0) return 0;
+	    fd_arg = vpi_scan(argv);
+	    if (fd_arg == 0) return 0;
+      }
+      prog = display_prog_compile(callh, argv, name, 0);
+      if (prog) prog->lead_arg = fd_arg;
+      display_prog_save(callh, prog);
+      return 0;
 }
 
 /* This implements the $display/$fdisplay and the $write/$fwrite based tasks. */
 static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
-      vpiHandle callh, argv, scope;
+      vpiHandle callh, argv = 0, scope;
+      struct display_prog*prog;
       struct strobe_cb_info info;
       char* result;
+      char* free_result = 0;
       unsigned int size, location=0;
       PLI_UINT32 fd_mcd;
 
       callh = vpi_handle(vpiSysTfCall, 0);
-      argv = vpi_iterate(vpiArgument, callh);
+      prog = (struct display_prog*)vpi_get_userdata(callh);
+      if (prog == 0) argv = vpi_iterate(vpiArgument, callh);
 
 	/* Get the file/MC descriptor and verify it is valid. */
       if(name[1] == 'f') {
 	      errno = 0;
-	      vpiHandle arg = vpi_scan(argv);
+	      vpiHandle arg = prog? prog->lead_arg : vpi_scan(argv);
 	      s_vpi_value val;
 	      val.format = vpiIntVal;
 	      vpi_get_value(arg, &val);
@@ -1215,7 +1924,7 @@ static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
 		/* If the MCD is zero we have nothing to do so just return. */
 	      if (fd_mcd == 0)  {
-		    vpi_free_object(argv);
+		    if (argv) vpi_free_object(argv);
 		    return 0;
 	      }
 
@@ -1226,27 +1935,36 @@ static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 		    vpi_printf("invalid file descriptor/MCD (0x%x) given "
 		               "to %s.\n", (unsigned int)fd_mcd, name);
 		    errno = EBADF;
-		    vpi_free_object(argv);
+		    if (argv) vpi_free_object(argv);
 		    return 0;
 	      }
       } else {
 	      fd_mcd = 1;
       }
 
-      scope = vpi_handle(vpiScope, callh);
-      assert(scope);
-	/* We could use vpi_get_str(vpiName, callh) to get the task name,
-	 * but name is already defined. */
-      info.name = name;
-      info.filename = strdup(vpi_get_str(vpiFile, callh));
-      info.lineno = (int)vpi_get(vpiLineNo, callh);
-      info.default_format = get_default_format(name);
-      info.scope = scope;
-      array_from_iterator(&info, argv);
-
 	/* Because %u and %z may put embedded NULL characters into the
 	 * returned string strlen() may not match the real size! */
-      result = get_display(&size, &info);
+      if (prog) {
+	    result = display_prog_run(prog, &size);
+	    if (result == 0)
+		  result = free_result = get_display(&size, &prog->info);
+      } else {
+	    scope = vpi_handle(vpiScope, callh);
+	    assert(scope);
+	      /* We could use vpi_get_str(vpiName, callh) to get the task
+	       * name, but name is already defined. */
+	    info.name = name;
+	    info.filename = strdup(vpi_get_str(vpiFile, callh));
+	    info.lineno = (int)vpi_get(vpiLineNo, callh);
+	    info.default_format = get_default_format(name);
+	    info.scope = scope;
+	    array_from_iterator(&info, argv);
+
+	    result = free_result = get_display(&size, &info);
+	    free(info.filename);
+	    free(info.items);
+      }
+
       while (location < size) {
 	    if (result[location] == '\0') {
 		  my_mcd_printf(fd_mcd, "%c", '\0');
@@ -1259,9 +1977,7 @@ static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
       if ((strncmp(name,"$display",8) == 0) ||
           (strncmp(name,"$fdisplay",9) == 0)) my_mcd_printf(fd_mcd, "\n");
 
-      free(info.filename);
-      free(info.items);
-      free(result);
+      free(free_result);
       return 0;
 }
 
@@ -1568,6 +2284,7 @@ static PLI_INT32 sys_swrite_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
   vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
   vpiHandle argv = vpi_iterate(vpiArgument, callh);
   vpiHandle reg;
+  struct display_prog*prog;
 
   /* Check that there are arguments. */
   if (argv == 0) {
@@ -1589,34 +2306,53 @@ static PLI_INT32 sys_swrite_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
   }
 
   if (sys_check_args(callh, argv, name, 0, 0)) vpi_control(vpiFinish, 1);
+
+  /* Compile the display program for the call. */
+  argv = vpi_iterate(vpiArgument, callh);
+  reg = vpi_scan(argv);
+  prog = display_prog_compile(callh, argv, name, 0);
+  if (prog) prog->lead_arg = reg;
+  display_prog_save(callh, prog);
   return 0;
 }
 
 static PLI_INT32 sys_swrite_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
   vpiHandle callh, argv, reg, scope;
+  struct display_prog*prog;
   struct strobe_cb_info info;
   s_vpi_value val;
   unsigned int size;
+  char *result = 0;
 
   callh = vpi_handle(vpiSysTfCall, 0);
-  argv = vpi_iterate(vpiArgument, callh);
-  reg = vpi_scan(argv);
+  prog = (struct display_prog*)vpi_get_userdata(callh);
+
+  if (prog) {
+    reg = prog->lead_arg;
+    info = prog->info;
+    val.value.str = display_prog_run(prog, &size);
+    if (val.value.str == 0) val.value.str = result = get_display(&size, &info);
+  } else {
+    argv = vpi_iterate(vpiArgument, callh);
+    reg = vpi_scan(argv);
+
+    scope = vpi_handle(vpiScope, callh);
+    assert(scope);
+    /* We could use vpi_get_str(vpiName, callh) to get the task name, but
+     * name is already defined. */
+    info.name = name;
+    info.filename = strdup(vpi_get_str(vpiFile, callh));
+    info.lineno = (int)vpi_get(vpiLineNo, callh);
+    info.default_format = get_default_format(name);
+    info.scope = scope;
+    array_from_iterator(&info, argv);
+
+    /* Because %u and %z may put embedded NULL characters into the
+     * returned string strlen() may not match the real size! */
+    val.value.str = result = get_display(&size, &info);
+  }
 
-  scope = vpi_handle(vpiScope, callh);
-  assert(scope);
-  /* We could use vpi_get_str(vpiName, callh) to get the task name, but
-   * name is already defined. */
-  info.name = name;
-  info.filename = strdup(vpi_get_str(vpiFile, callh));
-  info.lineno = (int)vpi_get(vpiLineNo, callh);
-  info.default_format = get_default_format(name);
-  info.scope = scope;
-  array_from_iterator(&info, argv);
-
-  /* Because %u and %z may put embedded NULL characters into the returned
-   * string strlen() may not match the real size! */
-  val.value.str = get_display(&size, &info);
   val.format = vpiStringVal;
   vpi_put_value(reg, &val, 0, vpiNoDelay);
   if (size != strlen(val.value.str)) {
@@ -1624,9 +2360,11 @@ static PLI_INT32 sys_swrite_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
                "(see %%u/%%z).\n", info.filename, info.lineno, name);
   }
 
-  free(val.value.str);
-  free(info.filename);
-  free(info.items);
+  free(result);
+  if (prog == 0) {
+    free(info.filename);
+    free(info.items);
+  }
   return 0;
 }
 
@@ -1634,7 +2372,8 @@ static PLI_INT32 sys_sformat_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
   vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
   vpiHandle argv = vpi_iterate(vpiArgument, callh);
-  vpiHandle arg;
+  vpiHandle reg, arg;
+  struct display_prog*prog;
   PLI_INT32 type;
 
   /* Check that there are arguments. */
@@ -1676,45 +2415,71 @@ static PLI_INT32 sys_sformat_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
   }
 
   if (sys_check_args(callh, argv, name, 0, 0)) vpi_control(vpiFinish, 1);
+
+  /* Compile the display program for the call. */
+  argv = vpi_iterate(vpiArgument, callh);
+  reg = vpi_scan(argv);
+  arg = vpi_scan(argv);
+  prog = display_prog_compile(callh, argv, name, arg);
+  if (prog) prog->lead_arg = reg;
+  display_prog_save(callh, prog);
   return 0;
 }
 
 static PLI_INT32 sys_sformat_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
   vpiHandle callh, argv, reg, scope;
+  struct display_prog*prog;
   struct strobe_cb_info info;
   s_vpi_value val;
-  char *result, *fmt;
+  char *result = 0, *fmt;
   unsigned int idx, size;
 
   callh = vpi_handle(vpiSysTfCall, 0);
-  argv = vpi_iterate(vpiArgument, callh);
-  reg = vpi_scan(argv);
-  val.format = vpiStringVal;
-  vpi_get_value(vpi_scan(argv), &val);
-  fmt = strdup(val.value.str);
-
-  scope = vpi_handle(vpiScope, callh);
-  assert(scope);
-  /* We could use vpi_get_str(vpiName, callh) to get the task name, but
-   * name is already defined. */
-  info.name = name;
-  info.filename = strdup(vpi_get_str(vpiFile, callh));
-  info.lineno = (int)vpi_get(vpiLineNo, callh);
-  info.default_format = get_default_format(name);
-  info.scope = scope;
-  array_from_iterator(&info, argv);
-  idx = -1;
-  size = get_format(&result, fmt, &info, &idx);
-  free(fmt);
-
-  if (idx+1< info.nitems) {
-    vpi_printf("WARNING: %s:%d: %s has %d extra argument(s).\n",
-               info.filename, info.lineno,  name,
-               info.nitems-idx-1);
+  prog = (struct display_prog*)vpi_get_userdata(callh);
+
+  if (prog) {
+    reg = prog->lead_arg;
+    info = prog->info;
+    val.value.str = display_prog_run(prog, &size);
+  } else {
+    val.value.str = 0;
+  }
+
+  if (val.value.str) {
+    if (prog->extra_args) {
+      vpi_printf("WARNING: %s:%d: %s has %d extra argument(s).\n",
+                 info.filename, info.lineno,  name, prog->extra_args);
+    }
+  } else {
+    argv = vpi_iterate(vpiArgument, callh);
+    reg = vpi_scan(argv);
+    val.format = vpiStringVal;
+    vpi_get_value(vpi_scan(argv), &val);
+    fmt = strdup(val.value.str);
+
+    scope = vpi_handle(vpiScope, callh);
+    assert(scope);
+    /* We could use vpi_get_str(vpiName, callh) to get the task name, but
+     * name is already defined. */
+    info.name = name;
+    info.filename = strdup(vpi_get_str(vpiFile, callh));
+    info.lineno = (int)vpi_get(vpiLineNo, callh);
+    info.default_format = get_default_format(name);
+    info.scope = scope;
+    array_from_iterator(&info, argv);
+    idx = -1;
+    size = get_format(&result, fmt, &info, &idx);
+    free(fmt);
+
+    if (idx+1< info.nitems) {
+      vpi_printf("WARNING: %s:%d: %s has %d extra argument(s).\n",
+                 info.filename, info.lineno,  name,
+                 info.nitems-idx-1);
+    }
+    val.value.str = result;
   }
 
-  val.value.str = result;
   val.format = vpiStringVal;
   vpi_put_value(reg, &val, 0, vpiNoDelay);
   if (size != strlen(val.value.str)) {
@@ -1722,9 +2487,11 @@ static PLI_INT32 sys_sformat_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
                "(see %%u/%%z).\n", info.filename, info.lineno, name);
   }
 
-  free(val.value.str);
-  free(info.filename);
-  free(info.items);
+  if (result) {
+    free(result);
+    free(info.filename);
+    free(info.items);
+  }
   return 0;
 }
 
@@ -2063,7 +2830,21 @@ static PLI_INT32 sys_severity_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 
 static PLI_INT32 sys_end_of_simulation(p_cb_data cb_data)
 {
+      unsigned idx;
+
       (void)cb_data; /* Parameter is not used. */
+      for (idx = 0 ; idx < display_progs_count ; idx += 1)
+	    display_prog_free(display_progs[idx]);
+      free(display_progs);
+      display_progs = 0;
+      display_progs_count = 0;
+      free(display_buf.text);
+      display_buf.text = 0;
+      display_buf.size = 0;
+      free(display_tbuf);
+      display_tbuf = 0;
+      display_tbuf_size = 0;
+
       free(monitor_callbacks);
       monitor_callbacks = 0;
       free(monitor_info.filename);
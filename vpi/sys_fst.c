@@ -48,6 +48,7 @@ struct vcd_info {
 
 static struct vcd_info *vcd_list = NULL;
 static struct vcd_info *vcd_dmp_list = NULL;
+static vpip_dump_t vcd_dump = 0;
 static PLI_UINT64 vcd_cur_time = 0;
 static int dump_is_off = 0;
 static long dump_limit = 0;
@@ -87,6 +88,22 @@ static void show_this_item(struct vcd_info*info)
       }
 }
 
+/* Dump a value from a batch of value changes. */
+static void show_this_change(p_vpip_dump_change chg)
+{
+      struct vcd_info*info = (struct vcd_info*)chg->user_data;
+
+      if (chg->type == vpiRealVar) {
+	    fstWriterEmitValueChange(dump_file, info->handle, &chg->real);
+      } else if (chg->type == vpiNamedEvent) {
+	    fstWriterEmitValueChange(dump_file, info->handle, "1");
+      } else {
+	    fstWriterEmitValueChange(dump_file, info->handle,
+				     vcd_vecval_to_binstr(chg->vector,
+							  chg->size));
+      }
+}
+
 /* Dump values for a $dumpoff. */
 static void show_this_item_x(struct vcd_info*info)
 {
@@ -143,6 +160,42 @@ static void vcd_checkpoint_x(void)
 	    show_this_item_x(cur);
 }
 
+/*
+ * Most signals are traced through the batch value change interface
+ * of the run time, which records the changes with no callbacks. The
+ * batch is only enabled while the changes would be dumped.
+ */
+static void vcd_dump_enable(void)
+{
+      if (vcd_dump == 0) return;
+      vpip_dump_enable(vcd_dump, !dump_is_full && !dump_is_off &&
+			         !dump_header_pending() && !finish_status);
+}
+
+static void vcd_dump_changes(PLI_UINT64 now, p_vpip_dump_change changes,
+			     unsigned count, void*cd)
+{
+      unsigned idx;
+
+      (void)cd; /* Parameter is not used. */
+
+      if ((dump_limit > 0) && fstWriterGetDumpSizeLimitReached(dump_file)) {
+            dump_is_full = 1;
+            vcd_dump_enable();
+            vpi_printf("WARNING: Dump file limit (%ld bytes) "
+                               "exceeded.\n", dump_limit);
+            return;
+      }
+
+      if (now != vcd_cur_time) {
+	    fstWriterEmitTimeChange(dump_file, now);
+	    vcd_cur_time = now;
+      }
+
+      for (idx = 0 ;  idx < count ;  idx += 1)
+	    show_this_change(changes+idx);
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       struct vcd_info* info = vcd_dmp_list;
@@ -175,6 +228,7 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
 
       if ((dump_limit > 0) && fstWriterGetDumpSizeLimitReached(dump_file)) {
             dump_is_full = 1;
+            vcd_dump_enable();
             vpi_printf("WARNING: Dump file limit (%ld bytes) "
                                "exceeded.\n", dump_limit);
             return 0;
@@ -199,6 +253,7 @@ static PLI_INT32 dumpvars_cb(p_cb_data cause)
       if (dumpvars_status != 1) return 0;
 
       dumpvars_status = 2;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       vcd_cur_time = dumpvars_time;
@@ -222,6 +277,7 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       if (finish_status != 0) return 0;
 
       finish_status = 1;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
 
@@ -287,6 +343,7 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (dump_is_off) return 0;
 
       dump_is_off = 1;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -316,6 +373,7 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (!dump_is_off) return 0;
 
       dump_is_off = 0;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -411,6 +469,11 @@ static void open_dumpfile(vpiHandle callh)
 	        (lxm_optimum_mode == LXM_BOTH)) {
 		  fstWriterSetRepackOnClose(dump_file, 1);
 	    }
+#ifdef HAVE_LIBPTHREAD
+	      /* Compress and write each finished section in a separate
+	         thread while the simulation fills the next one. */
+	    fstWriterSetParallelMode(dump_file, 1);
+#endif
       }
 }
 
@@ -636,7 +699,8 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		  if (nexus_id) set_nexus_ident(nexus_id,
 		                                (const char *)(long)new_ident);
 
-		    /* Add a callback for the signal. */
+		    /* Add the signal to the batch, or a callback for
+		     * the signal if it cannot be batched. */
 		  info = malloc(sizeof(*info));
 
 		  info->time.type = vpiSimTime;
@@ -644,18 +708,25 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		  info->handle = new_ident;
 		  info->scheduled = 0;
 
-		  cb.time      = &info->time;
-		  cb.user_data = (char*)info;
-		  cb.value     = NULL;
-		  cb.obj       = item;
-		  cb.reason    = cbValueChange;
-		  cb.cb_rtn    = variable_cb_1;
-
 		  info->dmp_next = 0;
 		  info->next  = vcd_list;
 		  vcd_list    = info;
 
-		  info->cb    = vpi_register_cb(&cb);
+		  if (vcd_dump == 0)
+			vcd_dump = vpip_dump_create(vcd_dump_changes, 0);
+
+		  if (vpip_dump_add(vcd_dump, item, info)) {
+			info->cb = 0;
+		  } else {
+			cb.time      = &info->time;
+			cb.user_data = (char*)info;
+			cb.value     = NULL;
+			cb.obj       = item;
+			cb.reason    = cbValueChange;
+			cb.cb_rtn    = variable_cb_1;
+
+			info->cb = vpi_register_cb(&cb);
+		  }
 	    }
 
 	    break;
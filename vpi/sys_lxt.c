@@ -51,6 +51,7 @@ struct vcd_info {
 
 static struct vcd_info *vcd_list = NULL;
 static struct vcd_info *vcd_dmp_list = NULL;
+static vpip_dump_t vcd_dump = 0;
 static PLI_UINT64 vcd_cur_time = 0;
 static int dump_is_off = 0;
 static long dump_limit = 0;
@@ -178,6 +179,23 @@ static void show_this_item(struct vcd_info*info)
 }
 
 
+/* Dump a value from a batch of value changes. */
+static void show_this_change(p_vpip_dump_change chg)
+{
+      struct vcd_info*info = (struct vcd_info*)chg->user_data;
+
+      if (chg->type == vpiRealVar) {
+	    lt_emit_value_double(dump_file, info->sym, 0, chg->real);
+
+      } else {
+	    lt_emit_value_bit_string(dump_file, info->sym,
+	                             0 /* array row */,
+	                             vcd_vecval_to_binstr(chg->vector,
+	                                                  chg->size));
+      }
+}
+
+
 static void show_this_item_x(struct vcd_info*info)
 {
       if (vpi_get(vpiType,info->item) == vpiRealVar) {
@@ -222,6 +240,42 @@ static void vcd_checkpoint_x()
 	    show_this_item_x(cur);
 }
 
+/*
+ * Most signals are traced through the batch value change interface
+ * of the run time, which records the changes with no callbacks. The
+ * batch is only enabled while the changes would be dumped.
+ */
+static void vcd_dump_enable(void)
+{
+      if (vcd_dump == 0) return;
+      vpip_dump_enable(vcd_dump, !dump_is_full && !dump_is_off &&
+			         !dump_header_pending() && !finish_status);
+}
+
+static void vcd_dump_changes(PLI_UINT64 now, p_vpip_dump_change changes,
+			     unsigned count, void*cd)
+{
+      unsigned idx;
+
+      (void)cd; /* Parameter is not used. */
+
+      if ((dump_limit > 0) && (ftell(dump_file->handle) > dump_limit)) {
+            dump_is_full = 1;
+            vcd_dump_enable();
+            vpi_printf("WARNING: Dump file limit (%ld bytes) "
+                       "exceeded.\n", dump_limit);
+            return;
+      }
+
+      if (now != vcd_cur_time) {
+            lt_set_time64(dump_file, now);
+	    vcd_cur_time = now;
+      }
+
+      for (idx = 0 ;  idx < count ;  idx += 1)
+	    show_this_change(changes+idx);
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       struct vcd_info* info = vcd_dmp_list;
@@ -254,6 +308,7 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
 
       if ((dump_limit > 0) && (ftell(dump_file->handle) > dump_limit)) {
             dump_is_full = 1;
+            vcd_dump_enable();
             vpi_printf("WARNING: Dump file limit (%ld bytes) "
                        "exceeded.\n", dump_limit);
             return 0;
@@ -273,11 +328,38 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       return 0;
 }
 
+/*
+ * Add the signal to the batch, or a callback for the signal if it
+ * cannot be batched.
+ */
+static void watch_item(struct vcd_info*info)
+{
+      struct t_cb_data cb;
+
+      if (vcd_dump == 0)
+	    vcd_dump = vpip_dump_create(vcd_dump_changes, 0);
+
+      if (vpip_dump_add(vcd_dump, info->item, info)) {
+	    info->cb = 0;
+	    return;
+      }
+
+      cb.time      = &info->time;
+      cb.user_data = (char*)info;
+      cb.value     = NULL;
+      cb.obj       = info->item;
+      cb.reason    = cbValueChange;
+      cb.cb_rtn    = variable_cb_1;
+
+      info->cb = vpi_register_cb(&cb);
+}
+
 static PLI_INT32 dumpvars_cb(p_cb_data cause)
 {
       if (dumpvars_status != 1) return 0;
 
       dumpvars_status = 2;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       vcd_cur_time = dumpvars_time;
@@ -297,6 +379,7 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       if (finish_status != 0) return 0;
 
       finish_status = 1;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
@@ -359,6 +442,7 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (dump_is_off) return 0;
 
       dump_is_off = 1;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -388,6 +472,7 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (!dump_is_off) return 0;
 
       dump_is_off = 0;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -532,7 +617,6 @@ static PLI_INT32 sys_dumplimit_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
 static void scan_item(unsigned depth, vpiHandle item, int skip)
 {
-      struct t_cb_data cb;
       struct vcd_info* info;
 
       const char* name;
@@ -596,17 +680,10 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		                              LT_SYM_F_BITS);
 		  info->scheduled = 0;
 
-		  cb.time      = &info->time;
-		  cb.user_data = (char*)info;
-		  cb.value     = NULL;
-		  cb.obj       = item;
-		  cb.reason    = cbValueChange;
-		  cb.cb_rtn    = variable_cb_1;
-
 		  info->next  = vcd_list;
 		  vcd_list    = info;
 
-		  info->cb    = vpi_register_cb(&cb);
+		  watch_item(info);
 
 	    } else {
 		  char *n = create_full_name(name);
@@ -636,17 +713,10 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 	                               0, LT_SYM_F_DOUBLE);
 	    info->scheduled = 0;
 
-	    cb.time      = &info->time;
-	    cb.user_data = (char*)info;
-	    cb.value     = NULL;
-	    cb.obj       = item;
-	    cb.reason    = cbValueChange;
-	    cb.cb_rtn    = variable_cb_1;
-
 	    info->next  = vcd_list;
 	    vcd_list    = info;
 
-	    info->cb    = vpi_register_cb(&cb);
+	    watch_item(info);
 
 	    break;
 
@@ -106,6 +106,7 @@ void delete_all_vcd_info(void)
 # define VCD_INFO_ENDP ((struct vcd_info*)1)
 static struct vcd_info *vcd_dmp_list = VCD_INFO_ENDP;
 static struct t_vpi_time vcd_dmp_time;
+static vpip_dump_t vcd_dump = 0;
 
 static PLI_UINT64 vcd_cur_time = 0;
 static int dump_is_off = 0;
@@ -233,6 +234,21 @@ static void show_this_item(struct vcd_info*info)
 }
 
 
+/* Dump a value from a batch of value changes. */
+static void show_this_change(p_vpip_dump_change chg)
+{
+      struct vcd_info*info = (struct vcd_info*)chg->user_data;
+
+      if (chg->type == vpiRealVar) {
+	    vcd_work_emit_double(info->sym, chg->real);
+
+      } else {
+	    vcd_work_emit_bits(info->sym, vcd_vecval_to_binstr(chg->vector,
+	                                                       chg->size));
+      }
+}
+
+
 static void show_this_item_x(struct vcd_info*info)
 {
       if (vpi_get(vpiType,info->item) == vpiRealVar) {
@@ -264,6 +280,42 @@ static void vcd_checkpoint_x(void)
       functor_all_vcd_info( show_this_item_x );
 }
 
+/*
+ * Most signals are traced through the batch value change interface
+ * of the run time, which records the changes with no callbacks. The
+ * batch is only enabled while the changes would be dumped.
+ */
+static void vcd_dump_enable(void)
+{
+      if (vcd_dump == 0) return;
+      vpip_dump_enable(vcd_dump, !dump_is_full && !dump_is_off &&
+			         !dump_header_pending() && !finish_status);
+}
+
+static void vcd_dump_changes(PLI_UINT64 now, p_vpip_dump_change changes,
+			     unsigned count, void*cd)
+{
+      unsigned idx;
+
+      (void)cd; /* Parameter is not used. */
+
+      if ((dump_limit > 0) && (ftell(dump_file->handle) > dump_limit)) {
+            dump_is_full = 1;
+            vcd_dump_enable();
+            vpi_printf("WARNING: Dump file limit (%ld bytes) "
+                       "exceeded.\n", dump_limit);
+            return;
+      }
+
+      if (now != vcd_cur_time) {
+	    vcd_work_set_time(now);
+	    vcd_cur_time = now;
+      }
+
+      for (idx = 0 ;  idx < count ;  idx += 1)
+	    show_this_change(changes+idx);
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       assert(cause->time->type == vpiSimTime);
@@ -296,6 +348,7 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
 
       if ((dump_limit > 0) && (ftell(dump_file->handle) > dump_limit)) {
             dump_is_full = 1;
+            vcd_dump_enable();
             vpi_printf("WARNING: Dump file limit (%ld bytes) "
                        "exceeded.\n", dump_limit);
             return 0;
@@ -316,11 +369,38 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       return 0;
 }
 
+/*
+ * Add the signal to the batch, or a callback for the signal if it
+ * cannot be batched.
+ */
+static void watch_item(struct vcd_info*info)
+{
+      struct t_cb_data cb;
+
+      if (vcd_dump == 0)
+	    vcd_dump = vpip_dump_create(vcd_dump_changes, 0);
+
+      if (vpip_dump_add(vcd_dump, info->item, info)) {
+	    info->cb = 0;
+	    return;
+      }
+
+      cb.time      = 0;
+      cb.user_data = (char*)info;
+      cb.value     = NULL;
+      cb.obj       = info->item;
+      cb.reason    = cbValueChange;
+      cb.cb_rtn    = variable_cb_1;
+
+      info->cb = vpi_register_cb(&cb);
+}
+
 static PLI_INT32 dumpvars_cb(p_cb_data cause)
 {
       if (dumpvars_status != 1) return 0;
 
       dumpvars_status = 2;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       vcd_cur_time = dumpvars_time;
@@ -338,6 +418,7 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       if (finish_status != 0) return 0;
 
       finish_status = 1;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
@@ -397,6 +478,7 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (dump_is_off) return 0;
 
       dump_is_off = 1;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -426,6 +508,7 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (!dump_is_off) return 0;
 
       dump_is_off = 0;
+      vcd_dump_enable();
 
       if (dump_file == 0) return 0;
       if (dump_header_pending()) return 0;
@@ -595,7 +678,6 @@ static PLI_INT32 sys_dumplimit_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
 static void scan_item(unsigned depth, vpiHandle item, int skip)
 {
-      struct t_cb_data cb;
       struct vcd_info* info;
 
       const char* name;
@@ -658,14 +740,7 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		                                   LXT2_WR_SYM_F_BITS);
 		  info->dmp_next = 0;
 
-		  cb.time      = 0;
-		  cb.user_data = (char*)info;
-		  cb.value     = NULL;
-		  cb.obj       = item;
-		  cb.reason    = cbValueChange;
-		  cb.cb_rtn    = variable_cb_1;
-
-		  info->cb    = vpi_register_cb(&cb);
+		  watch_item(info);
 
 	    } else {
 		  char *n = create_full_name(name);
@@ -694,14 +769,7 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 	                                    0, LXT2_WR_SYM_F_DOUBLE);
 	    info->dmp_next = 0;
 
-	    cb.time      = 0;
-	    cb.user_data = (char*)info;
-	    cb.value     = NULL;
-	    cb.obj       = item;
-	    cb.reason    = cbValueChange;
-	    cb.cb_rtn    = variable_cb_1;
-
-	    info->cb    = vpi_register_cb(&cb);
+	    watch_item(info);
 
 	    break;
 
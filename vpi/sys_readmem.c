@@ -23,7 +23,6 @@
 # include  <stdlib.h>
 # include  <stdio.h>
 # include  <assert.h>
-# include  "sys_readmem_lex.h"
 # include  <sys/stat.h>
 # include  "ivl_alloc.h"
 
@@ -256,12 +255,224 @@ static PLI_INT32 sys_mem_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
       return 0;
 }
 
+/*
+ * The memory file is read into memory in one go and scanned by hand
+ * here. The tokens are white space, line and block comments, @
+ * followed by a hex address, and words of hex (or binary) digits
+ * including x, z and _. Any other character is an error.
+ */
+# define MEM_ADDRESS 1
+# define MEM_WORD    2
+# define MEM_ERROR   3
+
+  /* The words are collected in blocks of this many words before they
+     are stored into the memory. */
+# define READMEM_BLOCK 4096
+
+struct readmem_scan {
+      const char*cur;
+      const char*end;
+      int bin_flag;
+      unsigned wwid;
+	/* The address of a MEM_ADDRESS token. */
+      unsigned addr;
+	/* The text of a MEM_ERROR token. */
+      char error_token[2];
+};
+
+static char *read_whole_file(FILE*file, size_t*len)
+{
+      struct stat sb;
+      size_t size = 0, cap = 4096;
+      char *buf;
+
+      if (fstat(fileno(file), &sb) == 0 && sb.st_size > 0)
+	    cap = (size_t)sb.st_size + 1;
+
+      buf = malloc(cap);
+      for (;;) {
+	    size_t cnt = fread(buf+size, 1, cap-size, file);
+	    size += cnt;
+	    if (size < cap) break;
+	    cap *= 2;
+	    buf = realloc(buf, cap);
+      }
+
+      *len = size;
+      return buf;
+}
+
+static int is_hex_digit(char ch)
+{
+      return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') ||
+             (ch >= 'A' && ch <= 'F');
+}
+
+static unsigned hex_digit_value(char ch)
+{
+      if (ch <= '9') return ch - '0';
+      if (ch <= 'F') return ch - 'A' + 10;
+      return ch - 'a' + 10;
+}
+
+static int is_word_char(const struct readmem_scan*scan, char ch)
+{
+      switch (ch) {
+	  case '0': case '1':
+	  case 'x': case 'X':
+	  case 'z': case 'Z':
+	  case '_':
+	    return 1;
+	  default:
+	    return !scan->bin_flag && is_hex_digit(ch);
+      }
+}
+
+/*
+ * Convert the word text into the vecval. The digits are taken from the
+ * right, and any digits past the width of the memory word are dropped.
+ */
+static void make_word_value(const struct readmem_scan*scan,
+                            const char*beg, const char*end,
+                            struct t_vpi_vecval*vec)
+{
+      unsigned step = scan->bin_flag? 1 : 4;
+      unsigned mask = scan->bin_flag? 1 : 15;
+      unsigned pos = 0;
+      unsigned idx;
+
+      for (idx = 0 ;  idx < scan->wwid ;  idx += 32) {
+	    vec[idx/32].aval = 0;
+	    vec[idx/32].bval = 0;
+      }
+
+      while (pos < scan->wwid && end > beg) {
+	    unsigned aval, bval;
+
+	    end -= 1;
+	    switch (*end) {
+		case '_':
+		  continue;
+		case 'x':
+		case 'X':
+		  aval = mask;
+		  bval = mask;
+		  break;
+		case 'z':
+		case 'Z':
+		  aval = 0;
+		  bval = mask;
+		  break;
+		default:
+		  aval = hex_digit_value(*end);
+		  bval = 0;
+		  break;
+	    }
+
+	    vec[pos/32].aval |= aval << (pos%32);
+	    vec[pos/32].bval |= bval << (pos%32);
+	    pos += step;
+      }
+}
+
+/*
+ * Return the next token of the file, or 0 at the end of the file. A
+ * MEM_WORD is converted into the vec array.
+ */
+static int readmem_scan_next(struct readmem_scan*scan,
+                             struct t_vpi_vecval*vec)
+{
+      while (scan->cur < scan->end) {
+	    const char*cp = scan->cur;
+
+	    switch (*cp) {
+		case ' ':
+		case '\t':
+		case '\f':
+		case '\n':
+		case '\r':
+		  scan->cur += 1;
+		  continue;
+
+		case '/':
+		  if (cp+1 < scan->end && cp[1] == '/') {
+			cp += 2;
+			while (cp < scan->end && *cp != '\n') cp += 1;
+			scan->cur = cp;
+			continue;
+		  }
+		  if (cp+1 < scan->end && cp[1] == '*') {
+			cp += 2;
+			while (cp+1 < scan->end && !(cp[0] == '*' && cp[1] == '/'))
+			      cp += 1;
+			scan->cur = cp+1 < scan->end? cp+2 : scan->end;
+			continue;
+		  }
+		  break;
+
+		case '@':
+		  cp += 1;
+		  if (cp == scan->end || !is_hex_digit(*cp)) break;
+		  scan->addr = 0;
+		  while (cp < scan->end && is_hex_digit(*cp)) {
+			scan->addr = (scan->addr << 4) | hex_digit_value(*cp);
+			cp += 1;
+		  }
+		  scan->cur = cp;
+		  return MEM_ADDRESS;
+
+		default:
+		  if (!is_word_char(scan, *cp)) break;
+		  while (cp < scan->end && is_word_char(scan, *cp)) cp += 1;
+		  make_word_value(scan, scan->cur, cp, vec);
+		  scan->cur = cp;
+		  return MEM_WORD;
+	    }
+
+	    scan->error_token[0] = *scan->cur;
+	    scan->error_token[1] = 0;
+	    scan->cur += 1;
+	    return MEM_ERROR;
+      }
+
+      return 0;
+}
+
+/*
+ * Store a block of words into consecutive addresses of the memory. The
+ * memory is normally written directly, but if the run time cannot do
+ * that for this memory, write each word through its handle.
+ */
+static void readmem_store(vpiHandle mitem, int addr, int addr_incr,
+                          unsigned count, unsigned stride,
+                          struct t_vpi_vecval*words)
+{
+      s_vpi_value value;
+      unsigned idx;
+
+      if (count == 0) return;
+      if (vpip_put_array_words(mitem, addr, addr_incr, count, words)) return;
+
+      value.format = vpiVectorVal;
+      for (idx = 0 ;  idx < count ;  idx += 1, addr += addr_incr) {
+	    vpiHandle word_index = vpi_handle_by_index(mitem, addr);
+	    assert(word_index);
+	    value.value.vector = words + idx*stride;
+	    vpi_put_value(word_index, &value, 0, vpiNoDelay);
+      }
+}
+
 static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
       int code, wwid, addr;
       FILE*file;
       char *fname = 0;
-      s_vpi_value value;
+      char *text;
+      size_t text_len;
+      struct readmem_scan scan;
+      struct t_vpi_vecval*words;
+      unsigned stride, block_cnt;
+      int block_addr;
       vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
       vpiHandle argv = vpi_iterate(vpiArgument, callh);
       vpiHandle mitem = 0;
@@ -318,30 +529,38 @@ static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	    return 0;
       }
 
+      text = read_whole_file(file, &text_len);
+      fclose(file);
+
 	/* We need this many words from the file. */
       word_count = max_addr-min_addr+1;
 
       wwid = vpi_get(vpiSize, vpi_handle_by_index(mitem, min_addr));
 
-      /* variable that will be used by the lexer to pass values
-	 back to this code */
-      value.format = vpiVectorVal;
-      value.value.vector = calloc((wwid+31)/32, sizeof(s_vpi_vecval));
+	/* The words are converted into a block buffer, and the block
+	   is stored into the memory when it fills up, when the file
+	   jumps to a new address, and at the end. */
+      stride = (wwid+31)/32;
+      words = calloc(READMEM_BLOCK*stride, sizeof(s_vpi_vecval));
+      block_cnt = 0;
+      block_addr = start_addr;
 
-      /* Configure the readmem lexer */
-      if (strcmp(name,"$readmemb") == 0)
-	  sys_readmem_start_file(file, 1, wwid, value.value.vector);
-      else
-	  sys_readmem_start_file(file, 0, wwid, value.value.vector);
+      scan.cur = text;
+      scan.end = text + text_len;
+      scan.bin_flag = strcmp(name,"$readmemb") == 0;
+      scan.wwid = wwid;
 
       /*======================================== Read memory file */
 
       /* Run through the input file and store the new contents in the memory */
       addr = start_addr;
-      while ((code = readmemlex()) != 0) {
+      while ((code = readmem_scan_next(&scan, words+block_cnt*stride)) != 0) {
 	  switch (code) {
 	  case MEM_ADDRESS:
-	      addr = value.value.vector->aval;
+	      readmem_store(mitem, block_addr, addr_incr, block_cnt,
+	                    stride, words);
+	      block_cnt = 0;
+	      addr = scan.addr;
 	      if (addr < min_addr || addr > max_addr) {
 		  vpi_printf("ERROR: %s:%d: ", vpi_get_str(vpiFile, callh),
 		             (int)vpi_get(vpiLineNo, callh));
@@ -359,13 +578,19 @@ static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 
 	  case MEM_WORD:
 	      if (addr >= min_addr && addr <= max_addr) {
-		  vpiHandle word_index;
-		  word_index = vpi_handle_by_index(mitem, addr);
-		  assert(word_index);
-		  vpi_put_value(word_index, &value, 0, vpiNoDelay);
+		  if (block_cnt == 0) block_addr = addr;
+		  block_cnt += 1;
+		  if (block_cnt == READMEM_BLOCK) {
+			readmem_store(mitem, block_addr, addr_incr, block_cnt,
+			              stride, words);
+			block_cnt = 0;
+		  }
 
 		  if (word_count > 0) word_count -= 1;
 	      } else {
+		  readmem_store(mitem, block_addr, addr_incr, block_cnt,
+		                stride, words);
+		  block_cnt = 0;
 		  vpi_printf("WARNING: %s:%d: ", vpi_get_str(vpiFile, callh),
 		             (int)vpi_get(vpiLineNo, callh));
 		  vpi_printf("%s(%s): Too many words in the file for the "
@@ -378,10 +603,13 @@ static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	      break;
 
 	  case MEM_ERROR:
+	      readmem_store(mitem, block_addr, addr_incr, block_cnt,
+	                    stride, words);
+	      block_cnt = 0;
 	      vpi_printf("ERROR: %s:%d: ", vpi_get_str(vpiFile, callh),
 	                 (int)vpi_get(vpiLineNo, callh));
 	      vpi_printf("%s(%s): Invalid input character: %s\n", name,
-	                 fname, readmem_error_token);
+	                 fname, scan.error_token);
 	      goto bailout;
 	      break;
 
@@ -391,6 +619,8 @@ static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	  }
       }
 
+      readmem_store(mitem, block_addr, addr_incr, block_cnt, stride, words);
+
 	/* Print a warning if there are not enough words in the data file. */
       if (word_count > 0) {
 	    vpi_printf("WARNING: %s:%d: ", vpi_get_str(vpiFile, callh),
@@ -401,10 +631,9 @@ static PLI_INT32 sys_readmem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       }
 
  bailout:
-      free(value.value.vector);
+      free(words);
+      free(text);
       free(fname);
-      fclose(file);
-      destroy_readmem_lexor();
       return 0;
 }
 
@@ -507,13 +736,50 @@ static PLI_INT32 sys_readmempath_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       return 0;
 }
 
+/*
+ * Format a word for $writemem in the manner of the vpiHexStrVal and
+ * vpiBinStrVal formats. A partial most significant hex digit is x or
+ * z if all its bits are, and mixed hex digits are X or Z.
+ */
+static char *writemem_format(char*cp, const struct t_vpi_vecval*vec,
+                             unsigned wwid, int bin_flag)
+{
+      unsigned pos;
+
+      if (bin_flag) {
+	    cp += wwid;
+	    for (pos = 0 ;  pos < wwid ;  pos += 1) {
+		  unsigned aval = (vec[pos/32].aval >> (pos%32)) & 1;
+		  unsigned bval = (vec[pos/32].bval >> (pos%32)) & 1;
+		  *--cp = "01zx"[aval | (bval<<1)];
+	    }
+	    return cp + wwid;
+      }
+
+      cp += (wwid+3)/4;
+      for (pos = 0 ;  pos < wwid ;  pos += 4) {
+	    unsigned aval = ((PLI_UINT32)vec[pos/32].aval >> (pos%32)) & 15;
+	    unsigned bval = ((PLI_UINT32)vec[pos/32].bval >> (pos%32)) & 15;
+	    unsigned mask = pos+4 > wwid? (1U << (wwid-pos)) - 1 : 15;
+	    aval &= mask;
+	    bval &= mask;
+	    if (bval == 0) *--cp = "0123456789abcdef"[aval];
+	    else if (bval == mask && aval == mask) *--cp = 'x';
+	    else if (bval == mask && aval == 0) *--cp = 'z';
+	    else if (aval & bval) *--cp = 'X';
+	    else *--cp = 'Z';
+      }
+      return cp + (wwid+3)/4;
+}
+
 static PLI_INT32 sys_writemem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
-      int addr;
+      int addr, wwid, bin_flag;
       FILE*file;
       char*fname = 0;
-      unsigned cnt;
-      s_vpi_value value;
+      unsigned cnt, stride, line_len;
+      struct t_vpi_vecval*words;
+      char*text;
       vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
       vpiHandle argv = vpi_iterate(vpiArgument, callh);
       vpiHandle mitem = 0;
@@ -549,23 +815,55 @@ static PLI_INT32 sys_writemem_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	    return 0;
       }
 
-      if (strcmp(name,"$writememb")==0) value.format = vpiBinStrVal;
-      else value.format = vpiHexStrVal;
+      bin_flag = strcmp(name,"$writememb") == 0;
+      wwid = vpi_get(vpiSize, vpi_handle_by_index(mitem, min_addr));
+      stride = (wwid+31)/32;
+      line_len = (bin_flag? wwid : (wwid+3)/4) + 1;
 
       /*======================================== Write memory file */
 
+	/* Fetch and format the words a block at a time, and write
+	   each block of text to the file in one go. */
+      words = calloc(READMEM_BLOCK*stride, sizeof(s_vpi_vecval));
+      text = malloc(READMEM_BLOCK*line_len + (READMEM_BLOCK/16)*14);
+
       cnt = 0;
-      for(addr=start_addr; addr!=stop_addr+addr_incr; addr+=addr_incr, ++cnt) {
-	  vpiHandle word_index;
+      addr = start_addr;
+      while (addr != stop_addr+addr_incr) {
+	  unsigned idx, count = (stop_addr - addr)*addr_incr + 1;
+	  char*cp = text;
+
+	  if (count > READMEM_BLOCK) count = READMEM_BLOCK;
+
+	  if (! vpip_get_array_words(mitem, addr, addr_incr, count, words)) {
+		s_vpi_value value;
+		value.format = vpiVectorVal;
+		for (idx = 0 ;  idx < count ;  idx += 1) {
+		      vpiHandle word_index;
+		      word_index = vpi_handle_by_index(mitem,
+		                                       addr+(int)idx*addr_incr);
+		      assert(word_index);
+		      vpi_get_value(word_index, &value);
+		      memcpy(words+idx*stride, value.value.vector,
+		             stride*sizeof(s_vpi_vecval));
+		}
+	  }
 
-	  if (cnt%16 == 0) fprintf(file, "// 0x%08x\n", cnt);
+	  for (idx = 0 ;  idx < count ;  idx += 1, ++cnt) {
+		if (cnt%16 == 0) {
+		      sprintf(cp, "// 0x%08x\n", cnt);
+		      cp += strlen(cp);
+		}
+		cp = writemem_format(cp, words+idx*stride, wwid, bin_flag);
+		*cp++ = '\n';
+	  }
 
-	  word_index = vpi_handle_by_index(mitem, addr);
-	  assert(word_index);
-	  vpi_get_value(word_index, &value);
-	  fprintf(file, "%s\n", value.value.str);
+	  fwrite(text, 1, cp-text, file);
+	  addr += (int)count*addr_incr;
       }
 
+      free(text);
+      free(words);
       fclose(file);
       free(fname);
       return 0;
@@ -27,18 +27,43 @@
 # include  <stdio.h>
 # include  <stdlib.h>
 # include  <string.h>
+# include  <stdarg.h>
 # include  <assert.h>
 # include  <time.h>
+#ifdef HAVE_LIBZ
+# include  <zlib.h>
+#endif
 # include  "ivl_alloc.h"
 
 static char *dump_path = NULL;
+
+/*
+ * The dump is formatted into dump_buf, and the buffer is written out
+ * only when it fills up, on $dumpflush and at the end of the
+ * simulation. The value changes are formatted straight from the
+ * vector words, so the common path makes no stdio calls at all. If
+ * the dump file name ends in .gz, the output is compressed with zlib
+ * as it is written.
+ */
+#define DUMP_BUF_SIZE (256*1024)
+
+static int dump_is_open = 0;
 static FILE *dump_file = NULL;
+#ifdef HAVE_LIBZ
+static gzFile dump_gz = NULL;
+#endif
+static char *dump_buf = NULL;
+static size_t dump_buf_used = 0;
+  /* This is the number of (uncompressed) bytes in the dump so far,
+     for the $dumplimit check. */
+static PLI_UINT64 dump_bytes = 0;
 
 struct vcd_info {
       vpiHandle item;
       vpiHandle cb;
       struct t_vpi_time time;
       const char *ident;
+      unsigned ident_len;
       struct vcd_info *next;
       struct vcd_info *dmp_next;
       int scheduled;
@@ -47,6 +72,7 @@ struct vcd_info {
 
 static struct vcd_info *vcd_list = NULL;
 static struct vcd_info *vcd_dmp_list = NULL;
+static vpip_dump_t vcd_dump = 0;
 static PLI_UINT64 vcd_cur_time = 0;
 static int dump_is_off = 0;
 static long dump_limit = 0;
@@ -63,40 +89,266 @@ static const char*units_names[] = {
       "fs"
 };
 
-static char vcdid[8] = "!";
+static void dump_write_buf(void)
+{
+      if (dump_buf_used == 0) return;
+#ifdef HAVE_LIBZ
+      if (dump_gz) {
+	    gzwrite(dump_gz, dump_buf, (unsigned)dump_buf_used);
+	    dump_buf_used = 0;
+	    return;
+      }
+#endif
+      fwrite(dump_buf, 1, dump_buf_used, dump_file);
+      dump_buf_used = 0;
+}
+
+/*
+ * Make room for at least len bytes in the buffer, and return a
+ * pointer to the free space. The len must be no more than the
+ * buffer size. The caller must call dump_commit() with the number of
+ * bytes actually used.
+ */
+__inline__ static char *dump_reserve(size_t len)
+{
+      assert(len <= DUMP_BUF_SIZE);
+      if (dump_buf_used + len > DUMP_BUF_SIZE) dump_write_buf();
+      return dump_buf + dump_buf_used;
+}
 
-static void gen_new_vcd_id(void)
+__inline__ static void dump_commit(size_t len)
 {
-      static unsigned value = 0;
-      unsigned v = ++value;
-      unsigned int i;
+      dump_buf_used += len;
+      dump_bytes += len;
+}
 
-      for (i=0; i < sizeof(vcdid)-1; i++) {
-           vcdid[i] = (char)((v%94)+33); /* for range 33..126 */
-           v /= 94;
-           if(!v) {
-                 vcdid[i+1] = '\0';
-                 return;
-           }
+static void dump_printf(const char *fmt, ...)
+{
+      va_list ap;
+      size_t avail;
+      int len;
+
+      va_start(ap, fmt);
+      avail = DUMP_BUF_SIZE - dump_buf_used;
+      len = vsnprintf(dump_buf + dump_buf_used, avail, fmt, ap);
+      va_end(ap);
+      assert(len >= 0);
+
+	/* If it did not fit, write out what is buffered and try
+	   again. Nothing we print here comes near the size of the
+	   whole buffer. */
+      if ((size_t)len >= avail) {
+	    dump_write_buf();
+	    va_start(ap, fmt);
+	    len = vsnprintf(dump_buf, DUMP_BUF_SIZE, fmt, ap);
+	    va_end(ap);
+	    assert(len >= 0 && len < DUMP_BUF_SIZE);
       }
-	// This should never happen since 94**7 is a lot if identifiers!
-      assert(0);
+
+      dump_commit(len);
 }
 
-static char *truncate_bitvec(char *s)
+static int dump_open(const char *path)
 {
-      char r;
+      size_t plen = strlen(path);
+
+      if (plen > 3 && strcmp(path+plen-3, ".gz") == 0) {
+#ifdef HAVE_LIBZ
+	      /* Use the fastest compression level. The dump is
+	       * usually large and the simulation should not wait
+	       * for the compressor. */
+	    dump_gz = gzopen(path, "wb1");
+	    if (dump_gz == 0) return 0;
+#else
+	    vpi_printf("VCD warning: zlib is not available, %s will not "
+	               "be compressed.\n", path);
+	    dump_file = fopen(path, "w");
+	    if (dump_file == 0) return 0;
+#endif
+      } else {
+	    dump_file = fopen(path, "w");
+	    if (dump_file == 0) return 0;
+      }
 
-      r=*s;
-      if(r=='1') return s;
-      else s += 1;
+      dump_buf = malloc(DUMP_BUF_SIZE);
+      dump_buf_used = 0;
+      dump_bytes = 0;
+      dump_is_open = 1;
+      return 1;
+}
 
-      for(;;s++) {
-	    char l;
-	    l=r; r=*s;
-	    if(!r) return (s-1);
-	    if(l!=r) return(((l=='0')&&(r=='1'))?s:s-1);
+static void dump_flush(void)
+{
+      dump_write_buf();
+#ifdef HAVE_LIBZ
+      if (dump_gz) {
+	    gzflush(dump_gz, Z_SYNC_FLUSH);
+	    return;
       }
+#endif
+      fflush(dump_file);
+}
+
+static void dump_close(void)
+{
+      dump_write_buf();
+#ifdef HAVE_LIBZ
+      if (dump_gz) {
+	    gzclose(dump_gz);
+	    dump_gz = 0;
+      }
+#endif
+      if (dump_file) {
+	    fclose(dump_file);
+	    dump_file = 0;
+      }
+      free(dump_buf);
+      dump_buf = 0;
+      dump_is_open = 0;
+}
+
+/* Write the "#<time>" line that starts each time step. */
+static void dump_time(PLI_UINT64 now)
+{
+      char tmp[24];
+      char *cp = tmp + sizeof(tmp);
+      size_t len;
+      char *buf;
+
+      *--cp = '\n';
+      do {
+	    *--cp = (char)('0' + now%10);
+	    now /= 10;
+      } while (now);
+      *--cp = '#';
+
+      len = tmp + sizeof(tmp) - cp;
+      buf = dump_reserve(len);
+      memcpy(buf, cp, len);
+      dump_commit(len);
+}
+
+/*
+ * The identifiers are the numbers 0, 1, 2... written in base 94 with
+ * the printable characters '!' to '~' for the digits, least
+ * significant digit first.
+ */
+static unsigned vcd_id_count = 0;
+
+static char *gen_new_vcd_id(void)
+{
+      char tmp[8];
+      unsigned v = vcd_id_count++;
+      unsigned len = 0;
+      char *res;
+
+      do {
+	    assert(len < sizeof(tmp));
+	    tmp[len++] = (char)((v%94)+33); /* for range 33..126 */
+	    v /= 94;
+      } while (v);
+
+      res = malloc(len+1);
+      memcpy(res, tmp, len);
+      res[len] = 0;
+      return res;
+}
+
+/* Get a bit out of a vpiVectorVal value, as an index into the
+ * bit_chars table below. */
+__inline__ static unsigned vecval_bit(const s_vpi_vecval *vec, unsigned idx)
+{
+      unsigned a = (vec[idx/32].aval >> (idx%32)) & 1;
+      unsigned b = (vec[idx/32].bval >> (idx%32)) & 1;
+      return (b << 1) | a;
+}
+
+/* Indexed by the bval bit and the aval bit. */
+static const char bit_chars[4] = { '0', '1', 'z', 'x' };
+
+/*
+ * VCD allows the leading bits of a vector value to be left out. A
+ * value that starts with 0, x or z is extended to the left with that
+ * bit, except a leading run of 0 bits can be dropped entirely if it
+ * is followed by a 1. Return the number of bits to write, counting
+ * from the LSB. This skips a word at a time where it can.
+ */
+static unsigned vecval_trimmed_size(const s_vpi_vecval *vec, unsigned size)
+{
+      unsigned top = vecval_bit(vec, size-1);
+      unsigned idx;
+      PLI_INT32 aword, bword;
+
+      if (top == 1) return size;
+
+      aword = (top & 1)? -1 : 0;
+      bword = (top & 2)? -1 : 0;
+
+	/* Find the most significant bit that is not the same as the
+	   top bit. */
+      idx = size - 1;
+      while (idx > 0) {
+	    unsigned word = (idx-1) / 32;
+	    if ((idx % 32) == 0 && vec[word].aval == aword
+	        && vec[word].bval == bword) {
+		  idx -= 32;
+		  continue;
+	    }
+	    if (vecval_bit(vec, idx-1) != top) break;
+	    idx -= 1;
+      }
+
+	/* They are all the same, so a single bit will do. */
+      if (idx == 0) return 1;
+
+	/* Leading zeros can all go in front of a 1. */
+      if (top == 0 && vecval_bit(vec, idx-1) == 1) return idx;
+
+      return idx + 1;
+}
+
+/* Write the value of a vector, then the identifier. */
+static void dump_vector(const s_vpi_vecval *vec, unsigned size,
+                        const struct vcd_info *info)
+{
+      unsigned bits = vecval_trimmed_size(vec, size);
+      char *buf = dump_reserve(1);
+
+      buf[0] = 'b';
+      dump_commit(1);
+
+	/* Very wide vectors may not fit in the buffer all at once, so
+	   write the bits a buffer full at a time. */
+      while (bits > 0) {
+	    size_t avail = DUMP_BUF_SIZE - dump_buf_used;
+	    unsigned cnt, idx;
+	    if (avail == 0) {
+		  dump_write_buf();
+		  avail = DUMP_BUF_SIZE;
+	    }
+	    cnt = bits < avail? bits : (unsigned)avail;
+	    buf = dump_buf + dump_buf_used;
+	    for (idx = 0 ;  idx < cnt ;  idx += 1)
+		  buf[idx] = bit_chars[vecval_bit(vec, bits-idx-1)];
+	    dump_commit(cnt);
+	    bits -= cnt;
+      }
+
+      buf = dump_reserve(info->ident_len + 2);
+      buf[0] = ' ';
+      memcpy(buf+1, info->ident, info->ident_len);
+      buf[info->ident_len+1] = '\n';
+      dump_commit(info->ident_len + 2);
+}
+
+/* Write a scalar value, then the identifier. */
+static void dump_scalar(char bit, const struct vcd_info *info)
+{
+      char *buf = dump_reserve(info->ident_len + 2);
+      buf[0] = bit;
+      memcpy(buf+1, info->ident, info->ident_len);
+      buf[info->ident_len+1] = '\n';
+      dump_commit(info->ident_len + 2);
 }
 
 static void show_this_item(struct vcd_info*info)
@@ -107,18 +359,34 @@ static void show_this_item(struct vcd_info*info)
       if (type == vpiRealVar) {
 	    value.format = vpiRealVal;
 	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "r%.16g %s\n", value.value.real, info->ident);
+	    dump_printf("r%.16g %s\n", value.value.real, info->ident);
       } else if (type == vpiNamedEvent) {
-	    fprintf(dump_file, "1%s\n", info->ident);
-      } else if (vpi_get(vpiSize, info->item) == 1) {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "%s%s\n", value.value.str, info->ident);
+	    dump_scalar('1', info);
       } else {
-	    value.format = vpiBinStrVal;
+	    unsigned size = vpi_get(vpiSize, info->item);
+	    value.format = vpiVectorVal;
 	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "b%s %s\n", truncate_bitvec(value.value.str),
-		    info->ident);
+	    if (size == 1)
+		  dump_scalar(bit_chars[vecval_bit(value.value.vector, 0)],
+		              info);
+	    else
+		  dump_vector(value.value.vector, size, info);
+      }
+}
+
+/* Dump a value from a batch of value changes. */
+static void show_this_change(p_vpip_dump_change chg)
+{
+      struct vcd_info*info = (struct vcd_info*)chg->user_data;
+
+      if (chg->type == vpiRealVar) {
+	    dump_printf("r%.16g %s\n", chg->real, info->ident);
+      } else if (chg->type == vpiNamedEvent) {
+	    dump_scalar('1', info);
+      } else if (chg->size == 1) {
+	    dump_scalar(bit_chars[vecval_bit(chg->vector, 0)], info);
+      } else {
+	    dump_vector(chg->vector, chg->size, info);
       }
 }
 
@@ -129,13 +397,13 @@ static void show_this_item_x(struct vcd_info*info)
 
       if (type == vpiRealVar) {
 	      /* Some tools dump nothing here...? */
-	    fprintf(dump_file, "rNaN %s\n", info->ident);
+	    dump_printf("rNaN %s\n", info->ident);
       } else if (type == vpiNamedEvent) {
 	    /* Do nothing for named events. */
       } else if (vpi_get(vpiSize, info->item) == 1) {
-	    fprintf(dump_file, "x%s\n", info->ident);
+	    dump_scalar('x', info);
       } else {
-	    fprintf(dump_file, "bx %s\n", info->ident);
+	    dump_printf("bx %s\n", info->ident);
       }
 }
 
@@ -175,13 +443,51 @@ static void vcd_checkpoint_x(void)
 	    show_this_item_x(cur);
 }
 
+/*
+ * Most signals are traced through the batch value change interface
+ * of the run time, which records the changes with no callbacks. The
+ * batch is only enabled while the changes would be dumped.
+ */
+static void vcd_dump_enable(void)
+{
+      if (vcd_dump == 0) return;
+      vpip_dump_enable(vcd_dump, !dump_is_full && !dump_is_off &&
+			         !dump_header_pending() && !finish_status);
+}
+
+static void vcd_dump_changes(PLI_UINT64 now, p_vpip_dump_change changes,
+			     unsigned count, void*cd)
+{
+      unsigned idx;
+
+      (void)cd; /* Parameter is not used. */
+
+      if ((dump_limit > 0) && (dump_bytes > (PLI_UINT64)dump_limit)) {
+            dump_is_full = 1;
+            vcd_dump_enable();
+            vpi_printf("WARNING: Dump file limit (%ld bytes) "
+                               "exceeded.\n", dump_limit);
+            dump_printf("$comment Dump file limit (%ld bytes) "
+                        "exceeded. $end\n", dump_limit);
+            return;
+      }
+
+      if (now != vcd_cur_time) {
+	    dump_time(now);
+	    vcd_cur_time = now;
+      }
+
+      for (idx = 0 ;  idx < count ;  idx += 1)
+	    show_this_change(changes+idx);
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       struct vcd_info* info = vcd_dmp_list;
       PLI_UINT64 now = timerec_to_time64(cause->time);
 
       if (now != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now);
+	    dump_time(now);
 	    vcd_cur_time = now;
       }
 
@@ -205,12 +511,13 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       if (dump_header_pending()) return 0;
       if (info->scheduled) return 0;
 
-      if ((dump_limit > 0) && (ftell(dump_file) > dump_limit)) {
+      if ((dump_limit > 0) && (dump_bytes > (PLI_UINT64)dump_limit)) {
             dump_is_full = 1;
+            vcd_dump_enable();
             vpi_printf("WARNING: Dump file limit (%ld bytes) "
                                "exceeded.\n", dump_limit);
-            fprintf(dump_file, "$comment Dump file limit (%ld bytes) "
-                               "exceeded. $end\n", dump_limit);
+            dump_printf("$comment Dump file limit (%ld bytes) "
+                        "exceeded. $end\n", dump_limit);
             return 0;
       }
 
@@ -233,17 +540,18 @@ static PLI_INT32 dumpvars_cb(p_cb_data cause)
       if (dumpvars_status != 1) return 0;
 
       dumpvars_status = 2;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
       vcd_cur_time = dumpvars_time;
 
-      fprintf(dump_file, "$enddefinitions $end\n");
+      dump_printf("$enddefinitions $end\n");
 
       if (!dump_is_off) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
-	    fprintf(dump_file, "$dumpvars\n");
+	    dump_time(dumpvars_time);
+	    dump_printf("$dumpvars\n");
 	    vcd_checkpoint();
-	    fprintf(dump_file, "$end\n");
+	    dump_printf("$end\n");
       }
 
       return 0;
@@ -256,14 +564,15 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       if (finish_status != 0) return 0;
 
       finish_status = 1;
+      vcd_dump_enable();
 
       dumpvars_time = timerec_to_time64(cause->time);
 
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
+	    dump_time(dumpvars_time);
       }
 
-      fclose(dump_file);
+      dump_close();
 
       for (cur = vcd_list ;  cur ;  cur = next) {
 	    next = cur->next;
@@ -322,8 +631,9 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (dump_is_off) return 0;
 
       dump_is_off = 1;
+      vcd_dump_enable();
 
-      if (dump_file == 0) return 0;
+      if (!dump_is_open) return 0;
       if (dump_header_pending()) return 0;
 
       now.type = vpiSimTime;
@@ -331,13 +641,13 @@ static PLI_INT32 sys_dumpoff_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    dump_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpoff\n");
+      dump_printf("$dumpoff\n");
       vcd_checkpoint_x();
-      fprintf(dump_file, "$end\n");
+      dump_printf("$end\n");
 
       return 0;
 }
@@ -352,8 +662,9 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       if (!dump_is_off) return 0;
 
       dump_is_off = 0;
+      vcd_dump_enable();
 
-      if (dump_file == 0) return 0;
+      if (!dump_is_open) return 0;
       if (dump_header_pending()) return 0;
 
       now.type = vpiSimTime;
@@ -361,13 +672,13 @@ static PLI_INT32 sys_dumpon_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    dump_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpon\n");
+      dump_printf("$dumpon\n");
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      dump_printf("$end\n");
 
       return 0;
 }
@@ -380,7 +691,7 @@ static PLI_INT32 sys_dumpall_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       (void)name; /* Parameter is not used. */
 
       if (dump_is_off) return 0;
-      if (dump_file == 0) return 0;
+      if (!dump_is_open) return 0;
       if (dump_header_pending()) return 0;
 
       now.type = vpiSimTime;
@@ -388,13 +699,13 @@ static PLI_INT32 sys_dumpall_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    dump_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpall\n");
+      dump_printf("$dumpall\n");
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      dump_printf("$end\n");
 
       return 0;
 }
@@ -403,9 +714,7 @@ static void open_dumpfile(vpiHandle callh)
 {
       if (dump_path == 0) dump_path = strdup("dump.vcd");
 
-      dump_file = fopen(dump_path, "w");
-
-      if (dump_file == 0) {
+      if (!dump_open(dump_path)) {
 	    vpi_printf("VCD Error: %s:%d: ", vpi_get_str(vpiFile, callh),
 	               (int)vpi_get(vpiLineNo, callh));
 	    vpi_printf("Unable to open %s for output.\n", dump_path);
@@ -434,15 +743,15 @@ static void open_dumpfile(vpiHandle callh)
 		  prec -= 1;
 	    }
 
-	    fprintf(dump_file, "$date\n");
-	    fprintf(dump_file, "\t%s",asctime(localtime(&walltime)));
-	    fprintf(dump_file, "$end\n");
-	    fprintf(dump_file, "$version\n");
-	    fprintf(dump_file, "\tIcarus Verilog\n");
-	    fprintf(dump_file, "$end\n");
-	    fprintf(dump_file, "$timescale\n");
-	    fprintf(dump_file, "\t%u%s\n", scale, units_names[udx]);
-	    fprintf(dump_file, "$end\n");
+	    dump_printf("$date\n");
+	    dump_printf("\t%s",asctime(localtime(&walltime)));
+	    dump_printf("$end\n");
+	    dump_printf("$version\n");
+	    dump_printf("\tIcarus Verilog\n");
+	    dump_printf("$end\n");
+	    dump_printf("$timescale\n");
+	    dump_printf("\t%u%s\n", scale, units_names[udx]);
+	    dump_printf("$end\n");
       }
 }
 
@@ -484,7 +793,7 @@ static PLI_INT32 sys_dumpfile_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 static PLI_INT32 sys_dumpflush_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 {
       (void)name; /* Parameter is not used. */
-      if (dump_file) fflush(dump_file);
+      if (dump_is_open) dump_flush();
 
       return 0;
 }
@@ -632,31 +941,39 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 	    if (nexus_id) ident = find_nexus_ident(nexus_id);
 
 	    if (!ident) {
-		  ident = strdup(vcdid);
-		  gen_new_vcd_id();
+		  ident = gen_new_vcd_id();
 
 		  if (nexus_id) set_nexus_ident(nexus_id, ident);
 
-		    /* Add a callback for the signal. */
+		    /* Add the signal to the batch, or a callback for
+		     * the signal if it cannot be batched. */
 		  info = malloc(sizeof(*info));
 
 		  info->time.type = vpiSimTime;
 		  info->item  = item;
 		  info->ident = ident;
+		  info->ident_len = strlen(ident);
 		  info->scheduled = 0;
 
-		  cb.time      = &info->time;
-		  cb.user_data = (char*)info;
-		  cb.value     = NULL;
-		  cb.obj       = item;
-		  cb.reason    = cbValueChange;
-		  cb.cb_rtn    = variable_cb_1;
-
 		  info->dmp_next = 0;
 		  info->next  = vcd_list;
 		  vcd_list    = info;
 
-		  info->cb    = vpi_register_cb(&cb);
+		  if (vcd_dump == 0)
+			vcd_dump = vpip_dump_create(vcd_dump_changes, 0);
+
+		  if (vpip_dump_add(vcd_dump, item, info)) {
+			info->cb = 0;
+		  } else {
+			cb.time      = &info->time;
+			cb.user_data = (char*)info;
+			cb.value     = NULL;
+			cb.obj       = item;
+			cb.reason    = cbValueChange;
+			cb.cb_rtn    = variable_cb_1;
+
+			info->cb = vpi_register_cb(&cb);
+		  }
 	    }
 
 	      /* Named events do not have a size, but other tools use
@@ -665,17 +982,17 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 	    if (item_type == vpiNamedEvent) size = 1;
 	    else size = vpi_get(vpiSize, item);
 
-	    fprintf(dump_file, "$var %s %u %s %s%s",
-		    type, size, ident, prefix, name);
+	    dump_printf("$var %s %u %s %s%s",
+			type, size, ident, prefix, name);
 
 	      /* Add a range for vectored values. */
 	    if (size > 1 || vpi_get(vpiLeftRange, item) != 0) {
-		  fprintf(dump_file, " [%i:%i]",
-			  (int)vpi_get(vpiLeftRange, item),
-			  (int)vpi_get(vpiRightRange, item));
+		  dump_printf(" [%i:%i]",
+			      (int)vpi_get(vpiLeftRange, item),
+			      (int)vpi_get(vpiRightRange, item));
 	    }
 
-	    fprintf(dump_file, " $end\n");
+	    dump_printf(" $end\n");
 	    break;
 
 	  case vpiModule:
@@ -716,7 +1033,7 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		  }
 
 		  name = vpi_get_str(vpiName, item);
-		  fprintf(dump_file, "$scope %s %s $end\n", type, name);
+		  dump_printf("$scope %s %s $end\n", type, name);
 
 		  for (i=0; types[i]>0; i++) {
 			vpiHandle hand;
@@ -727,7 +1044,7 @@ static void scan_item(unsigned depth, vpiHandle item, int skip)
 		  }
 
 		    /* Sort any signals that we added above. */
-		  fprintf(dump_file, "$upscope $end\n");
+		  dump_printf("$upscope $end\n");
 	    }
 	    break;
       }
@@ -761,7 +1078,7 @@ static int draw_scope(vpiHandle item, vpiHandle callh)
             assert(0);
       }
 
-      fprintf(dump_file, "$scope %s %s $end\n", type, name);
+      dump_printf("$scope %s %s $end\n", type, name);
 
       return depth;
 }
@@ -776,9 +1093,9 @@ static PLI_INT32 sys_dumpvars_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 
       (void)name; /* Parameter is not used. */
 
-      if (dump_file == 0) {
+      if (!dump_is_open) {
 	    open_dumpfile(callh);
-	    if (dump_file == 0) {
+	    if (!dump_is_open) {
 		  if (argv) vpi_free_object(argv);
 		  return 0;
 	    }
@@ -854,7 +1171,7 @@ static PLI_INT32 sys_dumpvars_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	      /* The scope list must be sorted after we scan an item.  */
 	    vcd_names_sort(&vcd_tab);
 
-	    while (dep--) fprintf(dump_file, "$upscope $end\n");
+	    while (dep--) dump_printf("$upscope $end\n");
 
 	      /* Add this signal to the variable list so we can verify it
 	       * is not included twice. This must be done after it has
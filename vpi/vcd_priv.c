@@ -130,6 +130,31 @@ void vcd_names_sort(struct vcd_names_list_s*tab)
       }
 }
 
+char*vcd_vecval_to_binstr(const s_vpi_vecval*vec, unsigned size)
+{
+	/* Indexed by the bval bit and the aval bit. */
+      static const char bit_chars[4] = { '0', '1', 'z', 'x' };
+      static char*buf = 0;
+      static unsigned buf_size = 0;
+      unsigned idx;
+      char*cp;
+
+      if (size+1 > buf_size) {
+	    buf_size = size+1;
+	    buf = (char*)realloc(buf, buf_size);
+      }
+
+      cp = buf + size;
+      *cp = 0;
+      for (idx = 0 ;  idx < size ;  idx += 1) {
+	    PLI_INT32 a = vec[idx/32].aval >> (idx%32);
+	    PLI_INT32 b = vec[idx/32].bval >> (idx%32);
+	    *--cp = bit_chars[((b&1) << 1) | (a&1)];
+      }
+
+      return buf;
+}
+
 /*
  * Since the compiletf routines are all the same they are located here,
  * so we only need a single copy. Some are generic enough they can use
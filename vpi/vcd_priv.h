@@ -55,6 +55,13 @@ EXTERN void       set_nexus_ident(int nex, const char *id);
 
 EXTERN void nexus_ident_delete(void);
 
+/*
+ * Format a vector value from a batch value change (see vpip_dump_add)
+ * as a string of 0, 1, x and z characters, MSB first. The result is
+ * kept in a buffer that is reused by the next call.
+ */
+EXTERN char*vcd_vecval_to_binstr(const s_vpi_vecval*vec, unsigned size);
+
 /*
  * Keep a set of scope names to help with duplicate detection.
  */
@@ -636,6 +636,57 @@ extern void vpip_make_systf_system_defined(vpiHandle ref);
 extern void vpip_count_drivers(vpiHandle ref, unsigned idx,
                                unsigned counts[4]);
 
+  /* Batch value change collection for the waveform dumpers. A dumper
+     creates a dump with vpip_dump_create(), then adds each signal it
+     traces with vpip_dump_add(). The run time marks the signals that
+     change during a time step, and in the read-only synch phase of
+     the step passes the new values of all the changed signals to the
+     dump routine in a single call. Each change carries the user_data
+     given to vpip_dump_add() and the vpiType of the object. A
+     vpiRealVar has its value in real, a vpiNamedEvent has no value,
+     and the others have a vector of size bits in the vpiVectorVal
+     encoding. The changes are passed most recent first, and the
+     values are only valid for the duration of the call.
+
+     vpip_dump_add() returns 0 if the object cannot be traced this way,
+     in which case the dumper should use a cbValueChange callback
+     instead. While a dump is disabled with vpip_dump_enable(), changes
+     are not recorded. A new dump starts out disabled. */
+typedef struct t_vpip_dump_change {
+      void*user_data;
+      PLI_INT32 type;
+      PLI_INT32 size;
+      p_vpi_vecval vector;
+      double real;
+} s_vpip_dump_change, *p_vpip_dump_change;
+
+typedef void (*vpip_dump_rtn_t)(PLI_UINT64 time, p_vpip_dump_change changes,
+                                unsigned count, void*cd);
+typedef struct __vpip_dump*vpip_dump_t;
+
+extern vpip_dump_t vpip_dump_create(vpip_dump_rtn_t rtn, void*cd);
+extern PLI_INT32 vpip_dump_add(vpip_dump_t dump, vpiHandle obj,
+                               void*user_data);
+extern void vpip_dump_enable(vpip_dump_t dump, PLI_INT32 flag);
+
+  /* Bulk access to the words of a memory for $readmem and
+     $writemem. vpip_put_array_words() stores count words into the
+     memory ref starting at word index, and stepping the index by incr
+     (1 or -1) for each following word. The values are packed in the
+     vals array in the vpiVectorVal encoding, with (size+31)/32
+     elements for each word. The effect is the same as vpi_put_value()
+     of each word with vpiNoDelay. vpip_get_array_words() is the
+     reverse, and fills the vals array from the memory. Both return 0
+     without touching the memory if it is not a memory of vectors, in
+     which case the caller should access the words through their
+     handles instead. */
+extern PLI_INT32 vpip_put_array_words(vpiHandle ref, PLI_INT32 index,
+                                      PLI_INT32 incr, PLI_INT32 count,
+                                      const s_vpi_vecval*vals);
+extern PLI_INT32 vpip_get_array_words(vpiHandle ref, PLI_INT32 index,
+                                      PLI_INT32 incr, PLI_INT32 count,
+                                      p_vpi_vecval vals);
+
 /*
  * Stopgap fix for br916. We need to reject any attempt to pass a thread
  * variable to $strobe or $monitor. To do this, we use some private VPI
@@ -505,6 +505,17 @@ void vvp_arith_sum::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 
       vvp_net_t*net = ptr.ptr();
 
+	/* The operands are nearly always already the width of the
+	   output, so use the word-wise add of the vector. It makes
+	   the whole result X if there are any X or Z bits, just like
+	   the loop below. */
+      if (op_a_.size() == wid_ && op_b_.size() == wid_) {
+	    vvp_vector4_t value (op_a_);
+	    value.add(op_b_);
+	    net->send_vec4(value, 0);
+	    return;
+      }
+
       vvp_vector4_t value (wid_);
 
 	/* Pad input vectors with this value to widen to the desired
@@ -550,6 +561,17 @@ void vvp_arith_sub::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 
       vvp_net_t*net = ptr.ptr();
 
+	/* The operands are nearly always already the width of the
+	   output, so use the word-wise subtract of the vector. It makes
+	   the whole result X if there are any X or Z bits, just like
+	   the loop below. */
+      if (op_a_.size() == wid_ && op_b_.size() == wid_) {
+	    vvp_vector4_t value (op_a_);
+	    value.sub(op_b_);
+	    net->send_vec4(value, 0);
+	    return;
+      }
+
       vvp_vector4_t value (wid_);
 
 	/* Pad input vectors with this value to widen to the desired
@@ -583,15 +605,9 @@ void vvp_cmp_eeq::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 {
       dispatch_operand_(ptr, bit);
 
-      vvp_vector4_t eeq (1);
-      eeq.set_bit(0, BIT4_1);
-
       assert(op_a_.size() == op_b_.size());
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1)
-	    if (op_a_.value(idx) != op_b_.value(idx)) {
-		  eeq.set_bit(0, BIT4_0);
-		  break;
-	    }
+      vvp_vector4_t eeq (1);
+      eeq.set_bit(0, op_a_.eeq(op_b_)? BIT4_1 : BIT4_0);
 
 
       vvp_net_t*net = ptr.ptr();
@@ -608,15 +624,9 @@ void vvp_cmp_nee::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 {
       dispatch_operand_(ptr, bit);
 
-      vvp_vector4_t eeq (1);
-      eeq.set_bit(0, BIT4_0);
-
       assert(op_a_.size() == op_b_.size());
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1)
-	    if (op_a_.value(idx) != op_b_.value(idx)) {
-		  eeq.set_bit(0, BIT4_1);
-		  break;
-	    }
+      vvp_vector4_t eeq (1);
+      eeq.set_bit(0, op_a_.eeq(op_b_)? BIT4_0 : BIT4_1);
 
 
       vvp_net_t*net = ptr.ptr();
@@ -648,6 +658,15 @@ void vvp_cmp_eq::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       vvp_vector4_t res (1);
       res.set_bit(0, BIT4_1);
 
+	/* If neither operand has X or Z bits, this is the same as
+	   the case equality, which compares a word at a time. */
+      if (! op_a_.has_xz() && ! op_b_.has_xz()) {
+	    if (! op_a_.eeq(op_b_))
+		  res.set_bit(0, BIT4_0);
+	    ptr.ptr()->send_vec4(res, 0);
+	    return;
+      }
+
       for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1) {
 	    vvp_bit4_t a = op_a_.value(idx);
 	    vvp_bit4_t b = op_b_.value(idx);
@@ -773,6 +792,15 @@ void vvp_cmp_ne::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       vvp_vector4_t res (1);
       res.set_bit(0, BIT4_0);
 
+	/* If neither operand has X or Z bits, this is the same as
+	   the case equality, which compares a word at a time. */
+      if (! op_a_.has_xz() && ! op_b_.has_xz()) {
+	    if (! op_a_.eeq(op_b_))
+		  res.set_bit(0, BIT4_1);
+	    ptr.ptr()->send_vec4(res, 0);
+	    return;
+      }
+
       for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1) {
 	    vvp_bit4_t a = op_a_.value(idx);
 	    vvp_bit4_t b = op_b_.value(idx);
@@ -40,6 +40,7 @@ unsigned long count_net_arrays = 0;
 unsigned long count_net_array_words = 0;
 unsigned long count_var_arrays = 0;
 unsigned long count_var_array_words = 0;
+unsigned long count_var_arrays_sparse = 0;
 unsigned long count_real_arrays = 0;
 unsigned long count_real_array_words = 0;
 
@@ -674,6 +675,74 @@ vvp_vector4_t __vpiArray::get_word(unsigned address)
       return val;
 }
 
+/*
+ * These routines move a block of words in and out of a memory for
+ * the $readmem and $writemem system tasks. This is the same as a
+ * vpi_put_value() or vpi_get_value() of a vpiVectorVal to each word,
+ * but it does not make a word handle or go through the general value
+ * conversions for every word, which is where the time goes for big
+ * memories. Net, real and string arrays are not handled here, so the
+ * caller falls back to the word handles for those.
+ */
+static __vpiArray* vector_array_from_handle(vpiHandle ref)
+{
+      __vpiArray*arr = dynamic_cast<__vpiArray*>(ref);
+      if (arr == 0 || arr->nets != 0)
+	    return 0;
+      if (vpi_array_is_real(arr) || vpi_array_is_string(arr))
+	    return 0;
+      return arr;
+}
+
+extern "C" PLI_INT32 vpip_put_array_words(vpiHandle ref, PLI_INT32 index,
+                                          PLI_INT32 incr, PLI_INT32 count,
+                                          const s_vpi_vecval*vals)
+{
+      __vpiArray*arr = vector_array_from_handle(ref);
+      if (arr == 0)
+	    return 0;
+
+      unsigned wid = arr->vals_width;
+      unsigned stride = (wid + 31) / 32;
+      long addr = (long)index - arr->first_addr.get_value();
+
+	// The vector is reused for all the words, so there is no
+	// allocation per word for wide memories.
+      vvp_vector4_t val (wid, BIT4_0);
+      for (PLI_INT32 idx = 0 ; idx < count ; idx += 1, addr += incr) {
+	    if (addr < 0 || addr >= (long)arr->get_size())
+		  continue;
+	    val.set_vecval(vals + idx*stride);
+	    arr->set_word(addr, 0, val);
+      }
+
+      return 1;
+}
+
+extern "C" PLI_INT32 vpip_get_array_words(vpiHandle ref, PLI_INT32 index,
+                                          PLI_INT32 incr, PLI_INT32 count,
+                                          p_vpi_vecval vals)
+{
+      __vpiArray*arr = vector_array_from_handle(ref);
+      if (arr == 0)
+	    return 0;
+
+      unsigned wid = arr->vals_width;
+      unsigned stride = (wid + 31) / 32;
+      long addr = (long)index - arr->first_addr.get_value();
+
+      vvp_vector4_t out_of_range (wid, BIT4_X);
+      for (PLI_INT32 idx = 0 ; idx < count ; idx += 1, addr += incr) {
+	    if (addr < 0 || addr >= (long)arr->get_size()) {
+		  out_of_range.get_vecval(vals + idx*stride);
+		  continue;
+	    }
+	    arr->get_word(addr).get_vecval(vals + idx*stride);
+      }
+
+      return 1;
+}
+
 double __vpiArray::get_word_r(unsigned address)
 {
       if (vals) {
@@ -858,6 +927,12 @@ void compile_var_array(char*label, char*name, int last, int first,
       if (vpip_peek_current_scope()->is_automatic) {
             arr->vals4 = new vvp_vector4array_aa(arr->vals_width,
 						 arr->get_size());
+      } else if (arr->get_size() >= vvp_vector4array_sp::threshold) {
+	      /* Very large memories are usually only partly used, so
+		 only allocate the pages that are actually written. */
+            arr->vals4 = new vvp_vector4array_sp(arr->vals_width,
+						 arr->get_size());
+	    count_var_arrays_sparse += 1;
       } else {
             arr->vals4 = new vvp_vector4array_sa(arr->vals_width,
 						 arr->get_size());
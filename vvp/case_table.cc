@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "case_table.h"
+# include  <cassert>
+
+vvp_case_table::vvp_case_table(mode_t mode, unsigned wid, unsigned nitems)
+: mode_(mode), wid_(wid), nwords_((wid+31)/32),
+  items_(nwords_*nitems), dest_(nitems, 0), default_(0), built_(false)
+{
+}
+
+vvp_case_table::~vvp_case_table()
+{
+}
+
+void vvp_case_table::set_item(unsigned idx, const vvp_vector4_t&val)
+{
+      assert(idx < dest_.size());
+      assert(val.size() == wid_);
+      assert(! built_);
+      if (nwords_ > 0)
+	    val.get_vecval(&items_[idx*nwords_]);
+}
+
+/*
+ * Get the don't care bits of the value, one mask word for each value
+ * word. The encoding is the vpiVectorVal encoding, so z bits have
+ * only the bval bit set, and x bits have both bits set.
+ */
+void vvp_case_table::dont_care_(const s_vpi_vecval*val, uint32_t*mask) const
+{
+      for (unsigned idx = 0 ; idx < nwords_ ; idx += 1) {
+	    uint32_t aval = val[idx].aval;
+	    uint32_t bval = val[idx].bval;
+	    switch (mode_) {
+		case CASE:
+		  mask[idx] = 0;
+		  break;
+		case CASEZ:
+		  mask[idx] = bval & ~aval;
+		  break;
+		case CASEX:
+		  mask[idx] = bval;
+		  break;
+	    }
+      }
+}
+
+unsigned long vvp_case_table::hash_(const s_vpi_vecval*val,
+				    const uint32_t*mask) const
+{
+      unsigned long hash = 2166136261UL;
+      for (unsigned idx = 0 ; idx < nwords_ ; idx += 1) {
+	    hash = (hash ^ ((uint32_t)val[idx].aval & ~mask[idx])) * 16777619UL;
+	    hash = (hash ^ ((uint32_t)val[idx].bval & ~mask[idx])) * 16777619UL;
+      }
+      return hash ^ (hash >> 15);
+}
+
+bool vvp_case_table::match_(unsigned item, const s_vpi_vecval*val,
+			    const uint32_t*mask) const
+{
+      const s_vpi_vecval*ref = &items_[item*nwords_];
+      for (unsigned idx = 0 ; idx < nwords_ ; idx += 1) {
+	    uint32_t diff = (ref[idx].aval ^ val[idx].aval)
+		  | (ref[idx].bval ^ val[idx].bval);
+	    if (diff & ~mask[idx])
+		  return false;
+      }
+      return true;
+}
+
+/*
+ * Collect the items into groups that have the same don't care bits,
+ * then make the hash table for each group. An item that is equal to
+ * an earlier item of the group can never be the first match, so it is
+ * left out of the hash table.
+ */
+void vvp_case_table::build_groups_()
+{
+      std::vector<uint32_t> mask (nwords_);
+      std::vector<std::vector<unsigned> > members;
+
+      for (unsigned item = 0 ; item < dest_.size() ; item += 1) {
+	    dont_care_(&items_[item*nwords_], &mask[0]);
+
+	    size_t gdx = 0;
+	    while (gdx < groups_.size() && groups_[gdx].mask != mask)
+		  gdx += 1;
+
+	    if (gdx == groups_.size()) {
+		  groups_.push_back(group_s());
+		  groups_.back().mask = mask;
+		  groups_.back().first = item;
+		  members.push_back(std::vector<unsigned>());
+	    }
+	    members[gdx].push_back(item);
+      }
+
+      for (size_t gdx = 0 ; gdx < groups_.size() ; gdx += 1) {
+	    group_s&grp = groups_[gdx];
+	    size_t size = 4;
+	    while (size < 2*members[gdx].size())
+		  size *= 2;
+	    grp.slots.assign(size, 0);
+
+	    for (size_t mdx = 0 ; mdx < members[gdx].size() ; mdx += 1) {
+		  unsigned item = members[gdx][mdx];
+		  const s_vpi_vecval*val = &items_[item*nwords_];
+		  size_t hdx = hash_(val, &grp.mask[0]) & (size-1);
+		  while (grp.slots[hdx] != 0) {
+			if (match_(grp.slots[hdx]-1, val, &grp.mask[0]))
+			      break;
+			hdx = (hdx+1) & (size-1);
+		  }
+		  if (grp.slots[hdx] == 0)
+			grp.slots[hdx] = item + 1;
+	    }
+      }
+
+      built_ = true;
+}
+
+vvp_code_t vvp_case_table::lookup(const vvp_vector4_t&val)
+{
+      if (dest_.empty())
+	    return default_;
+
+      assert(val.size() == wid_);
+      if (! built_)
+	    build_groups_();
+
+      if (nwords_ == 0)
+	    return dest_[0];
+
+	// Most case expressions are narrow, so avoid the heap for
+	// the value and mask words if possible.
+      s_vpi_vecval val_buf[4];
+      uint32_t mask_buf[4];
+      std::vector<s_vpi_vecval> val_vec;
+      std::vector<uint32_t> mask_vec;
+      s_vpi_vecval*words = val_buf;
+      uint32_t*mask = mask_buf;
+      if (nwords_ > 4) {
+	    val_vec.resize(nwords_);
+	    mask_vec.resize(nwords_);
+	    words = &val_vec[0];
+	    mask = &mask_vec[0];
+      }
+
+      val.get_vecval(words);
+      dont_care_(words, mask);
+
+      bool wild = false;
+      for (unsigned idx = 0 ; idx < nwords_ ; idx += 1) {
+	    if (mask[idx]) {
+		  wild = true;
+		  break;
+	    }
+      }
+
+	// If the value has don't care bits of its own, then scan the
+	// items in order, as the compare chain would have.
+      if (wild) {
+	    std::vector<uint32_t> item_mask (nwords_);
+	    for (unsigned item = 0 ; item < dest_.size() ; item += 1) {
+		  dont_care_(&items_[item*nwords_], &item_mask[0]);
+		  for (unsigned idx = 0 ; idx < nwords_ ; idx += 1)
+			item_mask[idx] |= mask[idx];
+		  if (match_(item, words, &item_mask[0]))
+			return dest_[item];
+	    }
+	    return default_;
+      }
+
+      unsigned best = dest_.size();
+      for (size_t gdx = 0 ; gdx < groups_.size() ; gdx += 1) {
+	    const group_s&grp = groups_[gdx];
+	      // The groups are in order of their first item, so no
+	      // later group can beat a match that we already have.
+	    if (grp.first >= best)
+		  break;
+
+	    size_t size = grp.slots.size();
+	    size_t hdx = hash_(words, &grp.mask[0]) & (size-1);
+	    while (unsigned slot = grp.slots[hdx]) {
+		  if (match_(slot-1, words, &grp.mask[0])) {
+			if (slot-1 < best)
+			      best = slot-1;
+			break;
+		  }
+		  hdx = (hdx+1) & (size-1);
+	    }
+      }
+
+      return best < dest_.size()? dest_[best] : default_;
+}
@@ -0,0 +1,90 @@
+#ifndef IVL_case_table_H
+#define IVL_case_table_H
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "vvp_net.h"
+# include  <vector>
+# include  <stdint.h>
+
+typedef struct vvp_code_s*vvp_code_t;
+
+/*
+ * A vvp_case_table is the dispatch table of a %case/vec4, %casex/vec4
+ * or %casez/vec4 instruction. The items are constant vectors that are
+ * all the width of the case expression, and each has a destination
+ * in code space. The lookup returns the destination of the first item
+ * that matches, or the default destination if none do.
+ *
+ * The items are grouped by their don't care bits (the z bits for
+ * casez and the x and z bits for casex, and none for case), and each
+ * group is an open hash table keyed by the item with its don't care
+ * bits cleared. A lookup probes each group, in the order of the first
+ * item of the group, and keeps the lowest numbered match. If the case
+ * expression itself has don't care bits, the items are instead
+ * scanned in order, like the %cmp/z and %cmp/x chain that this
+ * replaces.
+ */
+class vvp_case_table {
+
+    public:
+      enum mode_t { CASE, CASEX, CASEZ };
+
+      vvp_case_table(mode_t mode, unsigned wid, unsigned nitems);
+      ~vvp_case_table();
+
+	// Set the value of the item. All the items must be set
+	// before the first lookup.
+      void set_item(unsigned idx, const vvp_vector4_t&val);
+
+	// The code labels resolve into these.
+      vvp_code_t*item_dest(unsigned idx) { return &dest_[idx]; }
+      vvp_code_t*default_dest() { return &default_; }
+
+      vvp_code_t lookup(const vvp_vector4_t&val);
+
+    private:
+      struct group_s {
+	    std::vector<uint32_t> mask;
+	    unsigned first;
+	    std::vector<unsigned> slots;
+      };
+
+      void build_groups_();
+      void dont_care_(const s_vpi_vecval*val, uint32_t*mask) const;
+      unsigned long hash_(const s_vpi_vecval*val, const uint32_t*mask) const;
+      bool match_(unsigned item, const s_vpi_vecval*val, const uint32_t*mask) const;
+
+    private:
+      mode_t mode_;
+      unsigned wid_;
+	// Each item is kept as nwords_ words of vpiVectorVal encoding.
+      unsigned nwords_;
+      std::vector<s_vpi_vecval> items_;
+      std::vector<vvp_code_t> dest_;
+      vvp_code_t default_;
+      std::vector<group_s> groups_;
+      bool built_;
+
+    private: // not implemented
+      vvp_case_table(const vvp_case_table&);
+      vvp_case_table& operator= (const vvp_case_table&);
+};
+
+#endif /* IVL_case_table_H */
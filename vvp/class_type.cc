@@ -18,6 +18,7 @@
  */
 
 # include  "class_type.h"
+# include  "vvp_cobject.h"
 # include  "compile.h"
 # include  "vpi_priv.h"
 # include  "config.h"
@@ -253,16 +254,21 @@ class property_object : public class_property_t {
       size_t array_size_;
 };
 
-template <class T> void property_atom<T>::set_vec4(char*buf, const vvp_vector4_t&val)
+/*
+ * These access the value of an atom property at the given address.
+ * The class_type uses them directly for the common property types,
+ * and the property_atom methods use them too.
+ */
+template <class T> static inline void atom_set_vec4(char*ptr, const vvp_vector4_t&val)
 {
-      T*tmp = reinterpret_cast<T*> (buf+offset_);
+      T*tmp = reinterpret_cast<T*> (ptr);
       bool flag = vector4_to_value(val, *tmp, true, false);
       assert(flag);
 }
 
-template <class T> void property_atom<T>::get_vec4(char*buf, vvp_vector4_t&val)
+template <class T> static inline void atom_get_vec4(char*ptr, vvp_vector4_t&val)
 {
-      T*src = reinterpret_cast<T*> (buf+offset_);
+      T*src = reinterpret_cast<T*> (ptr);
       const size_t tmp_cnt = sizeof(T)<sizeof(unsigned long)
 				       ? 1
 				       : sizeof(T) / sizeof(unsigned long);
@@ -276,6 +282,16 @@ template <class T> void property_atom<T>::get_vec4(char*buf, vvp_vector4_t&val)
       val.setarray(0, val.size(), tmp);
 }
 
+template <class T> void property_atom<T>::set_vec4(char*buf, const vvp_vector4_t&val)
+{
+      atom_set_vec4<T>(buf+offset_, val);
+}
+
+template <class T> void property_atom<T>::get_vec4(char*buf, vvp_vector4_t&val)
+{
+      atom_get_vec4<T>(buf+offset_, val);
+}
+
 template <class T> void property_atom<T>::copy(char*dst, char*src)
 {
       T*dst_obj = reinterpret_cast<T*> (dst+offset_);
@@ -396,40 +412,66 @@ void property_object::copy(char*dst, char*src)
 
 /* **** */
 
+/*
+ * An object block starts with a pointer to the class_type that owns
+ * it, then has the vvp_cobject, then the property instance. Each part
+ * is rounded up so that the part after it is well aligned.
+ */
+static const size_t block_align = 16;
+
+static inline size_t block_round(size_t size)
+{
+      return (size + block_align - 1) & ~(block_align - 1);
+}
+
 class_type::class_type(const string&nam, size_t nprop)
 : class_name_(nam), properties_(nprop)
 {
       instance_size_ = 0;
+      block_size_ = 0;
+      free_blocks_ = 0;
 }
 
 class_type::~class_type()
 {
       for (size_t idx = 0 ; idx < properties_.size() ; idx += 1)
 	    delete properties_[idx].type;
+      for (size_t idx = 0 ; idx < block_chunks_.size() ; idx += 1)
+	    delete[]block_chunks_[idx];
 }
 
 void class_type::set_property(size_t idx, const string&name, const string&type, uint64_t array_size)
 {
       assert(idx < properties_.size());
       properties_[idx].name = name;
+      properties_[idx].kind = PROP_OTHER;
+      properties_[idx].offset = 0;
 
-      if (type == "b8")
+      if (type == "b8") {
 	    properties_[idx].type = new property_atom<uint8_t>;
-      else if (type == "b16")
+	    properties_[idx].kind = PROP_B8;
+      } else if (type == "b16") {
 	    properties_[idx].type = new property_atom<uint16_t>;
-      else if (type == "b32")
+	    properties_[idx].kind = PROP_B16;
+      } else if (type == "b32") {
 	    properties_[idx].type = new property_atom<uint32_t>;
-      else if (type == "b64")
+	    properties_[idx].kind = PROP_B32;
+      } else if (type == "b64") {
 	    properties_[idx].type = new property_atom<uint64_t>;
-      else if (type == "sb8")
+	    properties_[idx].kind = PROP_B64;
+      } else if (type == "sb8") {
 	    properties_[idx].type = new property_atom<int8_t>;
-      else if (type == "sb16")
+	    properties_[idx].kind = PROP_SB8;
+      } else if (type == "sb16") {
 	    properties_[idx].type = new property_atom<int16_t>;
-      else if (type == "sb32")
+	    properties_[idx].kind = PROP_SB16;
+      } else if (type == "sb32") {
 	    properties_[idx].type = new property_atom<int32_t>;
-      else if (type == "sb64")
+	    properties_[idx].kind = PROP_SB32;
+      } else if (type == "sb64") {
 	    properties_[idx].type = new property_atom<int64_t>;
-      else if (type == "r")
+	    properties_[idx].kind = PROP_SB64;
+      } else if (type == "r")
 	    properties_[idx].type = new property_real<double>;
       else if (type == "S")
 	    properties_[idx].type = new property_string;
@@ -438,9 +480,11 @@ void class_type::set_property(size_t idx, const string&name, const string&type,
       else if (type[0] == 'b') {
 	    size_t wid = strtoul(type.c_str()+1, 0, 0);
 	    properties_[idx].type = new property_bit(wid);
+	    properties_[idx].kind = PROP_BIT;
       } else if (type[0] == 'L') {
 	    size_t wid = strtoul(type.c_str()+1,0,0);
 	    properties_[idx].type = new property_logic(wid);
+	    properties_[idx].kind = PROP_LOGIC;
       } else {
 	    properties_[idx].type = 0;
       }
@@ -472,14 +516,54 @@ void class_type::finish_setup(void)
 		  class_property_t*ptype = properties_[pid].type;
 		  assert(ptype->instance_size() == cur->first);
 		  ptype->set_offset(accum);
+		  properties_[pid].offset = accum;
 		  accum += cur->first;
 	    }
       }
+
+      block_size_ = block_align + block_round(sizeof(vvp_cobject))
+	    + block_round(instance_size_);
+}
+
+void* class_type::object_alloc() const
+{
+      assert(block_size_ > 0);
+
+	// If the free list is empty, then carve a new chunk into
+	// blocks. The owner of a block never changes, so it is set
+	// here once.
+      if (free_blocks_ == 0) {
+	    size_t count = 8192 / block_size_;
+	    if (count < 8)
+		  count = 8;
+
+	    char*chunk = new char [count * block_size_];
+	    block_chunks_.push_back(chunk);
+	    for (size_t idx = count ; idx > 0 ; idx -= 1) {
+		  char*blk = chunk + (idx-1)*block_size_;
+		  *reinterpret_cast<const class_type**> (blk) = this;
+		  *reinterpret_cast<void**> (blk+block_align) = free_blocks_;
+		  free_blocks_ = blk+block_align;
+	    }
+      }
+
+      void*obj = free_blocks_;
+      free_blocks_ = *reinterpret_cast<void**> (obj);
+      return obj;
 }
 
-class_type::inst_t class_type::instance_new() const
+void class_type::object_free(void*obj)
 {
-      char*buf = new char [instance_size_];
+      char*blk = reinterpret_cast<char*> (obj) - block_align;
+      const class_type*defn = *reinterpret_cast<const class_type**> (blk);
+
+      *reinterpret_cast<void**> (obj) = defn->free_blocks_;
+      defn->free_blocks_ = obj;
+}
+
+class_type::inst_t class_type::instance_new(void*obj) const
+{
+      char*buf = reinterpret_cast<char*> (obj) + block_round(sizeof(vvp_cobject));
 
       for (size_t idx = 0 ; idx < properties_.size() ; idx += 1)
 	    properties_[idx].type->construct(buf);
@@ -493,16 +577,55 @@ void class_type::instance_delete(class_type::inst_t obj) const
 
       for (size_t idx = 0 ; idx < properties_.size() ; idx += 1)
 	    properties_[idx].type->destruct(buf);
-
-      delete[]buf;
 }
 
+/*
+ * The fixed width vec4 properties are accessed here directly. Only
+ * the other property types go through the virtual methods.
+ */
 void class_type::set_vec4(class_type::inst_t obj, size_t pid,
 			  const vvp_vector4_t&val) const
 {
       char*buf = reinterpret_cast<char*> (obj);
       assert(pid < properties_.size());
-      properties_[pid].type->set_vec4(buf, val);
+      const prop_t&prop = properties_[pid];
+      char*ptr = buf + prop.offset;
+
+      switch (prop.kind) {
+	  case PROP_LOGIC:
+	    *reinterpret_cast<vvp_vector4_t*> (ptr) = val;
+	    break;
+	  case PROP_BIT:
+	    *reinterpret_cast<vvp_vector2_t*> (ptr) = val;
+	    break;
+	  case PROP_B8:
+	    atom_set_vec4<uint8_t>(ptr, val);
+	    break;
+	  case PROP_B16:
+	    atom_set_vec4<uint16_t>(ptr, val);
+	    break;
+	  case PROP_B32:
+	    atom_set_vec4<uint32_t>(ptr, val);
+	    break;
+	  case PROP_B64:
+	    atom_set_vec4<uint64_t>(ptr, val);
+	    break;
+	  case PROP_SB8:
+	    atom_set_vec4<int8_t>(ptr, val);
+	    break;
+	  case PROP_SB16:
+	    atom_set_vec4<int16_t>(ptr, val);
+	    break;
+	  case PROP_SB32:
+	    atom_set_vec4<int32_t>(ptr, val);
+	    break;
+	  case PROP_SB64:
+	    atom_set_vec4<int64_t>(ptr, val);
+	    break;
+	  default:
+	    prop.type->set_vec4(buf, val);
+	    break;
+      }
 }
 
 void class_type::get_vec4(class_type::inst_t obj, size_t pid,
@@ -510,7 +633,46 @@ void class_type::get_vec4(class_type::inst_t obj, size_t pid,
 {
       char*buf = reinterpret_cast<char*> (obj);
       assert(pid < properties_.size());
-      properties_[pid].type->get_vec4(buf, val);
+      const prop_t&prop = properties_[pid];
+      char*ptr = buf + prop.offset;
+
+      switch (prop.kind) {
+	  case PROP_LOGIC:
+	    val = *reinterpret_cast<vvp_vector4_t*> (ptr);
+	    break;
+	  case PROP_BIT: {
+		vvp_vector2_t*tmp = reinterpret_cast<vvp_vector2_t*> (ptr);
+		val = vector2_to_vector4(*tmp, tmp->size());
+		break;
+	  }
+	  case PROP_B8:
+	    atom_get_vec4<uint8_t>(ptr, val);
+	    break;
+	  case PROP_B16:
+	    atom_get_vec4<uint16_t>(ptr, val);
+	    break;
+	  case PROP_B32:
+	    atom_get_vec4<uint32_t>(ptr, val);
+	    break;
+	  case PROP_B64:
+	    atom_get_vec4<uint64_t>(ptr, val);
+	    break;
+	  case PROP_SB8:
+	    atom_get_vec4<int8_t>(ptr, val);
+	    break;
+	  case PROP_SB16:
+	    atom_get_vec4<int16_t>(ptr, val);
+	    break;
+	  case PROP_SB32:
+	    atom_get_vec4<int32_t>(ptr, val);
+	    break;
+	  case PROP_SB64:
+	    atom_get_vec4<int64_t>(ptr, val);
+	    break;
+	  default:
+	    prop.type->get_vec4(buf, val);
+	    break;
+      }
 }
 
 void class_type::set_real(class_type::inst_t obj, size_t pid,
@@ -56,8 +56,18 @@ class class_type : public __vpiHandle {
       void finish_setup(void);
 
     public:
-	// Constructors and destructors for making instances.
-      inst_t instance_new() const;
+	// Allocate and free the memory for a vvp_cobject of this
+	// class. The block has room for the property instance after
+	// the object, and freed blocks are kept by the class for the
+	// next object, so that making and dropping many small objects
+	// does not go to the heap each time.
+      void* object_alloc() const;
+      static void object_free(void*obj);
+
+	// Constructors and destructors for making instances. The
+	// instance is made in place in the block of an object that
+	// came from object_alloc().
+      inst_t instance_new(void*obj) const;
       void instance_delete(inst_t) const;
 
       void set_vec4(inst_t inst, size_t pid, const vvp_vector4_t&val) const;
@@ -77,12 +87,26 @@ class class_type : public __vpiHandle {
     private:
       std::string class_name_;
 
+	// The vec4 properties that can be accessed directly, without
+	// going through the virtual methods of the property type.
+      enum prop_kind_t { PROP_OTHER, PROP_LOGIC, PROP_BIT,
+			 PROP_B8, PROP_B16, PROP_B32, PROP_B64,
+			 PROP_SB8, PROP_SB16, PROP_SB32, PROP_SB64 };
+
       struct prop_t {
 	    std::string name;
 	    class_property_t*type;
+	    prop_kind_t kind;
+	    size_t offset;
       };
       std::vector<prop_t> properties_;
       size_t instance_size_;
+
+	// The size of an object block, and the list of free blocks
+	// and the chunks that they are carved from.
+      size_t block_size_;
+      mutable void*free_blocks_;
+      mutable std::vector<char*> block_chunks_;
 };
 
 #endif /* IVL_class_type_H */
@@ -18,6 +18,7 @@
  */
 
 # include  "codes.h"
+# include  "case_table.h"
 # include  "statistics.h"
 # include  "config.h"
 #ifdef CHECK_WITH_VALGRIND
@@ -96,6 +97,26 @@ vvp_code_t codespace_null(void)
       return first_chunk + 0;
 }
 
+void codespace_fuse(void)
+{
+      vvp_code_t cur = first_chunk;
+
+      while (cur != 0) {
+	    unsigned limit = code_chunk_size;
+	    if (cur == current_chunk)
+		  limit = current_within_chunk;
+
+	    for (unsigned idx = 0 ; idx < limit ; idx += 1) {
+		  if (vthread_fuse_code(cur+idx, limit-idx))
+			count_opcodes_fused += 1;
+	    }
+
+	    if (cur == current_chunk)
+		  break;
+	    cur = cur[code_chunk_size-1].cptr;
+      }
+}
+
 #ifdef CHECK_WITH_VALGRIND
 void codespace_delete(void)
 {
@@ -117,6 +138,8 @@ void codespace_delete(void)
 			exec_ufunc_delete((cur+idx));
 		  } else if ((cur+idx)->opcode == &of_FILE_LINE) {
 			delete((cur+idx)->handle);
+		  } else if ((cur+idx)->opcode == &of_CASE_VEC4) {
+			delete((cur+idx)->case_table);
 		  } else if (((cur+idx)->opcode == &of_CONCATI_STR) ||
 		             ((cur+idx)->opcode == &of_NEW_DARRAY) ||
 		             ((cur+idx)->opcode == &of_PUSHI_STR)) {
@@ -60,6 +60,7 @@ extern bool of_CASSIGN_LINK(vthread_t thr, vvp_code_t code);
 extern bool of_CASSIGN_VEC4(vthread_t thr, vvp_code_t code);
 extern bool of_CASSIGN_VEC4_OFF(vthread_t thr, vvp_code_t code);
 extern bool of_CASSIGN_WR(vthread_t thr, vvp_code_t code);
+extern bool of_CASE_VEC4(vthread_t thr, vvp_code_t code);
 extern bool of_CAST2(vthread_t thr, vvp_code_t code);
 extern bool of_CMPE(vthread_t thr, vvp_code_t code);
 extern bool of_CMPIE(vthread_t thr, vvp_code_t code);
@@ -249,6 +250,23 @@ extern bool of_REAP_UFUNC(vthread_t thr, vvp_code_t code);
 
 extern bool of_CHUNK_LINK(vthread_t thr, vvp_code_t code);
 
+/*
+ * Try to replace the instruction at cp (and the instructions that
+ * follow it) with a fused superinstruction. The avail is the number
+ * of valid instructions starting at cp that may be examined. Return
+ * true if the instruction was replaced.
+ */
+extern bool vthread_fuse_code(vvp_code_t cp, unsigned avail);
+
+/*
+ * Return the mnemonic for the opcode, for use in reports. The
+ * vthread_fused_name function handles the fused superinstructions,
+ * which have no mnemonic of their own. These return nil if the
+ * opcode is not known.
+ */
+extern const char* compile_opcode_name(vvp_code_fun op);
+extern const char* vthread_fused_name(vvp_code_fun op);
+
 /*
  * This is the format of a machine code instruction.
  */
@@ -263,6 +281,7 @@ struct vvp_code_s {
 	    class __vpiHandle*handle;
 	    struct __vpiScope*scope;
 	    const char*text;
+	    class vvp_case_table*case_table;
       };
 
       union {
@@ -291,4 +310,11 @@ extern vvp_code_t codespace_allocate(void);
 extern vvp_code_t codespace_next(void);
 extern vvp_code_t codespace_null(void);
 
+/*
+ * After the code is linked, this function scans the code space and
+ * replaces common sequences of instructions with superinstructions
+ * that execute the whole sequence in one dispatch.
+ */
+extern void codespace_fuse(void);
+
 #endif /* IVL_codes_H */
@@ -32,8 +32,11 @@
 # include  "parse_misc.h"
 # include  "statistics.h"
 # include  "schedule.h"
+# include  "case_table.h"
 # include  <iostream>
 # include  <list>
+# include  <set>
+# include  <map>
 # include  <cstdlib>
 # include  <cstring>
 # include  <cassert>
@@ -300,6 +303,20 @@ static int opcode_compare(const void*k, const void*r)
       return strcmp(kp, rp->mnemonic);
 }
 
+/*
+ * The reverse of the opcode lookup is only used for reports, so a
+ * linear search of the table is good enough.
+ */
+const char* compile_opcode_name(vvp_code_fun op)
+{
+      for (unsigned idx = 0 ; idx < opcode_count ; idx += 1) {
+	    if (opcode_table[idx].opcode == op)
+		  return opcode_table[idx].mnemonic;
+      }
+
+      return vthread_fused_name(op);
+}
+
 /*
  * Keep a symbol table of addresses within code space. Labels on
  * executable opcodes are mapped to their address here.
@@ -319,6 +336,14 @@ static symbol_table_t sym_functors = 0;
  */
 static symbol_table_t sym_vpi = 0;
 
+/*
+ * The net flattening pass needs to know which nets are referenced
+ * other than by netlist links, and which ports are given compiled in
+ * constants, because those do not appear in the fan-out lists.
+ */
+static std::set<vvp_net_t*> flatten_pinned;
+static std::map<vvp_net_t*,unsigned> flatten_const_ports;
+
 
 /*
  * If a functor parameter makes a forward reference to a functor, then
@@ -505,6 +530,7 @@ bool functor_gen_resolv_list_s::resolve(bool mes)
 
       if (tmp) {
 	    *ref = tmp;
+	    flatten_pinned.insert(tmp);
 	    return true;
       }
 
@@ -663,6 +689,42 @@ void code_label_lookup(struct vvp_code_s *code, char *label)
       resolv_submit(res);
 }
 
+/*
+ * The %case/vec4 tables keep code pointers of their own, so this
+ * resolves a code label into any code pointer.
+ */
+struct code_ref_resolv_list_s: public resolv_list_s {
+      explicit code_ref_resolv_list_s(char*lab) : resolv_list_s(lab) {
+	    ref = 0;
+      }
+      vvp_code_t*ref;
+      virtual bool resolve(bool mes);
+};
+
+bool code_ref_resolv_list_s::resolve(bool mes)
+{
+      symbol_value_t val = sym_get_value(sym_codespace, label());
+      if (val.num) {
+	    *ref = reinterpret_cast<vvp_code_t>(val.ptr);
+	    return true;
+      }
+
+      if (mes)
+	    fprintf(stderr, "unresolved code label: %s\n", label());
+
+      return false;
+}
+
+static void code_ref_lookup(vvp_code_t*ref, char*label)
+{
+      struct code_ref_resolv_list_s*res
+	    = new struct code_ref_resolv_list_s(label);
+
+      res->ref = ref;
+
+      resolv_submit(res);
+}
+
 struct code_array_resolv_list_s: public resolv_list_s {
       code_array_resolv_list_s(char*lab) : resolv_list_s(lab) {
 	    code = NULL;
@@ -769,6 +831,24 @@ void compile_cleanup(void)
       compile_island_cleanup();
       compile_array_cleanup();
 
+      if (opt_level > 0) {
+	    if (verbose_flag) {
+		  fprintf(stderr, " ... Flattening nets\n");
+		  fflush(stderr);
+	    }
+	    vvp_net_flatten(flatten_pinned, flatten_const_ports);
+      }
+      flatten_pinned.clear();
+      flatten_const_ports.clear();
+
+      if (opt_level > 0) {
+	    if (verbose_flag) {
+		  fprintf(stderr, " ... Fusing instructions\n");
+		  fflush(stderr);
+	    }
+	    codespace_fuse();
+      }
+
       if (verbose_flag) {
 	    fprintf(stderr, " ... Compiletf functions\n");
 	    fflush(stderr);
@@ -894,6 +974,9 @@ void input_connect(vvp_net_t*fdx, unsigned port, char*label)
 {
       vvp_net_ptr_t ifdx = vvp_net_ptr_t(fdx, port);
 
+      if (c4string_test(label) || c8string_test(label) || crstring_test(label))
+	    flatten_const_ports[fdx] |= 1U << port;
+
 	/* Is this a vvp_vector4_t constant value? */
       if (c4string_test(label)) {
 
@@ -1843,6 +1926,55 @@ void compile_fork(char*label, struct symb_s dest, struct symb_s scope)
       compile_vpi_lookup(&code->handle, scope.text);
 }
 
+void compile_case_vec4(char*label, char type,
+		       unsigned argc, struct symb_s*argv)
+{
+      if (label)
+	    compile_codelabel(label);
+
+      vvp_code_t code = codespace_allocate();
+      code->opcode = of_CASE_VEC4;
+
+      if (argc%2 == 0) {
+	    yyerror("operand count");
+	    compile_errors += 1;
+	    for (unsigned idx = 0 ; idx < argc ; idx += 1)
+		  free(argv[idx].text);
+	    free(argv);
+	    return;
+      }
+
+      unsigned nitems = (argc-1) / 2;
+      unsigned wid = 0;
+      if (nitems > 0 && c4string_test(argv[1].text))
+	    wid = strlen(argv[1].text) - 4;
+
+      vvp_case_table::mode_t mode = vvp_case_table::CASE;
+      if (type == 'x')
+	    mode = vvp_case_table::CASEX;
+      else if (type == 'z')
+	    mode = vvp_case_table::CASEZ;
+
+      vvp_case_table*table = new vvp_case_table(mode, wid, nitems);
+      code->case_table = table;
+
+      for (unsigned idx = 0 ; idx < nitems ; idx += 1) {
+	    char*text = argv[1+2*idx].text;
+	    if (! c4string_test(text) || strlen(text)-4 != wid) {
+		  yyerror("operand format");
+		  compile_errors += 1;
+	    } else {
+		  table->set_item(idx, c4string_to_vector4(text));
+	    }
+	    free(text);
+
+	    code_ref_lookup(table->item_dest(idx), argv[2+2*idx].text);
+      }
+
+      code_ref_lookup(table->default_dest(), argv[0].text);
+      free(argv);
+}
+
 void compile_file_line(char*label, long file_idx, long lineno,
                        char*description)
 {
@@ -50,6 +50,12 @@ extern void compile_cleanup(void);
 
 extern bool verbose_flag;
 
+/*
+ * The link time optimization level. At level 0 the code and netlist
+ * are run exactly as written in the input file. The default is 1.
+ */
+extern unsigned opt_level;
+
 /*
  * If this file opened, then write debug information to this
  * file. This is used for debugging the VVP runtime itself.
@@ -387,13 +393,14 @@ extern void compile_array_port(char*label, char*name, long addr);
 extern void compile_array_cleanup(void);
 
 /*
- * Compile the .ufunc statement.
+ * Compile the .ufunc statement. The inline_flag is true for the
+ * .ufunc/i variant.
  */
 extern void compile_ufunc(char*label, char*code, unsigned wid,
 			  unsigned argc, struct symb_s*argv,
 			  unsigned portc, struct symb_s*portv,
 			  struct symb_s retv, char*scope_label,
-                          char*trigger_label);
+                          char*trigger_label, bool inline_flag);
 
 /*
  * The compile_event function takes the parts of the event statement
@@ -461,6 +468,14 @@ extern void print_vpi_call_errors();
 
 extern void compile_fork(char*label, struct symb_s targ_s,
 			 struct symb_s scope_s);
+
+/*
+ * Compile a %case/vec4 (type 0), %casex/vec4 (type 'x') or
+ * %casez/vec4 (type 'z') instruction. The first symbol is the default
+ * label, and the rest are pairs of a C4<> constant and a label.
+ */
+extern void compile_case_vec4(char*label, char type,
+			      unsigned argc, struct symb_s*argv);
 extern void compile_codelabel(char*label);
 
 /*
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This VPI module implements the $by_name("name") task that the
+ * by_name.vvp example uses. It passes the string to
+ * vpi_handle_by_name with a nil scope, and prints the type and full
+ * name of the object that it finds. Compile it and run the example
+ * like so:
+ *
+ *    iverilog-vpi by_name.c
+ *    vvp -M. by_name.vvp
+ */
+
+# include  <vpi_user.h>
+
+static PLI_INT32 by_name_calltf(PLI_BYTE8*name)
+{
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+      vpiHandle arg = vpi_scan(argv);
+      vpiHandle obj;
+      s_vpi_value val;
+      (void)name;
+
+      vpi_free_object(argv);
+
+      val.format = vpiStringVal;
+      vpi_get_value(arg, &val);
+
+      obj = vpi_handle_by_name(val.value.str, 0);
+      if (obj == 0) {
+	    vpi_printf("%s: not found\n", val.value.str);
+	    return 0;
+      }
+
+      vpi_printf("%s: %s %s\n", val.value.str,
+		 vpi_get_str(vpiType, obj), vpi_get_str(vpiFullName, obj));
+      return 0;
+}
+
+static void by_name_register(void)
+{
+      s_vpi_systf_data tf_data;
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$by_name";
+      tf_data.calltf    = by_name_calltf;
+      tf_data.compiletf = 0;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = 0;
+      vpi_register_systf(&tf_data);
+}
+
+void (*vlog_startup_routines[])(void) = {
+      by_name_register,
+      0
+};
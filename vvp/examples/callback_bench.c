@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This VPI module times the value change callbacks of the run time. The
+ * $callback_bench(sig, count) task attaches count cbValueChange
+ * callbacks to the signal, asking for the value in a rotating set of
+ * formats, much like a Python or C++ testbench that watches a bus from
+ * many places. At the end of the simulation, it prints the number of
+ * callbacks that were called and the rate at which they were called.
+ * Compile it and run the example like so:
+ *
+ *    iverilog-vpi callback_bench.c
+ *    vvp -M. callback_bench.vvp
+ */
+
+# include  <vpi_user.h>
+# include  <stdlib.h>
+# include  <time.h>
+
+static unsigned long bench_calls = 0;
+static unsigned long bench_check = 0;
+static clock_t bench_start;
+
+static PLI_INT32 bench_value_cb(p_cb_data cb)
+{
+      bench_calls += 1;
+      switch (cb->value->format) {
+	  case vpiIntVal:
+	    bench_check += cb->value->value.integer;
+	    break;
+	  case vpiBinStrVal:
+	  case vpiHexStrVal:
+	    bench_check += cb->value->value.str[0];
+	    break;
+	  default:
+	    break;
+      }
+      return 0;
+}
+
+static PLI_INT32 bench_end_cb(p_cb_data cb)
+{
+      double secs = (double)(clock() - bench_start) / CLOCKS_PER_SEC;
+      (void)cb;
+
+      vpi_printf("callback_bench: %lu callbacks in %.3f seconds",
+		 bench_calls, secs);
+      if (secs > 0.0)
+	    vpi_printf(", %.0f callbacks/sec", bench_calls / secs);
+      vpi_printf(" (check %lu)\n", bench_check);
+      return 0;
+}
+
+static PLI_INT32 bench_calltf(PLI_BYTE8*name)
+{
+      static const PLI_INT32 formats[] = {
+	    vpiBinStrVal, vpiIntVal, vpiHexStrVal, vpiSuppressVal
+      };
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+      vpiHandle sig = vpi_scan(argv);
+      vpiHandle arg = vpi_scan(argv);
+      s_vpi_value val;
+      s_vpi_time tim;
+      s_cb_data cb;
+      PLI_INT32 idx, count;
+      (void)name;
+
+      vpi_free_object(argv);
+
+      val.format = vpiIntVal;
+      vpi_get_value(arg, &val);
+      count = val.value.integer;
+
+      tim.type = vpiSuppressTime;
+      cb.reason = cbValueChange;
+      cb.cb_rtn = bench_value_cb;
+      cb.obj = sig;
+      cb.time = &tim;
+      cb.index = 0;
+      cb.user_data = 0;
+      for (idx = 0 ;  idx < count ;  idx += 1) {
+	    val.format = formats[idx % (sizeof formats / sizeof formats[0])];
+	    cb.value = &val;
+	    vpi_free_object(vpi_register_cb(&cb));
+      }
+
+      cb.reason = cbEndOfSimulation;
+      cb.cb_rtn = bench_end_cb;
+      cb.obj = 0;
+      cb.value = 0;
+      vpi_free_object(vpi_register_cb(&cb));
+
+      bench_start = clock();
+      return 0;
+}
+
+static void bench_register(void)
+{
+      s_vpi_systf_data tf_data;
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$callback_bench";
+      tf_data.calltf    = bench_calltf;
+      tf_data.compiletf = 0;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = 0;
+      vpi_register_systf(&tf_data);
+}
+
+void (*vlog_startup_routines[])(void) = {
+      bench_register,
+      0
+};
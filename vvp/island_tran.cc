@@ -22,17 +22,82 @@
 # include  "symbols.h"
 # include  "schedule.h"
 # include  <list>
+# include  <vector>
+# include  <algorithm>
+# include  <climits>
 
 # include  <iostream>
 
 using namespace std;
 
+struct vvp_island_branch_tran;
+
+/*
+ * The tran island keeps the mesh in flat arrays. The ports of the
+ * island are numbered, and for each port there is a row of the branch
+ * ends attached to it, and a row of the branches that it enables. The
+ * rows are in compressed form: the ends of port N are adj_[adj_start_[N]]
+ * up to (but not including) adj_[adj_start_[N+1]], and likewise for
+ * the enables.
+ *
+ * The ports are also grouped into connected components, where the
+ * connections are the branches that are not disabled. A value cannot
+ * get from one component to another, so when the island runs it only
+ * resolves the components that contain a port that changed or a
+ * branch that changed state. The components only need to be found
+ * again when a branch switches to or from disabled.
+ */
 class vvp_island_tran : public vvp_island {
 
     public:
+      vvp_island_tran();
       void run_island();
       void count_drivers(vvp_island_port*port, unsigned bit_idx,
                          unsigned counts[3]);
+
+    private:
+      struct end_s {
+	    vvp_island_branch_tran*branch;
+	      // The side of the branch (0 for a, 1 for b) that is
+	      // attached to this port.
+	    unsigned side;
+      };
+
+      void build_mesh_();
+      unsigned add_port_(vvp_net_t*net);
+      void test_enables_(unsigned idx);
+      void find_components_(const vector<unsigned>&ports);
+      void resolve_component_(unsigned comp);
+
+      inline vvp_island_port* port_(unsigned idx) const
+      { return static_cast<vvp_island_port*>(nets_[idx]->fun); }
+
+    private:
+      bool built_;
+      vector<vvp_net_t*> nets_;
+      vector<unsigned> adj_start_;
+      vector<end_s> adj_;
+      vector<unsigned> ctl_start_;
+      vector<vvp_island_branch_tran*> ctl_;
+
+	// The component of each port, and the ports of each
+	// component. Ports that have no branches have no component.
+      vector<unsigned> comp_of_;
+      vector<vector<unsigned> > comps_;
+      vector<unsigned> free_comps_;
+
+	// Enable ports whose output value changed when the island
+	// last ran. The enable input is read from the output value,
+	// so their branches are tested again the next time around.
+      vector<unsigned> retest_;
+
+	// Scratch lists that are kept to save on allocation.
+      vector<vvp_island_port*> run_ports_;
+      vector<vvp_island_branch_tran*> changed_;
+      vector<unsigned> dirty_;
+      vector<unsigned> work_;
+      vector<bool> queued_;
+      bool relink_;
 };
 
 enum tran_state_t {
@@ -47,13 +112,13 @@ struct vvp_island_branch_tran : public vvp_island_branch {
                              unsigned width__, unsigned part__,
                              unsigned offset__);
       bool run_test_enabled();
-      void run_resolution();
-      void run_output();
 
       vvp_net_t*en;
       unsigned width, part, offset;
       bool active_high;
       tran_state_t state;
+	// The island index of the a and b ports.
+      unsigned a_index, b_index;
 };
 
 vvp_island_branch_tran::vvp_island_branch_tran(vvp_net_t*en__,
@@ -62,7 +127,7 @@ vvp_island_branch_tran::vvp_island_branch_tran(vvp_net_t*en__,
                                                unsigned part__,
                                                unsigned offset__)
 : en(en__), width(width__), part(part__), offset(offset__),
-  active_high(active_high__)
+  active_high(active_high__), a_index(UINT_MAX), b_index(UINT_MAX)
 {
       state = en__ ? tran_disabled : tran_enabled;
 }
@@ -74,38 +139,223 @@ static inline vvp_island_branch_tran* BRANCH_TRAN(vvp_island_branch*tmp)
       return res;
 }
 
+vvp_island_tran::vvp_island_tran()
+: built_(false), relink_(false)
+{
+}
+
+unsigned vvp_island_tran::add_port_(vvp_net_t*net)
+{
+      vvp_island_port*port = dynamic_cast<vvp_island_port*>(net->fun);
+      assert(port);
+      if (port->index == UINT_MAX) {
+	    port->index = nets_.size();
+	    nets_.push_back(net);
+      }
+      return port->index;
+}
+
 /*
- * The run_island() method is called by the scheduler to run the
- * entire island. We run the island by calling run_resolution() for
- * all the branches in the island.
-*/
-void vvp_island_tran::run_island()
+ * Build the adjacency rows of the island the first time it runs. The
+ * branch list is complete by then, and will not change again.
+ */
+void vvp_island_tran::build_mesh_()
 {
-	// Test to see if any of the branches are enabled. This loop
-	// tests the enabled inputs for all the branches and caches
-	// the results in the state for each branch.
-      bool runnable = false;
+      unsigned nbranches = 0;
       for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
 	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
 	    assert(tmp);
-	    runnable |= tmp->run_test_enabled();
+	    tmp->a_index = add_port_(tmp->a);
+	    tmp->b_index = add_port_(tmp->b);
+	    if (tmp->en)
+		  add_port_(tmp->en);
+	    nbranches += 1;
       }
 
-	// Now resolve all the branches in the island.
+      unsigned nports = nets_.size();
+      adj_start_.assign(nports+1, 0);
+      ctl_start_.assign(nports+1, 0);
       for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    tmp->run_resolution();
+	    vvp_island_branch_tran*tmp = static_cast<vvp_island_branch_tran*>(cur);
+	    adj_start_[tmp->a_index+1] += 1;
+	    adj_start_[tmp->b_index+1] += 1;
+	    if (tmp->en)
+		  ctl_start_[static_cast<vvp_island_port*>(tmp->en->fun)->index+1] += 1;
+      }
+      for (unsigned idx = 0 ; idx < nports ; idx += 1) {
+	    adj_start_[idx+1] += adj_start_[idx];
+	    ctl_start_[idx+1] += ctl_start_[idx];
       }
 
-	// Now output the resolved values.
+      adj_.resize(2*nbranches);
+      ctl_.resize(ctl_start_[nports]);
+      vector<unsigned> adj_fill (adj_start_.begin(), adj_start_.end()-1);
+      vector<unsigned> ctl_fill (ctl_start_.begin(), ctl_start_.end()-1);
       for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    tmp->run_output();
+	    vvp_island_branch_tran*tmp = static_cast<vvp_island_branch_tran*>(cur);
+	    end_s&ea = adj_[adj_fill[tmp->a_index]++];
+	    ea.branch = tmp;
+	    ea.side = 0;
+	    end_s&eb = adj_[adj_fill[tmp->b_index]++];
+	    eb.branch = tmp;
+	    eb.side = 1;
+	    if (tmp->en)
+		  ctl_[ctl_fill[static_cast<vvp_island_port*>(tmp->en->fun)->index]++] = tmp;
+
+	    tmp->run_test_enabled();
+      }
+
+      comp_of_.assign(nports, UINT_MAX);
+      queued_.assign(nports, false);
+
+      vector<unsigned> all;
+      for (unsigned idx = 0 ; idx < nports ; idx += 1) {
+	    if (adj_start_[idx] != adj_start_[idx+1])
+		  all.push_back(idx);
+      }
+      find_components_(all);
+
+      built_ = true;
+}
+
+/*
+ * Test again the branches that the port enables, and note the
+ * branches whose state changed.
+ */
+void vvp_island_tran::test_enables_(unsigned idx)
+{
+      for (unsigned cdx = ctl_start_[idx] ; cdx < ctl_start_[idx+1] ; cdx += 1) {
+	    vvp_island_branch_tran*tmp = ctl_[cdx];
+	    tran_state_t old_state = tmp->state;
+	    tmp->run_test_enabled();
+	    if (tmp->state == old_state)
+		  continue;
+
+	    changed_.push_back(tmp);
+	    if ((old_state == tran_disabled) || (tmp->state == tran_disabled))
+		  relink_ = true;
+      }
+}
+
+/*
+ * Give new components to the listed ports. The list must hold whole
+ * components, so that the search does not reach a port outside the
+ * list.
+ */
+void vvp_island_tran::find_components_(const vector<unsigned>&ports)
+{
+      for (size_t idx = 0 ; idx < ports.size() ; idx += 1)
+	    comp_of_[ports[idx]] = UINT_MAX;
+
+      for (size_t idx = 0 ; idx < ports.size() ; idx += 1) {
+	    if (comp_of_[ports[idx]] != UINT_MAX)
+		  continue;
+
+	    unsigned comp;
+	    if (free_comps_.empty()) {
+		  comp = comps_.size();
+		  comps_.push_back(vector<unsigned>());
+	    } else {
+		  comp = free_comps_.back();
+		  free_comps_.pop_back();
+	    }
+
+	    vector<unsigned>&members = comps_[comp];
+	    comp_of_[ports[idx]] = comp;
+	    members.push_back(ports[idx]);
+	      // The members list is also the work list of the search.
+	    for (size_t mdx = 0 ; mdx < members.size() ; mdx += 1) {
+		  unsigned pdx = members[mdx];
+		  for (unsigned edx = adj_start_[pdx] ; edx < adj_start_[pdx+1] ; edx += 1) {
+			vvp_island_branch_tran*tmp = adj_[edx].branch;
+			if (tmp->state == tran_disabled)
+			      continue;
+			unsigned dst = adj_[edx].side? tmp->a_index : tmp->b_index;
+			if (comp_of_[dst] != UINT_MAX)
+			      continue;
+			comp_of_[dst] = comp;
+			members.push_back(dst);
+		  }
+	    }
       }
 }
 
+/*
+ * The run_island() method is called by the scheduler to run the
+ * island. The first time, every component is resolved. After that,
+ * only the components that hold a port that flagged the island, or a
+ * branch that changed state, are resolved.
+ */
+void vvp_island_tran::run_island()
+{
+      bool first = ! built_;
+      if (first)
+	    build_mesh_();
+
+	// Take the list of flagged ports. If ports flag the island
+	// while it is running, they go onto a fresh list.
+      run_ports_.swap(flagged_ports_);
+
+	// Test again the enables of the ports that changed. This
+	// caches the new state in each branch.
+      for (size_t idx = 0 ; idx < run_ports_.size() ; idx += 1) {
+	    vvp_island_port*port = run_ports_[idx];
+	    port->flagged = false;
+	    if (port->index != UINT_MAX)
+		  test_enables_(port->index);
+      }
+      for (size_t idx = 0 ; idx < retest_.size() ; idx += 1)
+	    test_enables_(retest_[idx]);
+      retest_.clear();
+
+	// If a branch switched to or from disabled, then the
+	// components at its ends may join or split. Find the
+	// components again for just the ports that they hold.
+      if (relink_) {
+	    vector<unsigned> ports;
+	    for (size_t idx = 0 ; idx < changed_.size() ; idx += 1) {
+		  unsigned ends[2] = { changed_[idx]->a_index, changed_[idx]->b_index };
+		  for (unsigned sdx = 0 ; sdx < 2 ; sdx += 1) {
+			unsigned comp = comp_of_[ends[sdx]];
+			if (comp == UINT_MAX)
+			      continue;
+			vector<unsigned>&members = comps_[comp];
+			for (size_t mdx = 0 ; mdx < members.size() ; mdx += 1)
+			      comp_of_[members[mdx]] = UINT_MAX;
+			ports.insert(ports.end(), members.begin(), members.end());
+			members.clear();
+			free_comps_.push_back(comp);
+		  }
+	    }
+	    find_components_(ports);
+	    relink_ = false;
+      }
+
+	// Collect the components that need to be resolved.
+      if (first) {
+	    for (unsigned comp = 0 ; comp < comps_.size() ; comp += 1)
+		  dirty_.push_back(comp);
+      }
+      for (size_t idx = 0 ; idx < run_ports_.size() ; idx += 1) {
+	    unsigned pdx = run_ports_[idx]->index;
+	    if (pdx != UINT_MAX && comp_of_[pdx] != UINT_MAX)
+		  dirty_.push_back(comp_of_[pdx]);
+      }
+      for (size_t idx = 0 ; idx < changed_.size() ; idx += 1) {
+	    dirty_.push_back(comp_of_[changed_[idx]->a_index]);
+	    dirty_.push_back(comp_of_[changed_[idx]->b_index]);
+      }
+      run_ports_.clear();
+      changed_.clear();
+
+      sort(dirty_.begin(), dirty_.end());
+      dirty_.erase(unique(dirty_.begin(), dirty_.end()), dirty_.end());
+
+      for (size_t idx = 0 ; idx < dirty_.size() ; idx += 1)
+	    resolve_component_(dirty_[idx]);
+      dirty_.clear();
+}
+
 static void count_drivers_(vvp_branch_ptr_t cur, bool other_side_visited,
                            unsigned bit_idx, unsigned counts[3])
 {
@@ -260,132 +510,103 @@ inline vvp_vector8_t resolve_ambiguous(const vvp_vector8_t&a,
       return out;
 }
 
-static void push_value_through_branches(const vvp_vector8_t&val,
-					list<vvp_branch_ptr_t>&connections);
-
-static void push_value_through_branch(const vvp_vector8_t&val,
-                                      vvp_branch_ptr_t cur)
+/*
+ * Get the value that the branch carries from the side opposite dst_ab
+ * to the dst_ab side, and resolve it with the value already collected
+ * for the destination port.
+ */
+static vvp_vector8_t resolve_through_branch(const vvp_island_branch_tran*branch,
+					    unsigned dst_ab,
+					    const vvp_vector8_t&dst_val,
+					    const vvp_vector8_t&val)
 {
-      vvp_island_branch_tran*branch = BRANCH_TRAN(cur.ptr());
-
-        // If the branch is disabled, skip.
-      if (branch->state == tran_disabled)
-            return;
-
-      unsigned src_ab = cur.port();
-      unsigned dst_ab = src_ab^1;
-
-      vvp_net_t*dst_net = dst_ab? branch->b : branch->a;
-      vvp_island_port*dst_port = dynamic_cast<vvp_island_port*>(dst_net->fun);
-
-      vvp_vector8_t old_val = dst_port->value;
-
-        // If the port on the other side has not yet been visited,
-        // get its input value.
-      if (dst_port->value.size() == 0)
-            dst_port->value = island_get_value(dst_net);
-
-        // If we don't yet have an initial value for the port, skip.
-      if (dst_port->value.size() == 0)
-            return;
-
-        // Now resolve the pushed value with whatever values we have
-        // previously collected (and resolved) for the port.
       if (branch->width == 0) {
               // There are no part selects.
-            dst_port->value = resolve_ambiguous(dst_port->value, val,
-                                                branch->state);
+            return resolve_ambiguous(dst_val, val, branch->state);
 
       } else if (dst_ab == 1) {
               // The other side is a strict subset (part select)
               // of this side.
             vvp_vector8_t tmp = val.subvalue(branch->offset, branch->part);
-            dst_port->value = resolve(dst_port->value, tmp);
+            return resolve(dst_val, tmp);
 
       } else {
               // The other side is a superset of this side.
             vvp_vector8_t tmp = part_expand(val, branch->width, branch->offset);
-            dst_port->value = resolve(dst_port->value, tmp);
-      }
-
-        // If the resolved value for the port has changed, push the new
-        // value back into the network.
-      if (! dst_port->value.eeq(old_val)) {
-            list<vvp_branch_ptr_t> connections;
-
-	    vvp_branch_ptr_t dst_side(branch, dst_ab);
-	    island_collect_node(connections, dst_side);
-
-	    push_value_through_branches(dst_port->value, connections);
-      }
-}
-
-static void push_value_through_branches(const vvp_vector8_t&val,
-					list<vvp_branch_ptr_t>&connections)
-{
-      for (list<vvp_branch_ptr_t>::iterator idx = connections.begin()
-		 ; idx != connections.end() ; ++ idx ) {
-
-            push_value_through_branch(val, *idx);
+            return resolve(dst_val, tmp);
       }
 }
 
 /*
- * This method resolves the value for a branch recursively. It uses
- * recursive descent to span the graph of branches, pushing values
- * through the network until a stable state is reached.
+ * Resolve the ports of a component, then send the results out of the
+ * island. Each port starts with its input value, and is put on the
+ * work list. Taking a port off the work list pushes its value through
+ * the enabled branches that are attached to it, and any port whose
+ * value changes goes back on the work list. This stops when the
+ * values are stable. Resolution does not depend on the order that
+ * values arrive, so the result is the same as for any other order.
+ *
+ * A port that has no input value yet is skipped, and values are not
+ * pushed through it.
  */
-void vvp_island_branch_tran::run_resolution()
+void vvp_island_tran::resolve_component_(unsigned comp)
 {
-      list<vvp_branch_ptr_t> connections;
-      vvp_island_port*port;
-
-	// If the A side port hasn't already been visited, then push
-        // its input value through all the branches connected to it.
-      port = dynamic_cast<vvp_island_port*>(a->fun);
-      if (port->value.size() == 0) {
-	    vvp_branch_ptr_t a_side(this, 0);
-	    island_collect_node(connections, a_side);
-
-	    port->value = island_get_value(a);
-            if (port->value.size() != 0)
-	          push_value_through_branches(port->value, connections);
-
-            connections.clear();
+      const vector<unsigned>&members = comps_[comp];
+
+      for (size_t mdx = 0 ; mdx < members.size() ; mdx += 1) {
+	    unsigned pdx = members[mdx];
+	    vvp_island_port*port = port_(pdx);
+	    port->value = island_get_value(nets_[pdx]);
+	    if (port->value.size() != 0) {
+		  queued_[pdx] = true;
+		  work_.push_back(pdx);
+	    }
       }
 
-	// Do the same for the B side port. Note that if the branch
-        // is enabled, the B side port will have already been visited
-        // when we resolved the A side port.
-      port = dynamic_cast<vvp_island_port*>(b->fun);
-      if (port->value.size() == 0) {
-	    vvp_branch_ptr_t b_side(this, 1);
-	    island_collect_node(connections, b_side);
-
-	    port->value = island_get_value(b);
-	    if (port->value.size() != 0)
-	          push_value_through_branches(port->value, connections);
-
-            connections.clear();
+      while (! work_.empty()) {
+	    unsigned src = work_.back();
+	    work_.pop_back();
+	    queued_[src] = false;
+
+	    vvp_vector8_t val = port_(src)->value;
+	    for (unsigned edx = adj_start_[src] ; edx < adj_start_[src+1] ; edx += 1) {
+		  vvp_island_branch_tran*branch = adj_[edx].branch;
+		  if (branch->state == tran_disabled)
+			continue;
+
+		  unsigned dst_ab = adj_[edx].side ^ 1;
+		  unsigned dst = dst_ab? branch->b_index : branch->a_index;
+		  vvp_island_port*dst_port = port_(dst);
+		  if (dst_port->value.size() == 0)
+			continue;
+
+		  vvp_vector8_t tmp = resolve_through_branch(branch, dst_ab,
+							     dst_port->value, val);
+		  if (tmp.eeq(dst_port->value))
+			continue;
+
+		  dst_port->value = tmp;
+		  if (! queued_[dst]) {
+			queued_[dst] = true;
+			work_.push_back(dst);
+		  }
+	    }
       }
-}
 
-void vvp_island_branch_tran::run_output()
-{
-      vvp_island_port*port;
+	// Now output the resolved values. If the port is also an
+	// enable, then note when its output changes so that its
+	// branches can be tested again.
+      for (size_t mdx = 0 ; mdx < members.size() ; mdx += 1) {
+	    unsigned pdx = members[mdx];
+	    vvp_island_port*port = port_(pdx);
+	    if (port->value.size() == 0)
+		  continue;
 
-	// If the A side port hasn't already been updated, send the
-        // resolved value to the output.
-      port = dynamic_cast<vvp_island_port*>(a->fun);
-      if (port->value.size() != 0) {
-	    island_send_value(a, port->value);
-	    port->value = vvp_vector8_t::nil;
-      }
+	    if (ctl_start_[pdx] != ctl_start_[pdx+1]
+		&& ! port->outvalue.eeq(port->value))
+		  retest_.push_back(pdx);
 
-	// Do the same for the B side port.
-      port = dynamic_cast<vvp_island_port*>(b->fun);
-      if (port->value.size() != 0) {
-	    island_send_value(b, port->value);
+	    island_send_value(nets_[pdx], port->value);
 	    port->value = vvp_vector8_t::nil;
       }
 }
@@ -25,8 +25,10 @@
 # include  "schedule.h"
 # include  "vpi_priv.h"
 # include  "statistics.h"
+# include  "profile.h"
 # include  "vvp_cleanup.h"
 # include  "vvp_object.h"
+# include  <cctype>
 # include  <cstdio>
 # include  <cstdlib>
 # include  <cstring>
@@ -57,6 +59,7 @@ extern "C" const char*optarg;
 #endif
 
 bool verbose_flag = false;
+unsigned opt_level = 1;
 bool version_flag = false;
 static int vvp_return_value = 0;
 
@@ -96,7 +99,7 @@ static void my_getrusage(struct rusage *a)
 #     endif
 }
 
-static void print_rusage(struct rusage *a, struct rusage *b)
+static double print_rusage(struct rusage *a, struct rusage *b)
 {
       double delta = a->ru_utime.tv_sec
 	    +        a->ru_utime.tv_usec/1E6
@@ -115,6 +118,8 @@ static void print_rusage(struct rusage *a, struct rusage *b)
 	      a->ru_maxrss/1024.0,
 	      (a->ru_idrss+a->ru_isrss)/1024.0,
 	      a->ru_ixrss/1024.0 );
+
+      return delta;
 }
 
 #else // ! defined(HAVE_SYS_RESOURCE_H)
@@ -122,7 +127,8 @@ static void print_rusage(struct rusage *a, struct rusage *b)
 // Provide dummies
 struct rusage { int x; };
 inline static void my_getrusage(struct rusage *) { }
-inline static void print_rusage(struct rusage *, struct rusage *){};
+inline static double print_rusage(struct rusage *, struct rusage *)
+{ return 0.0; }
 
 #endif // ! defined(HAVE_SYS_RESOURCE_H)
 
@@ -316,11 +322,22 @@ int main(int argc, char*argv[])
         /* For non-interactive runs we do not want to run the interactive
          * debugger, so make $stop just execute a $finish. */
       stop_is_finish = false;
-      while ((opt = getopt(argc, argv, "+hl:M:m:nNsvV")) != EOF) switch (opt) {
+      while ((opt = getopt(argc, argv, "+A:hl:M:m:nNO:P:q:svV")) != EOF) switch (opt) {
+	  case 'A': {
+		char*ep;
+		vvp_vector4array_sp::threshold = strtoul(optarg, &ep, 10);
+		if (!isdigit((unsigned char)optarg[0]) || *ep != 0) {
+		      fprintf(stderr, "%s: Invalid sparse memory size \"%s\".\n",
+			      argv[0], optarg);
+		      flag_errors += 1;
+		}
+		break;
+	  }
          case 'h':
            fprintf(stderr,
                    "Usage: vvp [options] input-file [+plusargs...]\n"
                    "Options:\n"
+                   " -A words       Make memories of at least words sparse.\n"
                    " -h             Print this help message.\n"
                    " -l file        Logfile, '-' for <stderr>\n"
                    " -M path        VPI module directory\n"
@@ -328,6 +345,9 @@ int main(int argc, char*argv[])
                    " -m module      Load vpi module.\n"
 		   " -n             Non-interactive ($stop = $finish).\n"
                    " -N             Same as -n, but exit code is 1 instead of 0\n"
+                   " -O level       Link time optimization level (default 1).\n"
+                   " -P file        Write a run time profile to file.\n"
+                   " -q queue       Event queue: wheel (default) or list.\n"
 		   " -s             $stop right away.\n"
                    " -v             Verbose progress messages.\n"
                    " -V             Print the version information.\n" );
@@ -353,6 +373,26 @@ int main(int argc, char*argv[])
             stop_is_finish = true;
             stop_is_finish_exit_code = 1;
             break;
+	  case 'O': {
+		char*ep;
+		opt_level = strtoul(optarg, &ep, 10);
+		if (!isdigit((unsigned char)optarg[0]) || *ep != 0) {
+		      fprintf(stderr, "%s: Invalid optimization level \"%s\".\n",
+			      argv[0], optarg);
+		      flag_errors += 1;
+		}
+		break;
+	  }
+	  case 'P':
+	    profile_open(optarg);
+	    break;
+	  case 'q':
+	    if (! schedule_set_event_queue(optarg)) {
+		  fprintf(stderr, "%s: Unknown event queue \"%s\".\n",
+			  argv[0], optarg);
+		  flag_errors += 1;
+	    }
+	    break;
 	  case 's':
 	    schedule_stop(0);
 	    break;
@@ -474,6 +514,7 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, "           %8lu bufif\n",  count_functors_bufif);
 	    vpi_mcd_printf(1, "           %8lu resolv\n",count_functors_resolv);
 	    vpi_mcd_printf(1, "           %8lu signals\n", count_functors_sig);
+	    vpi_mcd_printf(1, "           %8lu flattened\n", count_functors_flattened);
 #ifdef __MINGW32__  /* MinGW does not know about z. */
 	    vpi_mcd_printf(1, " ... %8lu filters (net_fil pool=%u bytes)\n",
 #else
@@ -486,6 +527,7 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, " ... %8lu opcodes (%zu bytes)\n",
 #endif
 	                   count_opcodes, size_opcodes);
+	    vpi_mcd_printf(1, "           %8lu fused\n", count_opcodes_fused);
 	    vpi_mcd_printf(1, " ... %8lu nets\n",     count_vpi_nets);
 #ifdef __MINGW32__  /* MinGW does not know about z. */
 	    vpi_mcd_printf(1, " ... %8lu vvp_nets (%u bytes)\n",
@@ -499,6 +541,9 @@ int main(int argc, char*argv[])
 			   count_var_arrays+count_real_arrays);
 	    vpi_mcd_printf(1, "           %8lu logic (%lu words)\n",
 			   count_var_arrays, count_var_array_words);
+	    if (count_var_arrays_sparse > 0)
+		  vpi_mcd_printf(1, "           %8lu sparse logic\n",
+				 count_var_arrays_sparse);
 	    vpi_mcd_printf(1, "           %8lu real (%lu words)\n",
 			   count_real_arrays, count_real_array_words);
 	    vpi_mcd_printf(1, " ... %8lu scopes\n",   count_vpi_scopes);
@@ -513,15 +558,26 @@ int main(int argc, char*argv[])
 
       schedule_simulate();
 
+      profile_report();
+
       if (verbose_flag) {
 	    my_getrusage(cycles+2);
-	    print_rusage(cycles+2, cycles+1);
+	    double run_time = print_rusage(cycles+2, cycles+1);
 
 	    vpi_mcd_printf(1, "Event counts:\n");
-	    vpi_mcd_printf(1, "    %8lu time steps (pool=%lu)\n",
-			   count_time_events, count_time_pool());
+	    vpi_mcd_printf(1, "    %8lu time steps (pool=%lu, %s queue)\n",
+			   count_time_events, count_time_pool(),
+			   schedule_event_queue());
+	    vpi_mcd_printf(1, "             ...overflow=%lu\n",
+			   count_time_overflow);
 	    vpi_mcd_printf(1, "    %8lu thread schedule events\n",
 		    count_thread_events);
+	    if (run_time > 0.0) {
+		  vpi_mcd_printf(1, "    %8lu opcodes run (%.0f per second)\n",
+				 count_opcodes_run, count_opcodes_run/run_time);
+	    } else {
+		  vpi_mcd_printf(1, "    %8lu opcodes run\n", count_opcodes_run);
+	    }
 	    vpi_mcd_printf(1, "    %8lu assign events\n",
 		    count_assign_events);
 	    vpi_mcd_printf(1, "             ...assign(vec4) pool=%lu\n",
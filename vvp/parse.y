@@ -94,13 +94,14 @@ static struct __vpiModPath*modpath_dst = 0;
 %token K_RESOLV K_SCOPE K_SFUNC K_SFUNC_E K_SHIFTL K_SHIFTR K_SHIFTRS
 %token K_SUBSTITUTE
 %token K_THREAD K_TIMESCALE K_TRAN K_TRANIF0 K_TRANIF1 K_TRANVP
-%token K_UFUNC K_UFUNC_E K_UDP K_UDP_C K_UDP_S
+%token K_UFUNC K_UFUNC_E K_UFUNC_I K_UDP K_UDP_C K_UDP_S
 %token K_VAR K_VAR_COBJECT K_VAR_DARRAY
 %token K_VAR_QUEUE
 %token K_VAR_S K_VAR_STR K_VAR_I K_VAR_R K_VAR_2S K_VAR_2U
 %token K_vpi_call K_vpi_call_w K_vpi_call_i
 %token K_vpi_func K_vpi_func_r
 %token K_disable K_fork
+%token K_case_vec4 K_casex_vec4 K_casez_vec4
 %token K_ivl_version K_ivl_delay_selection
 %token K_vpi_module K_vpi_time_precision K_file_names K_file_line
 %token K_PORT_INPUT K_PORT_OUTPUT K_PORT_INOUT K_PORT_MIXED K_PORT_NODIR
@@ -259,14 +260,21 @@ statement
 		{ compile_ufunc($1, $3, $5,
 				$7.cnt, $7.vect,
 				$9.cnt, $9.vect,
-				$11, $12, 0); }
+				$11, $12, 0, false); }
+
+	| T_LABEL K_UFUNC_I T_SYMBOL ',' T_NUMBER ','
+	  symbols '(' symbols ')' symbol T_SYMBOL ';'
+		{ compile_ufunc($1, $3, $5,
+				$7.cnt, $7.vect,
+				$9.cnt, $9.vect,
+				$11, $12, 0, true); }
 
 	| T_LABEL K_UFUNC_E T_SYMBOL ',' T_NUMBER ',' T_SYMBOL ','
 	  symbols '(' symbols ')' symbol T_SYMBOL ';'
 		{ compile_ufunc($1, $3, $5,
 				$9.cnt, $9.vect,
 				$11.cnt, $11.vect,
-				$13, $14, $7); }
+				$13, $14, $7, false); }
 
   /* Resolver statements are very much like functors. They are
      compiled to functors of a different mode. */
@@ -658,6 +666,18 @@ statement
 	| label_opt K_fork symbol ',' symbol ';'
 		{ compile_fork($1, $3, $5); }
 
+  /* The %case/vec4 statements take a default label followed by a
+     list of constant and label pairs, so they are parsed uniquely. */
+
+	| label_opt K_case_vec4 symbols ';'
+		{ compile_case_vec4($1, 0, $3.cnt, $3.vect); }
+
+	| label_opt K_casex_vec4 symbols ';'
+		{ compile_case_vec4($1, 'x', $3.cnt, $3.vect); }
+
+	| label_opt K_casez_vec4 symbols ';'
+		{ compile_case_vec4($1, 'z', $3.cnt, $3.vect); }
+
   /* Scope statements come in two forms. There are the scope
      declaration and the scope recall. The declarations create the
      scope, with their association with a parent. The label of the
@@ -392,6 +392,158 @@ void vvp_fun_part_var_aa::recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&b
       }
 }
 
+const unsigned vvp_fun_permute::SRC_X;
+
+vvp_fun_permute::vvp_fun_permute(const std::vector<unsigned>&src,
+				 unsigned sched)
+: sched_(sched), sent_(false), val_(src.size(), BIT4_Z)
+{
+      net_ = 0;
+
+      run_s*cur = 0;
+      for (unsigned idx = 0 ; idx < src.size() ; idx += 1) {
+	    if (src[idx] == SRC_X) {
+		  val_.set_bit(idx, BIT4_X);
+		  cur = 0;
+		  continue;
+	    }
+
+	    unsigned pdx = src[idx] >> PORT_SHIFT;
+	    unsigned in = src[idx] & ((1U << PORT_SHIFT) - 1);
+	    assert(pdx < 4);
+
+	      // Extend the current run if this bit continues it,
+	      // either as the next bit or as a repeat of the bit.
+	    if (cur && !runs_[pdx].empty() && cur == &runs_[pdx].back()) {
+		  if (!cur->rep && in == cur->in+cur->wid) {
+			cur->wid += 1;
+			continue;
+		  }
+		  if (in == cur->in && (cur->rep || cur->wid == 1)) {
+			cur->rep = true;
+			cur->wid += 1;
+			continue;
+		  }
+	    }
+
+	    run_s tmp;
+	    tmp.out = idx;
+	    tmp.in = in;
+	    tmp.wid = 1;
+	    tmp.rep = false;
+	    runs_[pdx].push_back(tmp);
+	    cur = &runs_[pdx].back();
+      }
+}
+
+vvp_fun_permute::~vvp_fun_permute()
+{
+}
+
+void vvp_fun_permute::get_map(std::vector<unsigned>&src) const
+{
+      src.assign(val_.size(), SRC_X);
+      for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+	    for (size_t rdx = 0 ; rdx < runs_[pdx].size() ; rdx += 1) {
+		  const run_s&cur = runs_[pdx][rdx];
+		  for (unsigned idx = 0 ; idx < cur.wid ; idx += 1)
+			src[cur.out+idx] = (pdx << PORT_SHIFT)
+			      | (cur.rep? cur.in : cur.in+idx);
+	    }
+      }
+}
+
+/*
+ * Copy the bits of each run out of the input. Input bits past the end
+ * of the input vector are X, as for the part select.
+ */
+void vvp_fun_permute::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+				vvp_context_t)
+{
+      const std::vector<run_s>&runs = runs_[port.port()];
+      bool changed = false;
+
+      for (size_t rdx = 0 ; rdx < runs.size() ; rdx += 1) {
+	    const run_s&cur = runs[rdx];
+	    if (cur.rep) {
+		  vvp_bit4_t val = cur.in < bit.size()? bit.value(cur.in) : BIT4_X;
+		  vvp_vector4_t tmp (cur.wid, val);
+		  changed |= val_.set_vec(cur.out, tmp);
+		  continue;
+	    }
+
+	    unsigned cnt = 0;
+	    if (cur.in < bit.size())
+		  cnt = bit.size() - cur.in;
+	    if (cnt > cur.wid)
+		  cnt = cur.wid;
+	    if (cnt > 0)
+		  changed |= val_.set_vec(cur.out, bit, cur.in, cnt);
+	    if (cnt < cur.wid) {
+		  vvp_vector4_t tmp (cur.wid-cnt, BIT4_X);
+		  changed |= val_.set_vec(cur.out+cnt, tmp);
+	    }
+      }
+
+      send_(port, changed);
+}
+
+/*
+ * A part value changes only the bits of the runs that fall within
+ * the part. The rest of the output is left alone.
+ */
+void vvp_fun_permute::recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+				   unsigned base, unsigned wid, unsigned,
+				   vvp_context_t)
+{
+      assert(bit.size() == wid);
+
+      const std::vector<run_s>&runs = runs_[port.port()];
+      bool changed = false;
+
+      for (size_t rdx = 0 ; rdx < runs.size() ; rdx += 1) {
+	    const run_s&cur = runs[rdx];
+	    if (cur.rep) {
+		  if (cur.in < base || cur.in >= base+wid)
+			continue;
+		  vvp_vector4_t tmp (cur.wid, bit.value(cur.in-base));
+		  changed |= val_.set_vec(cur.out, tmp);
+		  continue;
+	    }
+
+	    unsigned lo = cur.in > base? cur.in : base;
+	    unsigned hi = cur.in+cur.wid < base+wid? cur.in+cur.wid : base+wid;
+	    if (lo < hi)
+		  changed |= val_.set_vec(cur.out+lo-cur.in, bit, lo-base, hi-lo);
+      }
+
+      send_(port, changed);
+}
+
+void vvp_fun_permute::send_(vvp_net_ptr_t port, bool changed)
+{
+      if (sched_ & (1U << port.port())) {
+	    if (sent_ && !changed)
+		  return;
+	    if (net_ == 0) {
+		  net_ = port.ptr();
+		  schedule_functor(this);
+	    }
+	    return;
+      }
+
+      sent_ = true;
+      port.ptr()->send_vec4(val_, 0);
+}
+
+void vvp_fun_permute::run_run()
+{
+      vvp_net_t*ptr = net_;
+      net_ = 0;
+      sent_ = true;
+      ptr->send_vec4(val_, 0);
+}
+
 /*
  * Given a node functor, create a network node and link it into the
  * netlist. This form assumes nodes with a single input.
@@ -21,6 +21,7 @@
 
 # include  "schedule.h"
 # include  "config.h"
+# include  <vector>
 
 /* vvp_fun_part
  * This node takes a part select of the input vector. Input 0 is the
@@ -34,6 +35,9 @@ class vvp_fun_part  : public vvp_net_fun_t {
       vvp_fun_part(unsigned base, unsigned wid);
       ~vvp_fun_part();
 
+      unsigned base() const { return base_; }
+      unsigned width() const { return wid_; }
+
     protected:
       unsigned base_;
       unsigned wid_;
@@ -189,4 +193,59 @@ class vvp_fun_part_var_aa  : public vvp_fun_part_var, public automatic_hooks_s {
       unsigned context_idx_;
 };
 
+/* vvp_fun_permute
+ * This node is not created by the compiler directly. The net
+ * flattening pass (see vvp_net_flatten) creates it to replace a chain
+ * of part select, concatenation, repeat, sign extension and bufz
+ * nodes. Each bit of the output is a fixed bit of one of the input
+ * ports, or a constant X. The map is kept as runs of consecutive bits
+ * so that the common cases are word copies.
+ *
+ * The sched mask has a bit set for each port whose path went through
+ * a vvp_fun_part_sa. Values arriving at those ports are filtered and
+ * scheduled as the part select would have done. Values arriving at
+ * the other ports are passed on at once, as a concatenation does.
+ */
+class vvp_fun_permute  : public vvp_net_fun_t, public vvp_gen_event_s {
+
+    public:
+	// The source of an output bit is (port<<PORT_SHIFT)|bit, or
+	// SRC_X for a bit that is always X.
+      enum { PORT_SHIFT = 30 };
+      static const unsigned SRC_X = ~0U;
+
+      vvp_fun_permute(const std::vector<unsigned>&src, unsigned sched);
+      ~vvp_fun_permute();
+
+	// Get back the source of each output bit.
+      void get_map(std::vector<unsigned>&src) const;
+      unsigned sched_mask() const { return sched_; }
+
+    public:
+      void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+                     vvp_context_t);
+
+      void recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+			unsigned, unsigned, unsigned,
+                        vvp_context_t);
+
+    private:
+      void run_run();
+      void send_(vvp_net_ptr_t port, bool changed);
+
+    private:
+	// A run copies wid bits of the input starting at in to the
+	// output starting at out. If the rep flag is set, the single
+	// input bit at in is instead copied wid times.
+      struct run_s {
+	    unsigned out, in, wid;
+	    bool rep;
+      };
+      std::vector<run_s> runs_[4];
+      unsigned sched_;
+      bool sent_;
+      vvp_vector4_t val_;
+      vvp_net_t*net_;
+};
+
 #endif /* IVL_part_H */
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "profile.h"
+# include  "vthread.h"
+# include  "vpi_priv.h"
+# include  <cstdio>
+# include  <cstring>
+# include  <string>
+# include  <vector>
+# include  <map>
+# include  <typeinfo>
+# include  <algorithm>
+# include  <cassert>
+
+using namespace std;
+
+bool profile_flag = false;
+static string profile_path;
+
+/*
+ * The opcode counts are kept in a small open hash table keyed by the
+ * opcode function pointer. This is looked up for every instruction
+ * executed, so it must be much cheaper than a map. There are only a
+ * few hundred distinct opcodes, so the table never fills.
+ */
+static const unsigned OPCODE_HASH_SIZE = 1024;
+struct opcode_count_s {
+      vvp_code_fun op;
+      unsigned long count;
+};
+static struct opcode_count_s opcode_hash[OPCODE_HASH_SIZE];
+
+/*
+ * These are the thread instructions run for each scope, and the
+ * number of vec4 values received by each type of functor.
+ */
+static map<struct __vpiScope*,unsigned long> scope_steps;
+static map<const type_info*,unsigned long> functor_recv;
+
+/*
+ * The queue depth is sampled at the end of each time step. To keep
+ * the sample set bounded for long simulations, keep only every
+ * stride'th time step, and whenever the samples buffer fills up,
+ * drop every other sample and double the stride.
+ */
+struct queue_sample_s {
+      vvp_time64_t time;
+      unsigned long events;
+      unsigned long pending;
+};
+static const size_t QUEUE_SAMPLES_MAX = 4096;
+static vector<queue_sample_s> queue_samples;
+static unsigned long queue_stride = 1;
+static unsigned long queue_steps = 0;
+static unsigned long queue_events = 0;
+static queue_sample_s queue_peak;
+
+void profile_open(const char*path)
+{
+      profile_flag = true;
+      profile_path = path;
+      vthread_enable_profile();
+      memset(opcode_hash, 0, sizeof opcode_hash);
+      memset(&queue_peak, 0, sizeof queue_peak);
+}
+
+void profile_opcode(vvp_code_fun op)
+{
+      size_t key = reinterpret_cast<size_t>(op);
+      unsigned idx = (key >> 4) % OPCODE_HASH_SIZE;
+      while (opcode_hash[idx].op != op) {
+	    if (opcode_hash[idx].op == 0) {
+		  opcode_hash[idx].op = op;
+		  break;
+	    }
+	    idx = (idx + 1) % OPCODE_HASH_SIZE;
+      }
+      opcode_hash[idx].count += 1;
+}
+
+void profile_thread(struct __vpiScope*scope, unsigned long steps)
+{
+      scope_steps[scope] += steps;
+}
+
+void profile_recv_vec4(const vvp_net_fun_t*fun)
+{
+      functor_recv[&typeid(*fun)] += 1;
+}
+
+void profile_time_step(vvp_time64_t time, unsigned long events,
+		       unsigned long pending)
+{
+      queue_steps += 1;
+      queue_events += events;
+      if (events > queue_peak.events) {
+	    queue_peak.time = time;
+	    queue_peak.events = events;
+	    queue_peak.pending = pending;
+      }
+
+      if ((queue_steps-1) % queue_stride != 0)
+	    return;
+
+      if (queue_samples.size() >= QUEUE_SAMPLES_MAX) {
+	    size_t keep = 0;
+	    for (size_t idx = 0 ; idx < queue_samples.size() ; idx += 2)
+		  queue_samples[keep++] = queue_samples[idx];
+	    queue_samples.resize(keep);
+	    queue_stride *= 2;
+	    if ((queue_steps-1) % queue_stride != 0)
+		  return;
+      }
+
+      queue_sample_s tmp;
+      tmp.time = time;
+      tmp.events = events;
+      tmp.pending = pending;
+      queue_samples.push_back(tmp);
+}
+
+template <class T> static bool count_greater(const pair<T,unsigned long>&a,
+					     const pair<T,unsigned long>&b)
+{
+      return a.second > b.second;
+}
+
+static double percent(unsigned long val, unsigned long total)
+{
+      return total? 100.0 * (double)val / (double)total : 0.0;
+}
+
+/*
+ * Write the scope path in the folded stack format, which is the scope
+ * names from the root down separated by semicolons.
+ */
+static void print_folded_scope(FILE*fd, struct __vpiScope*scope)
+{
+      if (scope == 0) {
+	    fprintf(fd, "<unknown>");
+	    return;
+      }
+      if (scope->scope) {
+	    print_folded_scope(fd, scope->scope);
+	    fputc(';', fd);
+      }
+      fprintf(fd, "%s", scope->name);
+}
+
+static void print_full_scope(FILE*fd, struct __vpiScope*scope)
+{
+      if (scope == 0) {
+	    fprintf(fd, "<unknown>");
+	    return;
+      }
+      if (scope->scope) {
+	    print_full_scope(fd, scope->scope);
+	    fputc('.', fd);
+      }
+      fprintf(fd, "%s", scope->name);
+}
+
+void profile_report(void)
+{
+      if (! profile_flag)
+	    return;
+
+      FILE*fd = fopen(profile_path.c_str(), "w");
+      if (fd == 0) {
+	    perror(profile_path.c_str());
+	    return;
+      }
+
+      fprintf(fd, "# vvp profile\n");
+
+	/* Opcodes, most frequent first. */
+      vector<pair<vvp_code_fun,unsigned long> > ops;
+      unsigned long ops_total = 0;
+      for (unsigned idx = 0 ; idx < OPCODE_HASH_SIZE ; idx += 1) {
+	    if (opcode_hash[idx].op == 0)
+		  continue;
+	    ops.push_back(make_pair(opcode_hash[idx].op, opcode_hash[idx].count));
+	    ops_total += opcode_hash[idx].count;
+      }
+      sort(ops.begin(), ops.end(), count_greater<vvp_code_fun>);
+
+      fprintf(fd, "\n# Opcodes executed (%lu total)\n", ops_total);
+      fprintf(fd, "#      count       %%  opcode\n");
+      for (size_t idx = 0 ; idx < ops.size() ; idx += 1) {
+	    const char*name = compile_opcode_name(ops[idx].first);
+	    fprintf(fd, "%12lu  %6.2f  %s\n", ops[idx].second,
+		    percent(ops[idx].second, ops_total),
+		    name? name : "<internal>");
+      }
+
+	/* Scopes, by the thread instructions run on their behalf. */
+      vector<pair<struct __vpiScope*,unsigned long> > scopes
+	    (scope_steps.begin(), scope_steps.end());
+      unsigned long scopes_total = 0;
+      for (size_t idx = 0 ; idx < scopes.size() ; idx += 1)
+	    scopes_total += scopes[idx].second;
+      sort(scopes.begin(), scopes.end(), count_greater<struct __vpiScope*>);
+
+      fprintf(fd, "\n# Thread instructions by scope\n");
+      fprintf(fd, "#      count       %%  scope\n");
+      for (size_t idx = 0 ; idx < scopes.size() ; idx += 1) {
+	    fprintf(fd, "%12lu  %6.2f  ", scopes[idx].second,
+		    percent(scopes[idx].second, scopes_total));
+	    print_full_scope(fd, scopes[idx].first);
+	    fputc('\n', fd);
+      }
+
+	/* Functor types, by the vec4 values they received. */
+      vector<pair<const type_info*,unsigned long> > funs
+	    (functor_recv.begin(), functor_recv.end());
+      unsigned long funs_total = 0;
+      for (size_t idx = 0 ; idx < funs.size() ; idx += 1)
+	    funs_total += funs[idx].second;
+      sort(funs.begin(), funs.end(), count_greater<const type_info*>);
+
+#ifdef PROFILE_FUNCTORS
+      fprintf(fd, "\n# Functor recv_vec4 calls by type (%lu total)\n", funs_total);
+      fprintf(fd, "#      count       %%  type\n");
+#else
+      fprintf(fd, "\n# Functor recv_vec4 calls by type (not counted,"
+	      " configure with --enable-profile)\n");
+#endif
+      for (size_t idx = 0 ; idx < funs.size() ; idx += 1) {
+	    fprintf(fd, "%12lu  %6.2f  %s\n", funs[idx].second,
+		    percent(funs[idx].second, funs_total),
+		    funs[idx].first->name());
+      }
+
+	/* The event queue over time. */
+      fprintf(fd, "\n# Event queue: %lu time steps, %lu events\n",
+	      queue_steps, queue_events);
+      if (queue_steps > 0) {
+	    fprintf(fd, "# peak: %lu events in the step at time %" TIME_FMT_U
+		    " (%lu steps pending)\n", queue_peak.events,
+		    queue_peak.time, queue_peak.pending);
+      }
+      fprintf(fd, "# one sample every %lu time steps\n", queue_stride);
+      fprintf(fd, "#                 time      events     pending\n");
+      for (size_t idx = 0 ; idx < queue_samples.size() ; idx += 1) {
+	    fprintf(fd, "%22" TIME_FMT_U "  %10lu  %10lu\n",
+		    queue_samples[idx].time, queue_samples[idx].events,
+		    queue_samples[idx].pending);
+      }
+
+      fclose(fd);
+
+	/* The flame graph tools take lines of semicolon separated
+	   stack frames followed by a count. */
+      string folded_path = profile_path + ".folded";
+      fd = fopen(folded_path.c_str(), "w");
+      if (fd == 0) {
+	    perror(folded_path.c_str());
+	    return;
+      }
+
+      for (size_t idx = 0 ; idx < scopes.size() ; idx += 1) {
+	    print_folded_scope(fd, scopes[idx].first);
+	    fprintf(fd, " %lu\n", scopes[idx].second);
+      }
+
+      fclose(fd);
+}
@@ -0,0 +1,52 @@
+#ifndef IVL_profile_H
+#define IVL_profile_H
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "codes.h"
+
+/*
+ * The profiler is enabled by the -P flag. While it is enabled, the
+ * run time counts the opcodes executed, the thread instructions run
+ * on behalf of each scope, the vec4 values received by each type of
+ * functor, and the depth of the event queue over simulation time. At
+ * the end of the simulation, profile_report() writes a flat report
+ * to the profile file and the per-scope counts in the folded stack
+ * format of the flame graph tools to the profile file with .folded
+ * appended.
+ *
+ * The thread loop counts through a separate instance of
+ * vthread_run, so the normal loop pays nothing for the profiler. The
+ * functor counts are made in the net propagation functions, so they
+ * are only compiled in if configured with --enable-profile.
+ */
+
+extern bool profile_flag;
+
+extern void profile_open(const char*path);
+
+extern void profile_opcode(vvp_code_fun op);
+extern void profile_thread(struct __vpiScope*scope, unsigned long steps);
+extern void profile_recv_vec4(const vvp_net_fun_t*fun);
+extern void profile_time_step(vvp_time64_t time, unsigned long events,
+			      unsigned long pending);
+
+extern void profile_report(void);
+
+#endif /* IVL_profile_H */
@@ -22,10 +22,13 @@
 # include  "vpi_priv.h"
 # include  "slab.h"
 # include  "compile.h"
+# include  "profile.h"
 # include  <new>
+# include  <map>
 # include  <typeinfo>
 # include  <csignal>
 # include  <cstdlib>
+# include  <cstring>
 # include  <cassert>
 
 # include  <iostream>
@@ -76,8 +79,15 @@ struct event_time_s {
 	    rosync = 0;
 	    del_thr = 0;
 	    next = NULL;
+	    delay = 0;
+	    time = 0;
       }
+	// The delay is relative to the previous event_time_s in the
+	// list scheduler, or to the current time for the head of the
+	// timing wheel. The time is the absolute time of this step,
+	// and is only maintained by the timing wheel.
       vvp_time64_t delay;
+      vvp_time64_t time;
 
       struct event_s*start;
       struct event_s*active;
@@ -473,12 +483,273 @@ inline void event_time_s::operator delete(void*ptr, size_t)
 unsigned long count_time_pool(void) { return event_time_heap.pool; }
 
 /*
- * This is the head of the list of pending events. This includes all
- * the events that have not been executed yet, and reaches into the
- * future.
+ * The pending time steps are kept in one of two structures, selected
+ * at startup by schedule_set_event_queue(). The event_time_s objects
+ * and the stratified event lists within them are the same for both.
+ *
+ * The "list" queue is a singly linked list of event_time_s objects
+ * sorted by time, with each delay relative to the previous entry.
+ * Inserting an event walks the list, so the cost is linear in the
+ * number of distinct pending times.
+ *
+ * The "wheel" queue is a timing wheel of WHEEL_SIZE slots covering
+ * the times [schedule_time, schedule_time+WHEEL_SIZE). Each slot holds
+ * at most one event_time_s, found directly by the low bits of its
+ * absolute time. A bitmap of the occupied slots makes finding the
+ * next time step a scan over a few words. Time steps that are too far
+ * in the future for the wheel go into an ordered overflow map, and
+ * are moved into the wheel as simulation time catches up to them.
  */
+static bool sched_wheel_flag = true;
+
 static struct event_time_s* sched_list = 0;
 
+static const unsigned WHEEL_BITS = 12;
+static const vvp_time64_t WHEEL_SIZE = 1 << WHEEL_BITS;
+static const unsigned WHEEL_WORD_BITS = 8*sizeof(unsigned long);
+static const unsigned WHEEL_WORDS = WHEEL_SIZE / WHEEL_WORD_BITS;
+
+static struct event_time_s* sched_wheel[WHEEL_SIZE];
+static unsigned long sched_wheel_map[WHEEL_WORDS];
+static unsigned long sched_wheel_count = 0;
+static std::map<vvp_time64_t,struct event_time_s*> sched_overflow;
+
+  // Count the time steps that passed through the overflow map.
+unsigned long count_time_overflow = 0;
+
+static vvp_time64_t schedule_time;
+
+bool schedule_set_event_queue(const char*name)
+{
+      if (strcmp(name, "wheel") == 0) {
+	    sched_wheel_flag = true;
+      } else if (strcmp(name, "list") == 0) {
+	    sched_wheel_flag = false;
+      } else {
+	    return false;
+      }
+
+      return true;
+}
+
+const char* schedule_event_queue(void)
+{
+      return sched_wheel_flag? "wheel" : "list";
+}
+
+static inline unsigned wheel_slot(vvp_time64_t tim)
+{
+      return (unsigned) (tim & (WHEEL_SIZE-1));
+}
+
+static void wheel_insert(struct event_time_s*ctim)
+{
+      unsigned slot = wheel_slot(ctim->time);
+      assert(sched_wheel[slot] == 0);
+      sched_wheel[slot] = ctim;
+      sched_wheel_map[slot/WHEEL_WORD_BITS] |= 1UL << (slot%WHEEL_WORD_BITS);
+      sched_wheel_count += 1;
+}
+
+static void wheel_remove(struct event_time_s*ctim)
+{
+      unsigned slot = wheel_slot(ctim->time);
+      assert(sched_wheel[slot] == ctim);
+      sched_wheel[slot] = 0;
+      sched_wheel_map[slot/WHEEL_WORD_BITS] &= ~(1UL << (slot%WHEEL_WORD_BITS));
+      sched_wheel_count -= 1;
+}
+
+/*
+ * Return the first occupied slot at or after the slot for the current
+ * time, wrapping around the wheel. The caller makes sure the wheel is
+ * not empty.
+ */
+static unsigned wheel_first_slot(void)
+{
+      unsigned slot = wheel_slot(schedule_time);
+      unsigned word = slot / WHEEL_WORD_BITS;
+      unsigned long mask = sched_wheel_map[word] & (~0UL << (slot%WHEEL_WORD_BITS));
+
+      for (unsigned idx = 0 ; idx <= WHEEL_WORDS ; idx += 1) {
+	    if (mask != 0) {
+		  unsigned bit = 0;
+		  while ((mask & 1UL) == 0) {
+			mask >>= 1;
+			bit += 1;
+		  }
+		  return word*WHEEL_WORD_BITS + bit;
+	    }
+	    word = (word+1) % WHEEL_WORDS;
+	    mask = sched_wheel_map[word];
+      }
+
+      assert(0);
+      return 0;
+}
+
+/*
+ * Find (or create) the event_time_s for the given absolute time in the
+ * wheel or the overflow map.
+ */
+static struct event_time_s* wheel_find_time(vvp_time64_t tim)
+{
+      if (tim - schedule_time < WHEEL_SIZE) {
+	    struct event_time_s*ctim = sched_wheel[wheel_slot(tim)];
+	    if (ctim == 0) {
+		  ctim = new struct event_time_s;
+		  ctim->time = tim;
+		  wheel_insert(ctim);
+	    }
+	    assert(ctim->time == tim);
+	    return ctim;
+      }
+
+      struct event_time_s*&ctim = sched_overflow[tim];
+      if (ctim == 0) {
+	    ctim = new struct event_time_s;
+	    ctim->time = tim;
+	    count_time_overflow += 1;
+      }
+      return ctim;
+}
+
+/*
+ * The current time has moved forward, so pull into the wheel all the
+ * overflow entries that now fit into it.
+ */
+static void wheel_advance(void)
+{
+      while (! sched_overflow.empty()) {
+	    std::map<vvp_time64_t,struct event_time_s*>::iterator cur
+		  = sched_overflow.begin();
+	    if (cur->first - schedule_time >= WHEEL_SIZE)
+		  break;
+	    wheel_insert(cur->second);
+	    sched_overflow.erase(cur);
+      }
+}
+
+static struct event_time_s* list_find_time(vvp_time64_t delay)
+{
+      struct event_time_s*ctim = sched_list;
+
+      if (sched_list == 0) {
+	      /* Is the event_time list completely empty? Create the
+		 first event_time object. */
+	    ctim = new struct event_time_s;
+	    ctim->delay = delay;
+	    ctim->next  = 0;
+	    sched_list = ctim;
+
+      } else if (sched_list->delay > delay) {
+
+	      /* Am I looking for an event before the first event_time?
+		 If so, create a new event_time to go in front. */
+	    struct event_time_s*tmp = new struct event_time_s;
+	    tmp->delay = delay;
+	    tmp->next = ctim;
+	    ctim->delay -= delay;
+	    ctim = tmp;
+	    sched_list = ctim;
+
+      } else {
+	    struct event_time_s*prev = 0;
+
+	    while (ctim->next && (ctim->delay < delay)) {
+		  delay -= ctim->delay;
+		  prev = ctim;
+		  ctim = ctim->next;
+	    }
+
+	    if (ctim->delay > delay) {
+		  struct event_time_s*tmp = new struct event_time_s;
+		  tmp->delay = delay;
+		  tmp->next  = prev->next;
+		  prev->next = tmp;
+
+		  tmp->next->delay -= delay;
+		  ctim = tmp;
+
+	    } else if (ctim->delay == delay) {
+
+	    } else {
+		  assert(ctim->next == 0);
+		  struct event_time_s*tmp = new struct event_time_s;
+		  tmp->delay = delay - ctim->delay;
+		  tmp->next = 0;
+		  ctim->next = tmp;
+
+		  ctim = tmp;
+	    }
+      }
+
+      return ctim;
+}
+
+/*
+ * Return the event_time_s for the earliest pending time step, or nil
+ * if there are no more events. The delay of the returned object is
+ * the time from the current time to that step.
+ */
+static struct event_time_s* sched_first_time(void)
+{
+      if (! sched_wheel_flag)
+	    return sched_list;
+
+      struct event_time_s*ctim = sched_wheel[wheel_slot(schedule_time)];
+      if (ctim == 0 || ctim->time != schedule_time) {
+	    if (sched_wheel_count > 0)
+		  ctim = sched_wheel[wheel_first_slot()];
+	    else if (! sched_overflow.empty())
+		  ctim = sched_overflow.begin()->second;
+	    else
+		  return 0;
+      }
+
+      ctim->delay = ctim->time - schedule_time;
+      return ctim;
+}
+
+/*
+ * The scheduler calls this when the current time has been advanced to
+ * the time of the first time step.
+ */
+static void sched_advance_time(void)
+{
+      if (sched_wheel_flag)
+	    wheel_advance();
+}
+
+/*
+ * Return the number of time steps waiting in the queue. This is only
+ * used by the profiler, so it is fine that the list case is slow.
+ */
+static unsigned long sched_pending_count(void)
+{
+      if (sched_wheel_flag)
+	    return sched_wheel_count + sched_overflow.size();
+
+      unsigned long count = 0;
+      for (struct event_time_s*cur = sched_list ; cur ; cur = cur->next)
+	    count += 1;
+      return count;
+}
+
+/*
+ * Remove the (now empty) first time step from the queue and release it.
+ */
+static void sched_release_first_time(struct event_time_s*ctim)
+{
+      if (sched_wheel_flag) {
+	    wheel_remove(ctim);
+      } else {
+	    assert(ctim == sched_list);
+	    sched_list = ctim->next;
+      }
+      delete ctim;
+}
+
 /*
  * This is a list of initialization events. The setup puts
  * initializations in this list so that they happen before the
@@ -586,57 +857,9 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
 {
       cur->next = cur;
 
-      struct event_time_s*ctim = sched_list;
-
-      if (sched_list == 0) {
-	      /* Is the event_time list completely empty? Create the
-		 first event_time object. */
-	    ctim = new struct event_time_s;
-	    ctim->delay = delay;
-	    ctim->next  = 0;
-	    sched_list = ctim;
-
-      } else if (sched_list->delay > delay) {
-
-	      /* Am I looking for an event before the first event_time?
-		 If so, create a new event_time to go in front. */
-	    struct event_time_s*tmp = new struct event_time_s;
-	    tmp->delay = delay;
-	    tmp->next = ctim;
-	    ctim->delay -= delay;
-	    ctim = tmp;
-	    sched_list = ctim;
-
-      } else {
-	    struct event_time_s*prev = 0;
-
-	    while (ctim->next && (ctim->delay < delay)) {
-		  delay -= ctim->delay;
-		  prev = ctim;
-		  ctim = ctim->next;
-	    }
-
-	    if (ctim->delay > delay) {
-		  struct event_time_s*tmp = new struct event_time_s;
-		  tmp->delay = delay;
-		  tmp->next  = prev->next;
-		  prev->next = tmp;
-
-		  tmp->next->delay -= delay;
-		  ctim = tmp;
-
-	    } else if (ctim->delay == delay) {
-
-	    } else {
-		  assert(ctim->next == 0);
-		  struct event_time_s*tmp = new struct event_time_s;
-		  tmp->delay = delay - ctim->delay;
-		  tmp->next = 0;
-		  ctim->next = tmp;
-
-		  ctim = tmp;
-	    }
-      }
+      struct event_time_s*ctim = sched_wheel_flag
+	    ? wheel_find_time(schedule_time + delay)
+	    : list_find_time(delay);
 
 	/* By this point, ctim is the event_time structure that is to
 	   receive the event at hand. Put the event in to the
@@ -718,13 +941,13 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
 
 static void schedule_event_push_(struct event_s*cur)
 {
-      if ((sched_list == 0) || (sched_list->delay > 0)) {
+      struct event_time_s*ctim = sched_first_time();
+
+      if ((ctim == 0) || (ctim->delay > 0)) {
 	    schedule_event_(cur, 0, SEQ_ACTIVE);
 	    return;
       }
 
-      struct event_time_s*ctim = sched_list;
-
       if (ctim->active == 0) {
 	    cur->next = cur;
 	    ctim->active = cur;
@@ -902,6 +1125,11 @@ void schedule_generic(vvp_gen_event_t obj, vvp_time64_t delay,
 
 static bool sim_started;
 
+bool schedule_started(void)
+{
+      return sim_started;
+}
+
 void schedule_functor(vvp_gen_event_t obj)
 {
       struct generic_event_s*cur = new generic_event_s;
@@ -924,7 +1152,6 @@ void schedule_at_start_of_simtime(vvp_gen_event_t obj, vvp_time64_t delay)
       schedule_event_(cur, delay, SEQ_START);
 }
 
-static vvp_time64_t schedule_time;
 vvp_time64_t schedule_simtime(void)
 { return schedule_time; }
 
@@ -1024,7 +1251,11 @@ void schedule_simulate(void)
       // process events and when done run the final blocks.
       run_finals = schedule_runnable;
 
-      if (schedule_runnable) while (sched_list) {
+	// The number of events run in the current time step, for the
+	// profiler.
+      unsigned long step_events = 0;
+
+      if (schedule_runnable) while (sched_first_time()) {
 
 	    if (schedule_stopped_flag) {
 		  schedule_stopped_flag = false;
@@ -1035,7 +1266,7 @@ void schedule_simulate(void)
 	    }
 
 	      /* ctim is the current time step. */
-	    struct event_time_s* ctim = sched_list;
+	    struct event_time_s* ctim = sched_first_time();
 
 	      /* If the time is advancing, then first run the
 		 postponed sync events. Run them all. */
@@ -1050,6 +1281,7 @@ void schedule_simulate(void)
 			     << schedule_time << endl;
 		  }
 		  ctim->delay = 0;
+		  sched_advance_time();
 
 		  vpiNextSimTime();
 		    // Process the cbAtStartOfSimTime callbacks.
@@ -1082,8 +1314,12 @@ void schedule_simulate(void)
 			     deletes threads as needed. */
 			if (ctim->active == 0) {
 			      run_rosync(ctim);
-			      sched_list = ctim->next;
-			      delete ctim;
+			      sched_release_first_time(ctim);
+			      if (profile_flag) {
+				    profile_time_step(schedule_time, step_events,
+						      sched_pending_count());
+				    step_events = 0;
+			      }
 			      continue;
 			}
 		  }
@@ -1105,6 +1341,7 @@ void schedule_simulate(void)
 		  schedule_single_step_flag = false;
 	    }
 
+	    step_events += 1;
 	    cur->run_run();
 
 	    delete (cur);
@@ -140,6 +140,17 @@ struct vvp_gen_event_s
       virtual void single_step_display(void);
 };
 
+/*
+ * Select the structure that holds the pending time steps. The name
+ * is "wheel" (the default) for the timing wheel, or "list" for the
+ * sorted list. This must be called before any events are scheduled,
+ * and returns false if the name is not recognized. The
+ * schedule_event_queue() function returns the name of the current
+ * selection.
+ */
+extern bool schedule_set_event_queue(const char*name);
+extern const char* schedule_event_queue(void);
+
 /*
  * This runs the simulator. It runs until all the functors run out or
  * the simulation is otherwise finished.
@@ -168,6 +179,13 @@ extern void schedule_single_step(int flag);
 extern bool schedule_finished(void);
 extern bool schedule_stopped(void);
 
+/*
+ * The schedule_started() function returns true once the
+ * initialization events have been run and the scheduler has started
+ * to run the simulation proper.
+ */
+extern bool schedule_started(void);
+
 /*
  * The scheduler calls this function to process stop events. When this
  * function returns, the simulation resumes.
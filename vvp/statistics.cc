@@ -24,12 +24,26 @@
  */
 unsigned long count_opcodes = 0;
 
+/*
+ * This is a count of the instructions that were replaced with fused
+ * superinstructions, and of the instructions dispatched by threads
+ * while the simulation ran.
+ */
+unsigned long count_opcodes_fused = 0;
+unsigned long count_opcodes_run = 0;
+
 unsigned long count_functors = 0;
 unsigned long count_functors_logic = 0;
 unsigned long count_functors_bufif = 0;
 unsigned long count_functors_resolv= 0;
 unsigned long count_functors_sig   = 0;
 
+/*
+ * This is a count of the functors that the net flattening pass merged
+ * into the functors they drive.
+ */
+unsigned long count_functors_flattened = 0;
+
 unsigned long count_filters = 0;
 unsigned long count_vpi_nets = 0;
 
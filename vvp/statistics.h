@@ -27,11 +27,14 @@
 #endif
 
 extern unsigned long count_opcodes;
+extern unsigned long count_opcodes_fused;
+extern unsigned long count_opcodes_run;
 extern unsigned long count_functors;
 extern unsigned long count_functors_logic;
 extern unsigned long count_functors_bufif;
 extern unsigned long count_functors_resolv;
 extern unsigned long count_functors_sig;
+extern unsigned long count_functors_flattened;
 extern unsigned long count_filters;
 extern unsigned long count_vvp_nets;
 extern unsigned long count_vpi_nets;
@@ -41,11 +44,13 @@ extern unsigned long count_net_arrays;
 extern unsigned long count_net_array_words;
 extern unsigned long count_var_arrays;
 extern unsigned long count_var_array_words;
+extern unsigned long count_var_arrays_sparse;
 extern unsigned long count_real_arrays;
 extern unsigned long count_real_array_words;
 
 
 extern unsigned long count_time_events;
+extern unsigned long count_time_overflow;
 extern unsigned long count_time_pool(void);
 
 extern unsigned long count_assign_events;
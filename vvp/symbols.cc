@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2001-2013 Stephen Williams (steve@icarus.com)
+ * Copyright (c) 2001-2014 Stephen Williams (steve@icarus.com)
  *
  *    This source code is free software; you can redistribute it
  *    and/or modify it in source code form under the terms of the GNU
@@ -28,371 +28,176 @@
  * for compact use of memory. This also makes it easy to delete the
  * entire lot of keys, simply by deleting the heaps.
  *
+ * There are many small tables (every scope has a name index) as well
+ * as a few huge ones, so the first heap is small and each new heap is
+ * twice the size of the last, up to a limit.
+ *
  * The key_strdup() function below allocates the strings from this
  * buffer, possibly making a new buffer if needed.
  */
 struct key_strings {
       struct key_strings*next;
-      char data[64*1024 - sizeof(struct key_strings*)];
+      size_t size;
+      char*data() { return reinterpret_cast<char*>(this+1); }
 };
 
-char*symbol_table_s::key_strdup_(const char*str)
-{
-      unsigned len = strlen(str);
-      assert( (len+1) <= sizeof str_chunk->data );
+static const size_t KEY_STRINGS_MIN = 256;
+static const size_t KEY_STRINGS_MAX = 64*1024;
 
-      if ( (len+1) > (sizeof str_chunk->data - str_used) ) {
-	    key_strings*tmp = new key_strings;
+char*symbol_table_s::key_strdup_(const char*str, size_t len)
+{
+      if (str_chunk == 0 || (len+1) > (str_chunk->size - str_used)) {
+	    size_t size = str_chunk? 2*str_chunk->size : KEY_STRINGS_MIN;
+	    if (size > KEY_STRINGS_MAX)
+		  size = KEY_STRINGS_MAX;
+	    if (size < len+1)
+		  size = len+1;
+
+	    key_strings*tmp = static_cast<key_strings*>
+		  (malloc(sizeof(key_strings) + size));
 	    tmp->next = str_chunk;
+	    tmp->size = size;
 	    str_chunk = tmp;
 	    str_used = 0;
       }
 
-      char*res = str_chunk->data + str_used;
+      char*res = str_chunk->data() + str_used;
       str_used += len + 1;
-      strcpy(res, str);
+      memcpy(res, str, len+1);
       return res;
 }
 
 /*
- * This is a B-Tree data structure, where there are nodes and
- * leaves.
- *
- * Nodes have a bunch of pointers to children. Each child pointer has
- * associated with it a key that is the largest key referenced by that
- * child. So, if the key being searched for has a value <= the first
- * key of a node, then the value is in the first child.
- *
- * leaves have a sorted table of key-value pairs. The search can use a
- * simple binary search to find an item. Each key represents an item.
+ * This is the FNV-1a string hash. It is cheap, and spreads the labels
+ * that the code generator makes (which differ mostly in their last
+ * few characters) well across the table. Get the length of the string
+ * while we are at it, since key_strdup_ needs it.
  */
-
-const unsigned leaf_width = 254;
-const unsigned node_width = 508;
-
-struct tree_data_ {
-      char*key;
-      symbol_value_t val;
-};
-
-struct tree_node_ {
-      bool leaf_flag;
-      unsigned count;
-      struct tree_node_*parent;
-
-      union {
-	    struct tree_data_ leaf[leaf_width];
-	    struct tree_node_ *child[node_width];
-      };
-
-};
-
-static inline char* node_last_key(struct tree_node_*node)
+static inline unsigned key_hash(const char*key, size_t&len)
 {
-      while (node->leaf_flag == false)
-	    node = node->child[node->count-1];
-
-      return node->leaf[node->count-1].key;
+      unsigned hash = 2166136261U;
+      const unsigned char*cp = reinterpret_cast<const unsigned char*>(key);
+      while (*cp) {
+	    hash ^= *cp++;
+	    hash *= 16777619U;
+      }
+      len = cp - reinterpret_cast<const unsigned char*>(key);
+      return hash;
 }
 
-/*
- * Allocate a new symbol table means creating the table structure and
- * a root node, and initializing the pointers and members of the root
- * node.
- */
 symbol_table_s::symbol_table_s()
 {
-      root = new struct tree_node_;
-      root->leaf_flag = false;
-      root->count = 0;
-      root->parent = 0;
-
-      str_chunk = new key_strings;
-      str_chunk->next = 0;
+      table_ = 0;
+      table_mask_ = 0;
+      count_ = 0;
+      str_chunk = 0;
       str_used = 0;
 }
 
-static void delete_symbol_node(struct tree_node_*cur)
-{
-      if (! cur->leaf_flag) {
-	    for (unsigned idx = 0 ;  idx < cur->count ;  idx += 1)
-		  delete_symbol_node(cur->child[idx]);
-      }
-
-      delete cur;
-}
-
-/* Do as split_leaf_ does, but for nodes. */
-static void split_node_(struct tree_node_*cur)
+/*
+ * Find the entry with the given key, or the empty slot where the key
+ * would go if it is not in the table. The table is never allowed to
+ * fill up, so there is always an empty slot to stop the probe. The
+ * hash is saved in the entry, so most mismatches are found without
+ * touching the key string.
+ */
+symbol_table_s::entry_s* symbol_table_s::find_slot_(const char*key,
+						    unsigned hash) const
 {
-      assert(!cur->leaf_flag);
-      if (cur->parent) assert(! cur->parent->leaf_flag);
-
-      while (cur->count == node_width) {
-	      /* Create a new node to hold half the data from cur. */
-	    struct tree_node_ *new_node = new struct tree_node_;
-	    new_node->leaf_flag = false;
-	    new_node->count = cur->count / 2;
-	      /* cur is not root; new_node becomes sibling. */
-	    if (cur->parent) new_node->parent = cur->parent;
-
-	      /* Move the last half of the data from the end of the old node
-	       * to the beginning of the new node. At the same time, reduce
-	       * the size of the old node. */
-	    unsigned idx1 = new_node->count;
-	    unsigned idx2 = cur->count;
-	    while (idx1 > 0) {
-		  idx1 -= 1;
-		  idx2 -= 1;
-		  new_node->child[idx1] = cur->child[idx2];
-		  new_node->child[idx1]->parent = new_node;
-		  cur->count -= 1;
-	    }
-
-	    assert(new_node->count > 0);
-	    assert(cur->count > 0);
-
-	    if (cur->parent == 0) {
-		    /* cur is root. Move first half of children to another
-		     * new node, and put the two new nodes in cur. The plan
-		     * here is to make cur into the new root and split its
-		     * contents into 2 children. */
-
-		  new_node->parent = cur;
-		  struct tree_node_*new2_node = new struct tree_node_;
-		  new2_node->leaf_flag = false;
-		  new2_node->count = cur->count;
-		  new2_node->parent = cur;
-		  for (unsigned idx = 0; idx < cur->count; idx += 1) {
-			new2_node->child[idx] = cur->child[idx];
-			new2_node->child[idx]->parent = new2_node;
-		  }
-		  cur->child[0] = new2_node;
-		  cur->child[1] = new_node;
-		  cur->count = 2;
-		    /* no more ancestors, stop the while loop */
-		  break;
-	    }
-
-	      /* cur is not root. hook new_node to cur->parent. */
-	    unsigned idx = 0;
-	    while (cur->parent->child[idx] != cur) {
-		  assert(idx < cur->parent->count);
-		  idx += 1;
-	    }
-	    idx += 1;
-
-	    for (unsigned tmp = cur->parent->count ;  tmp > idx ;  tmp -= 1) {
-		  cur->parent->child[tmp] = cur->parent->child[tmp-1];
-	    }
-
-	    cur->parent->child[idx] = new_node;
-	    cur->parent->count += 1;
-
-	      /* check the ancestor */
-	    cur = cur->parent;
+      unsigned idx = hash & table_mask_;
+      for (;;) {
+	    entry_s*cur = table_ + idx;
+	    if (cur->key == 0)
+		  return cur;
+	    if (cur->hash == hash && strcmp(cur->key, key) == 0)
+		  return cur;
+	    idx = (idx + 1) & table_mask_;
       }
 }
 
 /*
- * This function takes a leaf node and splits in into two. Move half
- * the leaf keys into the new node, and add the new leaf into the
- * parent node.
+ * Double the size of the table (or make the first one) and rehash the
+ * entries into it. The keys themselves do not move.
  */
-static struct tree_node_* split_leaf_(struct tree_node_*cur)
+void symbol_table_s::grow_table_(void)
 {
-      assert(cur->leaf_flag);
-      assert(cur->parent);
-      assert(! cur->parent->leaf_flag);
-
-	/* Create a new leaf to hold half the data from the old leaf. */
-      struct tree_node_*new_leaf = new struct tree_node_;
-      new_leaf->leaf_flag = true;
-      new_leaf->count = cur->count / 2;
-      new_leaf->parent = cur->parent;
-
-	/* Move the last half of the data from the end of the old leaf
-	   to the beginning of the new leaf. At the same time, reduce
-	   the size of the old leaf. */
-      unsigned idx1 = new_leaf->count;
-      unsigned idx2 = cur->count;
-      while (idx1 > 0) {
-	    idx1 -= 1;
-	    idx2 -= 1;
-	    new_leaf->leaf[idx1] = cur->leaf[idx2];
-	    cur->count -= 1;
+      entry_s*old_table = table_;
+      unsigned old_size = table_? table_mask_+1 : 0;
+      unsigned new_size = old_size? 2*old_size : 16;
+
+      table_ = new entry_s[new_size];
+      table_mask_ = new_size - 1;
+      for (unsigned idx = 0 ; idx < new_size ; idx += 1)
+	    table_[idx].key = 0;
+
+      for (unsigned idx = 0 ; idx < old_size ; idx += 1) {
+	    if (old_table[idx].key == 0)
+		  continue;
+	    unsigned pos = old_table[idx].hash & table_mask_;
+	    while (table_[pos].key != 0)
+		  pos = (pos + 1) & table_mask_;
+	    table_[pos] = old_table[idx];
       }
 
-      assert(new_leaf->count > 0);
-      assert(cur->count > 0);
-
-      unsigned idx = 0;
-      while (cur->parent->child[idx] != cur) {
-	    assert(idx < cur->parent->count);
-	    idx += 1;
-      }
-
-      idx += 1;
-
-      for (unsigned tmp = cur->parent->count ;  tmp > idx ;  tmp -= 1)
-	    cur->parent->child[tmp] = cur->parent->child[tmp-1];
-
-      cur->parent->child[idx] = new_leaf;
-      cur->parent->count += 1;
-
-      if (cur->parent->count == node_width)
-	    split_node_(cur->parent);
-
-      return new_leaf;
+      delete[]old_table;
 }
 
-
 /*
- * This function searches tree recursively for the key. If the value
- * is not found (and we are at a leaf) then set the key with the given
- * value. If the key is found, set the value only if the force_flag is
- * true.
+ * Locate the entry for the key, adding it with a zero value if it is
+ * not already present. Keep the table at most half full, so that the
+ * probe sequences stay short.
  */
-
-symbol_value_t symbol_table_s::find_value_(struct tree_node_*cur,
-					   const char*key, symbol_value_t val,
-					   bool force_flag)
+symbol_table_s::entry_s* symbol_table_s::find_or_add_(const char*key)
 {
-      if (cur->leaf_flag) {
-
-	    unsigned idx = 0;
-	    for (;;) {
-		    /* If we run out of keys in the leaf, then add
-		       this at the end of the leaf. */
-		  if (idx == cur->count) {
-			cur->leaf[idx].key = key_strdup_(key);
-			cur->leaf[idx].val = val;
-			cur->count += 1;
-			if (cur->count == leaf_width)
-			      split_leaf_(cur);
-
-			return val;
-		  }
-
-		  int rc = strcmp(key, cur->leaf[idx].key);
-
-		    /* If we found the key already in the table, then
-		       set the new value and break. */
-		  if (rc == 0) {
-			if (force_flag)
-			      cur->leaf[idx].val = val;
-			return cur->leaf[idx].val;
-		  }
-
-		    /* If this key goes before the current key, then
-		       push all the following entries back and add
-		       this key here. */
-		  if (rc < 0) {
-			for (unsigned tmp = cur->count; tmp > idx; tmp -= 1)
-			      cur->leaf[tmp] = cur->leaf[tmp-1];
-
-			cur->leaf[idx].key = key_strdup_(key);
-			cur->leaf[idx].val = val;
-			cur->count += 1;
-			if (cur->count == leaf_width)
-			      split_leaf_(cur);
-
-			return val;
-		  }
-
-		  idx += 1;
-	    }
-
-      } else {
-	      /* Do a binary search within the inner node. */
-	    unsigned min = 0;
-	    unsigned max = cur->count;
-	    unsigned idx = max/2;
-	    for (;;) {
-		  int rc = strcmp(key, node_last_key(cur->child[idx]));
-		  if (rc == 0) {
-			return find_value_(cur->child[idx],
-					   key, val, force_flag);
-		  }
-
-		  if (rc > 0) {
-			min = idx + 1;
-			if (min == cur->count)
-			      return find_value_(cur->child[idx],
-						 key, val, force_flag);
-			if (min == max)
-			      return find_value_(cur->child[max],
-						 key, val, force_flag);
-
-			idx = min + (max-min)/2;
-
-		  } else  {
-			max = idx;
-			if (idx == min)
-			      return find_value_(cur->child[idx],
-						 key, val, force_flag);
-			idx = min + (max-min)/2;
-		  }
-	    }
-      }
-
-      assert(0);
-      { symbol_value_t tmp;
-        tmp.num = 0;
-        return tmp;
-      }
+      if (table_ == 0 || 2*(count_+1) > table_mask_+1)
+	    grow_table_();
+
+      size_t len;
+      unsigned hash = key_hash(key, len);
+      entry_s*cur = find_slot_(key, hash);
+      if (cur->key)
+	    return cur;
+
+      cur->key = key_strdup_(key, len);
+      cur->hash = hash;
+      cur->val.num = 0;
+      count_ += 1;
+      return cur;
 }
 
 void symbol_table_s::sym_set_value(const char*key, symbol_value_t val)
 {
-      if (root->count == 0) {
-	      /* Handle the special case that this is the very first
-		 value in the symbol table. Create the first leaf node
-		 and initialize the pointers. */
-	    struct tree_node_*cur = new struct tree_node_;
-	    cur->leaf_flag = true;
-	    cur->parent = root;
-	    cur->count = 1;
-	    cur->leaf[0].key = key_strdup_(key);
-	    cur->leaf[0].val = val;
-
-	    root->count = 1;
-	    root->child[0] = cur;
-      } else {
-	    find_value_(root, key, val, true);
-      }
+      entry_s*cur = find_or_add_(key);
+      cur->val = val;
 }
 
 symbol_value_t symbol_table_s::sym_get_value(const char*key)
 {
-      symbol_value_t def;
-      def.num = 0;
+      entry_s*cur = find_or_add_(key);
+      return cur->val;
+}
+
+bool symbol_table_s::sym_peek_value(const char*key, symbol_value_t&val) const
+{
+      if (table_ == 0)
+	    return false;
 
-      if (root->count == 0) {
-	      /* Handle the special case that this is the very first
-		 value in the symbol table. Create the first leaf node
-		 and initialize the pointers. */
-	    struct tree_node_*cur = new struct tree_node_;
-	    cur->leaf_flag = true;
-	    cur->parent = root;
-	    cur->count = 1;
-	    cur->leaf[0].key = key_strdup_(key);
-	    cur->leaf[0].val = def;
+      size_t len;
+      unsigned hash = key_hash(key, len);
+      entry_s*cur = find_slot_(key, hash);
+      if (cur->key == 0)
+	    return false;
 
-	    root->count = 1;
-	    root->child[0] = cur;
-	    return cur->leaf[0].val;
-      } else {
-	    return find_value_(root, key, def, false);
-      }
+      val = cur->val;
+      return true;
 }
 
 symbol_table_s::~symbol_table_s()
 {
-      delete_symbol_node(root);
+      delete[]table_;
       while (str_chunk) {
 	    key_strings*tmp = str_chunk;
 	    str_chunk = tmp->next;
-	    delete tmp;
+	    free(tmp);
       }
 }
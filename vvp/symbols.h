@@ -27,7 +27,9 @@
  *
  * The key is an unstructured ASCII string, terminated by a
  * null. Items added to the table are not removed, unless the entire
- * table is deleted.
+ * table is deleted. The table is a hash table, so there is no order
+ * to the keys, but a lookup costs a string hash and (usually) a
+ * single string compare no matter how big the table gets.
  *
  * The compiler uses symbol tables to help match up operands to
  * referenced objects in the source. The compiler knows by the context
@@ -68,16 +70,32 @@ class symbol_table_s {
 	// zero and return the zero value.
       symbol_value_t sym_get_value(const char*key);
 
+	// This method locates the value in the symbol table and returns
+	// true if it is present, or false if it is not. The table is not
+	// changed either way.
+      bool sym_peek_value(const char*key, symbol_value_t&val) const;
+
     private:
       symbol_table_s(const symbol_table_s&) { assert(0); };
-      struct tree_node_*root;
+
+      struct entry_s {
+	    const char*key;
+	    unsigned hash;
+	    symbol_value_t val;
+      };
+	// The entries are an open addressed hash table with linear
+	// probing. The table size is always a power of 2.
+      struct entry_s*table_;
+      unsigned table_mask_;
+      unsigned count_;
+
       struct key_strings*str_chunk;
-      unsigned str_used;
+      size_t str_used;
 
-      symbol_value_t find_value_(struct tree_node_*cur,
-				 const char*key, symbol_value_t val,
-				 bool force_flag);
-      char*key_strdup_(const char*str);
+      struct entry_s*find_slot_(const char*key, unsigned hash) const;
+      struct entry_s*find_or_add_(const char*key);
+      void grow_table_(void);
+      char*key_strdup_(const char*str, size_t len);
 };
 
 /*
@@ -113,6 +131,15 @@ template <class T> class symbol_map_s : private symbol_table_s {
       { symbol_value_t val = symbol_table_s::sym_get_value(key);
 	return reinterpret_cast<T*>(val.ptr);
       }
+
+	// Return the value for the key, or nil if the key is not in
+	// the table. Unlike sym_get_value, this does not add the key.
+      T* sym_peek_value(const char*key) const
+      { symbol_value_t val;
+	if (! symbol_table_s::sym_peek_value(key, val))
+	      return 0;
+	return reinterpret_cast<T*>(val.ptr);
+      }
 };
 
 #endif /* IVL_symbols_H */
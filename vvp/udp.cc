@@ -82,9 +82,30 @@ ostream& operator <<(ostream&o, const struct udp_levels_table&table)
       return o;
 }
 
+const unsigned long udp_lookup_weight[UDP_LOOKUP_MAX_INPUTS+1] = {
+      1UL, 3UL, 9UL, 27UL, 81UL, 243UL, 729UL, 2187UL, 6561UL, 19683UL,
+      59049UL
+};
+
+/*
+ * The index digit for an input value. The udp_levels_table treats z
+ * as x, and so does this.
+ */
+static inline unsigned long lookup_digit(vvp_bit4_t val)
+{
+      switch (val) {
+	  case BIT4_0:
+	    return 0;
+	  case BIT4_1:
+	    return 1;
+	  default:
+	    return 2;
+      }
+}
+
 vvp_udp_s::vvp_udp_s(char*label, char*name__, unsigned ports,
                      vvp_bit4_t init, bool type)
-: name_(name__), ports_(ports), init_(init), seq_(type)
+: lookup_(false), name_(name__), ports_(ports), init_(init), seq_(type)
 {
       if (!udp_table)
 	    udp_table = new_symbol_table();
@@ -118,6 +139,29 @@ vvp_bit4_t vvp_udp_s::get_init() const
       return init_;
 }
 
+void vvp_udp_s::index_to_levels(udp_levels_table&tab, unsigned long idx,
+				unsigned width) const
+{
+      tab.mask0 = 0;
+      tab.mask1 = 0;
+      tab.maskx = 0;
+      for (unsigned pp = 0 ;  pp < width ;  pp += 1) {
+	    unsigned long mask_bit = 1UL << pp;
+	    switch (idx % 3) {
+		case 0:
+		  tab.mask0 |= mask_bit;
+		  break;
+		case 1:
+		  tab.mask1 |= mask_bit;
+		  break;
+		default:
+		  tab.maskx |= mask_bit;
+		  break;
+	    }
+	    idx /= 3;
+      }
+}
+
 vvp_udp_comb_s::vvp_udp_comb_s(char*label, char*name__, unsigned ports)
 : vvp_udp_s(label, name__, ports, BIT4_X, false)
 {
@@ -125,12 +169,14 @@ vvp_udp_comb_s::vvp_udp_comb_s(char*label, char*name__, unsigned ports)
       levels1_ = 0;
       nlevels0_ = 0;
       nlevels1_ = 0;
+      table_ = 0;
 }
 
 vvp_udp_comb_s::~vvp_udp_comb_s()
 {
       delete[] levels0_;
       delete[] levels1_;
+      delete[] table_;
 }
 
 /*
@@ -191,6 +237,12 @@ vvp_bit4_t vvp_udp_comb_s::calculate_output(const udp_levels_table&cur,
       return test_levels(cur);
 }
 
+vvp_bit4_t vvp_udp_comb_s::lookup_output(unsigned long cur, unsigned long,
+					 unsigned, vvp_bit4_t)
+{
+      return (vvp_bit4_t) table_[cur];
+}
+
 static void or_based_on_char(udp_levels_table&cur, char flag,
 			     unsigned long mask_bit)
 {
@@ -294,6 +346,19 @@ void vvp_udp_comb_s::compile_table(char**tab)
 
       assert(nrows0 == nlevels0_);
       assert(nrows1 == nlevels1_);
+
+      if (port_count() > UDP_LOOKUP_MAX_INPUTS)
+	    return;
+
+	/* Evaluate the rows for every possible input vector. */
+      unsigned long size = udp_lookup_weight[port_count()];
+      table_ = new unsigned char[size];
+      for (unsigned long idx = 0 ;  idx < size ;  idx += 1) {
+	    udp_levels_table cur;
+	    index_to_levels(cur, idx, port_count());
+	    table_[idx] = test_levels(cur);
+      }
+      lookup_ = true;
 }
 
 vvp_udp_seq_s::vvp_udp_seq_s(char*label, char*name__,
@@ -317,6 +382,9 @@ vvp_udp_seq_s::vvp_udp_seq_s(char*label, char*name__,
       nedges0_ = 0;
       nedges1_ = 0;
       nedgesL_ = 0;
+
+      levels_table_ = 0;
+      edges_table_ = 0;
 }
 
 vvp_udp_seq_s::~vvp_udp_seq_s()
@@ -328,6 +396,8 @@ vvp_udp_seq_s::~vvp_udp_seq_s()
       delete[] edges0_;
       delete[] edges1_;
       delete[] edgesL_;
+      delete[] levels_table_;
+      delete[] edges_table_;
 }
 
 void edge_based_on_char(struct udp_edges_table&cur, char chr, unsigned pos)
@@ -674,6 +744,46 @@ void vvp_udp_seq_s::compile_table(char**tab)
       assert(idx_edg1 == nedges1_);
       assert(idx_edgL == nedgesL_);
 
+      if (port_count() + 1 <= UDP_LOOKUP_MAX_INPUTS)
+	    compile_lookup_();
+}
+
+/*
+ * Evaluate the level and edge rows for every possible combination of
+ * current output and inputs, and for the edge rows every input that
+ * may have changed and every value that it may have changed from. The
+ * edges entries are only looked at if no level row matches, so the
+ * others are left as x.
+ */
+void vvp_udp_seq_s::compile_lookup_()
+{
+      unsigned long size = udp_lookup_weight[port_count()+1];
+      levels_table_ = new unsigned char[size];
+      edges_table_ = new unsigned char[3 * port_count() * size];
+      memset(edges_table_, BIT4_X, 3 * port_count() * size);
+
+      for (unsigned long idx = 0 ;  idx < size ;  idx += 1) {
+	    udp_levels_table cur;
+	    index_to_levels(cur, idx, port_count()+1);
+	    levels_table_[idx] = test_levels_(cur);
+	    if (levels_table_[idx] != BIT4_Z)
+		  continue;
+
+	    for (unsigned pp = 0 ;  pp < port_count() ;  pp += 1) {
+		  unsigned long cur_digit = (idx / udp_lookup_weight[pp]) % 3;
+		  for (unsigned long digit = 0 ;  digit < 3 ;  digit += 1) {
+			if (digit == cur_digit)
+			      continue;
+			unsigned long prev_idx = idx % udp_lookup_weight[port_count()];
+			prev_idx -= cur_digit * udp_lookup_weight[pp];
+			prev_idx += digit * udp_lookup_weight[pp];
+			udp_levels_table prev;
+			index_to_levels(prev, prev_idx, port_count());
+			edges_table_[(3*pp + digit) * size + idx] = test_edges_(cur, prev);
+		  }
+	    }
+      }
+      lookup_ = true;
 }
 
 bool operator == (const udp_levels_table&a, const udp_levels_table&b)
@@ -717,6 +827,23 @@ vvp_bit4_t vvp_udp_seq_s::calculate_output(const udp_levels_table&cur,
       return lev;
 }
 
+vvp_bit4_t vvp_udp_seq_s::lookup_output(unsigned long cur, unsigned long prev,
+					unsigned port, vvp_bit4_t cur_out)
+{
+      if (cur == prev)
+	    return cur_out;
+
+      unsigned long size = udp_lookup_weight[port_count()+1];
+      cur += lookup_digit(cur_out) * udp_lookup_weight[port_count()];
+
+      vvp_bit4_t lev = (vvp_bit4_t) levels_table_[cur];
+      if (lev != BIT4_Z)
+	    return lev;
+
+      unsigned long digit = (prev / udp_lookup_weight[port]) % 3;
+      return (vvp_bit4_t) edges_table_[(3*port + digit) * size + cur];
+}
+
 /*
  * This function tests the levels of the input with the additional
  * check match for the current output. It uses this to calculate a
@@ -910,6 +1037,9 @@ vvp_udp_fun_core::vvp_udp_fun_core(vvp_net_t*net, vvp_udp_s*def)
       current_.mask0 = 0;
       current_.mask1 = 0;
       current_.maskx = ~ ((-1UL) << port_count());
+      index_ = 0;
+      if (def_->has_lookup())
+	    index_ = udp_lookup_weight[port_count()] - 1;
 
       if (cur_out_ != BIT4_X)
 	    schedule_functor(this);
@@ -934,6 +1064,21 @@ void vvp_udp_fun_core::recv_vec4_from_inputs(unsigned port)
 	/* For now, assume udps are 1-bit wide. */
       assert(value(port).size() == 1);
 
+      if (def_->has_lookup()) {
+	    unsigned long prev = index_;
+	    unsigned long weight = udp_lookup_weight[port];
+	    index_ -= ((index_ / weight) % 3) * weight;
+	    index_ += lookup_digit(value(port).value(0)) * weight;
+
+	    vvp_bit4_t out_bit = def_->lookup_output(index_, prev, port, cur_out_);
+	    if (out_bit == cur_out_)
+		  return;
+
+	    cur_out_ = out_bit;
+	    schedule_functor(this);
+	    return;
+      }
+
       unsigned long mask = 1UL << port;
 
       udp_levels_table prev = current_;
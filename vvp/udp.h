@@ -48,6 +48,24 @@ struct vvp_udp_s {
 					  const udp_levels_table&prev,
 					  vvp_bit4_t cur_out) =0;
 
+	// Definitions with few enough inputs are also compiled into
+	// lookup tables indexed by the input values taken as a base
+	// 3 number, with 0, 1 and x (or z) as the digits and the
+	// first port as the least significant digit. Instances of
+	// these keep that index up to date and call lookup_output
+	// instead of calculate_output. The port is the input that
+	// changed to make cur from prev.
+      bool has_lookup() const { return lookup_; }
+      virtual vvp_bit4_t lookup_output(unsigned long cur, unsigned long prev,
+				       unsigned port, vvp_bit4_t cur_out) =0;
+
+    protected:
+	// Convert an input value index to the equivalent levels table.
+      void index_to_levels(udp_levels_table&tab, unsigned long idx,
+			   unsigned width) const;
+
+      bool lookup_;
+
     private:
       char *name_;
       unsigned ports_;
@@ -80,6 +98,12 @@ struct vvp_udp_s {
  * sensitive device is limited to the number of bits in an unsigned
  * long.
  *
+ * Scanning the rows for every input change is slow for devices with
+ * many rows, so if there are at most UDP_LOOKUP_MAX_INPUTS inputs,
+ * compile_table also evaluates the rows for every possible input
+ * vector and saves the results in a table of 3**port_count() entries.
+ * The rows are kept for printing and for wider devices.
+ *
  * The array of strings passed to the compile_table method of a
  * combinational UDP are strings of port_count()+1 characters. The
  * expected inputs are in the order of the UDP inputs, and the output
@@ -111,6 +135,9 @@ struct udp_levels_table {
 };
 extern ostream& operator<< (ostream&o, const struct udp_levels_table&t);
 
+const unsigned UDP_LOOKUP_MAX_INPUTS = 10;
+extern const unsigned long udp_lookup_weight[UDP_LOOKUP_MAX_INPUTS+1];
+
 class vvp_udp_comb_s : public vvp_udp_s {
 
     public:
@@ -126,11 +153,17 @@ class vvp_udp_comb_s : public vvp_udp_s {
 				  const udp_levels_table&prev,
 				  vvp_bit4_t cur_out);
 
+      vvp_bit4_t lookup_output(unsigned long cur, unsigned long prev,
+			       unsigned port, vvp_bit4_t cur_out);
+
     private:
 	// Level sensitive rows of the device.
       struct udp_levels_table*levels0_;
       struct udp_levels_table*levels1_;
       unsigned nlevels0_, nlevels1_;
+
+	// The output for each input vector, if compiled.
+      unsigned char*table_;
 };
 
 /*
@@ -166,6 +199,14 @@ class vvp_udp_comb_s : public vvp_udp_s {
  * position, and the edge_position the bit that has shifted. In the
  * edge case, the mask* members give the final position and the
  * edge_mask* bits the initial position of the bit.
+ *
+ * If port_count()+1 is at most UDP_LOOKUP_MAX_INPUTS, the rows are
+ * also compiled into lookup tables. The current output is an extra
+ * digit at position port_count() of the index. The levels table
+ * holds the result of the level rows for every index, or Z if none
+ * match. The edges table holds the result of the edge rows for every
+ * index, for each input that can have changed and each value that
+ * it can have changed from.
  */
 struct udp_edges_table {
       unsigned long edge_position : 8;
@@ -189,7 +230,12 @@ class vvp_udp_seq_s : public vvp_udp_s {
 				  const udp_levels_table&prev,
 				  vvp_bit4_t cur_out);
 
+      vvp_bit4_t lookup_output(unsigned long cur, unsigned long prev,
+			       unsigned port, vvp_bit4_t cur_out);
+
     private:
+      void compile_lookup_();
+
       vvp_bit4_t test_levels_(const udp_levels_table&cur);
 
 	// Level sensitive rows of the device.
@@ -208,6 +254,9 @@ class vvp_udp_seq_s : public vvp_udp_s {
       struct udp_edges_table*edgesL_;
       unsigned nedges0_, nedges1_, nedgesL_;
 
+	// The compiled lookup tables, if any.
+      unsigned char*levels_table_;
+      unsigned char*edges_table_;
 };
 
 /*
@@ -235,7 +284,10 @@ class vvp_udp_fun_core  : public vvp_wide_fun_core, private vvp_gen_event_s {
 
       vvp_udp_s*def_;
       vvp_bit4_t cur_out_;
+	// The current inputs, as a levels table or, if the definition
+	// has lookup tables, as an index into them.
       udp_levels_table current_;
+      unsigned long index_;
 };
 
 #endif /* IVL_udp_H */
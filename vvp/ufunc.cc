@@ -38,15 +38,27 @@
 #include <windows.h>
 #endif
 
+/*
+ * This counts the ufunc threads that are delivering their result. The
+ * propagation of the result may reach other ufunc cores, and these
+ * may run inline even though a (ufunc) thread is running. Limit the
+ * nesting so that long chains (or loops) of functions do not eat the
+ * stack. Beyond the limit the threads are scheduled.
+ */
+static unsigned ufunc_finish_depth = 0;
+static const unsigned UFUNC_INLINE_MAX_DEPTH = 64;
+
 ufunc_core::ufunc_core(unsigned owid, vvp_net_t*ptr,
 		       unsigned nports, vvp_net_t**ports,
 		       vvp_code_t sa, struct __vpiScope*call_scope__,
-		       char*result_label, char*scope_label)
+		       char*result_label, char*scope_label,
+		       bool inline_flag)
 : vvp_wide_fun_core(ptr, nports)
 {
       owid_ = owid;
       ports_ = ports;
       code_ = sa;
+      inline_ = inline_flag;
       thread_ = 0;
       call_scope_ = call_scope__;
 
@@ -95,6 +107,15 @@ void ufunc_core::assign_bits_to_ports(vvp_context_t context)
 		  } else {
 			tmp->recv_vec4(pp, tmp_val, context);
 		  }
+	    } else if (vvp_fun_signal2_sa*sig2 = dynamic_cast<vvp_fun_signal2_sa*>(net->fun)) {
+		  const vvp_vector4_t&tmp_val = value(idx);
+		  if (tmp_val.size() == 0) {
+			vvp_signal_value*sig = dynamic_cast<vvp_signal_value*>(net->fil);
+			vvp_vector4_t xxx (sig->value_size(), BIT4_X);
+			sig2->recv_vec4(pp, xxx, context);
+		  } else {
+			sig2->recv_vec4(pp, tmp_val, context);
+		  }
 	    }
       }
 }
@@ -107,11 +128,21 @@ void ufunc_core::assign_bits_to_ports(vvp_context_t context)
 void ufunc_core::finish_thread()
 {
       thread_ = 0;
+      ufunc_finish_depth += 1;
+
       if (vvp_fun_signal_real*sig = dynamic_cast<vvp_fun_signal_real*>(result_->fun))
 	    propagate_real(sig->real_unfiltered_value());
 
       if (vvp_fun_signal_vec*sig = dynamic_cast<vvp_fun_signal_vec*>(result_->fun))
 	    propagate_vec4(sig->vec4_unfiltered_value());
+
+      if (vvp_fun_signal2_sa*sig = dynamic_cast<vvp_fun_signal2_sa*>(result_->fun)) {
+	    vvp_vector4_t tmp;
+	    sig->vec4_unfiltered_value(tmp);
+	    propagate_vec4(tmp);
+      }
+
+      ufunc_finish_depth -= 1;
 }
 
 /*
@@ -139,9 +170,27 @@ void ufunc_core::recv_real_from_inputs(unsigned)
       invoke_thread_();
 }
 
+bool ufunc_core::can_run_inline_() const
+{
+      if (! inline_)
+	    return false;
+      if (! schedule_started() || schedule_finished())
+	    return false;
+      if (vthread_in_thread() && ufunc_finish_depth == 0)
+	    return false;
+      if (ufunc_finish_depth >= UFUNC_INLINE_MAX_DEPTH)
+	    return false;
+
+      return true;
+}
+
 void ufunc_core::invoke_thread_()
 {
       if (thread_ == 0) {
+	    if (can_run_inline_()) {
+		  vthread_run_ufunc(this, code_->cptr);
+		  return;
+	    }
 	    thread_ = vthread_new(code_, call_scope_);
 	    schedule_vthread(thread_, 0);
       }
@@ -161,7 +210,7 @@ void compile_ufunc(char*label, char*code, unsigned wid,
 		   unsigned argc,  struct symb_s*argv,
 		   unsigned portc, struct symb_s*portv,
 		   struct symb_s retv, char*scope_label,
-                   char*trigger_label)
+                   char*trigger_label, bool inline_flag)
 {
 	/* The input argument list and port list must have the same
 	   sizes, since internally we will be mapping the inputs list
@@ -210,7 +259,8 @@ void compile_ufunc(char*label, char*code, unsigned wid,
       vvp_net_t*ptr = new vvp_net_t;
       ufunc_core*fcore = new ufunc_core(wid, ptr, portc, ports,
 					exec_code, call_scope,
-					retv.text, scope_label);
+					retv.text, scope_label,
+					inline_flag && opt_level > 0);
       ptr->fun = fcore;
       define_functor_symbol(label, ptr);
       free(label);
@@ -45,6 +45,17 @@
  * netlist.
  *
  * This class relies to the vvp_wide_fun_* classes in vvp_net.h.
+ *
+ * Functions that the code generator marks with .ufunc/i only read
+ * their arguments and only write their own variables, so the order
+ * that they are evaluated in cannot be observed by other threads. If
+ * the link optimizations are enabled, the core runs the function body
+ * for these right away, from within the recv method, instead of
+ * scheduling the phantom thread. This is only done when no other
+ * thread is in the middle of running, since that thread may be using
+ * the variables of the function. Before the scheduler has started,
+ * the phantom thread is scheduled as usual so that the function sees
+ * initialized variables.
  */
 
 class ufunc_core : public vvp_wide_fun_core {
@@ -55,7 +66,8 @@ class ufunc_core : public vvp_wide_fun_core {
 		 vvp_code_t start_address,
 		 struct __vpiScope*call_scope,
 		 char*result_label,
-		 char*scope_label);
+		 char*scope_label,
+		 bool inline_flag);
       ~ufunc_core();
 
       struct __vpiScope*call_scope() { return call_scope_; }
@@ -72,7 +84,7 @@ class ufunc_core : public vvp_wide_fun_core {
       void recv_real_from_inputs(unsigned port);
 
       void invoke_thread_(void);
-
+      bool can_run_inline_(void) const;
 
     private:
 	// output width of the function node.
@@ -88,6 +100,9 @@ class ufunc_core : public vvp_wide_fun_core {
       struct __vpiScope*call_scope_;
       struct __vpiScope*func_scope_;
       vvp_code_t code_;
+	// True if the function body may be run from within the recv
+	// method. (See can_run_inline_.)
+      bool inline_;
 
 	// Where the result will be.
       vvp_net_t*result_;
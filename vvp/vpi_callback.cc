@@ -37,6 +37,9 @@
 # include  <cstdio>
 # include  <cassert>
 # include  <cstdlib>
+# include  <cstring>
+# include  <string>
+# include  <vector>
 /*
  * Callback handles are created when the VPI function registers a
  * callback. The handle is stored by the run time, and it triggered
@@ -672,40 +675,150 @@ void vvp_vpi_callback::add_vpi_callback(value_callback*cb)
 void vvp_vpi_callback::clear_all_callbacks()
 {
       while (vpi_callbacks_) {
-	    value_callback *tmp = dynamic_cast<value_callback*>
-	                            (vpi_callbacks_->next);
+	    value_callback *tmp = vpi_callbacks_->next_value();
 	    delete vpi_callbacks_;
 	    vpi_callbacks_ = tmp;
       }
 }
 #endif
 
+/*
+ * Each run of the value change callbacks of any object bumps this
+ * serial number, and the depth counts the runs that are in progress.
+ * A callback may change values, which runs callbacks from within
+ * callbacks, possibly of the same object.
+ */
+static unsigned long value_callback_serial = 0;
+static unsigned value_callback_depth = 0;
+
+/*
+ * When many callbacks are attached to an object, they typically all
+ * want the value in the same format. This cache gets the value from
+ * the object once for each format, and copies it to the other
+ * callbacks that want that format. The strings are copied out of the
+ * result buffer, because the callbacks may reuse that buffer.
+ *
+ * A cached value is only good as long as no other callbacks have run
+ * since it was gotten, because that is the only way that the value
+ * of the object can have changed.
+ */
+class value_callback_cache {
+
+    public:
+      explicit value_callback_cache(vvp_vpi_callback*obj);
+      void get_value(p_vpi_value vp);
+
+    private:
+      struct entry_s {
+	    PLI_INT32 format;
+	    s_vpi_value value;
+	    std::string str;
+      };
+      static const unsigned NENTRIES = 4;
+
+      vvp_vpi_callback*obj_;
+      unsigned long serial_;
+      unsigned nentries_;
+      entry_s entries_[NENTRIES];
+};
+
+inline value_callback_cache::value_callback_cache(vvp_vpi_callback*obj)
+: obj_(obj), serial_(value_callback_serial), nentries_(0)
+{
+}
+
+void value_callback_cache::get_value(p_vpi_value vp)
+{
+      bool is_str;
+      switch (vp->format) {
+	  case vpiBinStrVal:
+	  case vpiOctStrVal:
+	  case vpiDecStrVal:
+	  case vpiHexStrVal:
+	  case vpiStringVal:
+	    is_str = true;
+	    break;
+	  case vpiScalarVal:
+	  case vpiIntVal:
+	  case vpiRealVal:
+	    is_str = false;
+	    break;
+	  case vpiSuppressVal:
+	    return;
+	  default:
+	    obj_->get_value(vp);
+	    return;
+      }
+
+      if (serial_ != value_callback_serial) {
+	    serial_ = value_callback_serial;
+	    nentries_ = 0;
+      }
+
+      entry_s*cur = 0;
+      for (unsigned idx = 0 ;  idx < nentries_ ;  idx += 1) {
+	    if (entries_[idx].format == vp->format) {
+		  cur = entries_ + idx;
+		  break;
+	    }
+      }
+
+      if (cur == 0) {
+	    obj_->get_value(vp);
+	    if (nentries_ == NENTRIES)
+		  return;
+
+	    cur = entries_ + nentries_;
+	    nentries_ += 1;
+	    cur->format = vp->format;
+	    cur->value = *vp;
+	    if (is_str)
+		  cur->str = vp->value.str;
+      }
+
+      vp->value = cur->value.value;
+      if (is_str)
+	    vp->value.str = const_cast<char*>(cur->str.c_str());
+}
+
 /*
  * A vvp_fun_signal uses this method to run its callbacks whenever it
  * has a value change. If the cb_rtn is non-nil, then call the
  * callback function. If the cb_rtn pointer is nil, then the object
- * has been marked for deletion. Free it.
+ * has been marked for deletion. Free it, unless this is a nested run,
+ * where an outer run of this same list may be holding a pointer to
+ * it. The outermost run reaps it instead.
  */
 void vvp_vpi_callback::run_vpi_callbacks()
 {
       if (array_) array_->word_change(array_word_);
 
+      if (vpi_callbacks_ == 0)
+	    return;
+
+      value_callback_serial += 1;
+      value_callback_depth += 1;
+      value_callback_cache cache (this);
+
       value_callback *next = vpi_callbacks_;
       value_callback *prev = 0;
 
       while (next) {
 	    value_callback*cur = next;
-	    next = dynamic_cast<value_callback*>(cur->next);
+	    next = cur->next_value();
 
 	    if (cur->cb_data.cb_rtn != 0) {
 		  if (cur->test_value_callback_ready()) {
 			if (cur->cb_data.value)
-			      get_value(cur->cb_data.value);
+			      cache.get_value(cur->cb_data.value);
 
 			callback_execute(cur);
 		  }
 		  prev = cur;
 
+	    } else if (value_callback_depth > 1) {
+		  prev = cur;
+
 	    } else if (prev == 0) {
 
 		  vpi_callbacks_ = next;
@@ -719,6 +832,239 @@ void vvp_vpi_callback::run_vpi_callbacks()
 		  delete cur;
 	    }
       }
+
+      value_callback_depth -= 1;
+}
+
+/*
+ * The vpip_dump_* functions implement the batch value change
+ * interface that the waveform dumpers use. Each traced signal gets a
+ * dump_callback in its vpi callback list, like any cbValueChange
+ * callback, but the dump_callback never calls back into the VPI
+ * module. Instead, it marks the signal in the dirty bitmap of the
+ * dump and, for the first change in a time step, schedules the dump
+ * itself as a read-only synch event. When that event runs, the values
+ * of all the changed signals are collected and passed to the dump
+ * routine in one call.
+ */
+class dump_callback;
+
+struct __vpip_dump : public vvp_gen_event_s {
+
+      __vpip_dump(vpip_dump_rtn_t rtn, void*cd);
+      ~__vpip_dump();
+
+      void mark(unsigned index);
+      void run_run(void);
+
+      vpip_dump_rtn_t rtn;
+      void*cd;
+      bool enabled;
+      bool scheduled;
+
+      std::vector<dump_callback*> items;
+	// The dirty bitmap has a bit for each item, and the changed
+	// list has the index of each marked item in the order that
+	// they changed.
+      std::vector<bool> dirty;
+      std::vector<unsigned> changed;
+	// Buffers for collecting the changed values. These are kept
+	// from step to step so that they are not reallocated.
+      std::vector<s_vpip_dump_change> changes;
+      std::vector<s_vpi_vecval> values;
+      vvp_vector4_t tmp;
+};
+
+class dump_callback : public value_callback {
+    public:
+      dump_callback(p_cb_data data, __vpip_dump*dump, unsigned index,
+		    int type, vvp_signal_value*sig);
+
+      bool test_value_callback_ready(void);
+
+      __vpip_dump*dump;
+      unsigned index;
+	// The vpiType of the object, and its value for signals. Named
+	// events have no value.
+      int type;
+      vvp_signal_value*sig;
+};
+
+/*
+ * The cb_rtn of the dump_callback is never called, but it must not
+ * be nil, or the callback is taken to be removed.
+ */
+static PLI_INT32 dump_callback_rtn(p_cb_data)
+{
+      assert(0);
+      return 0;
+}
+
+dump_callback::dump_callback(p_cb_data data, __vpip_dump*d, unsigned idx,
+			     int t, vvp_signal_value*s)
+: value_callback(data), dump(d), index(idx), type(t), sig(s)
+{
+}
+
+bool dump_callback::test_value_callback_ready(void)
+{
+      if (dump->enabled)
+	    dump->mark(index);
+      return false;
+}
+
+__vpip_dump::__vpip_dump(vpip_dump_rtn_t r, void*c)
+: rtn(r), cd(c), enabled(false), scheduled(false)
+{
+}
+
+__vpip_dump::~__vpip_dump()
+{
+}
+
+inline void __vpip_dump::mark(unsigned index)
+{
+      if (dirty[index])
+	    return;
+
+      dirty[index] = true;
+      changed.push_back(index);
+
+      if (! scheduled) {
+	    schedule_generic(this, 0, true, true);
+	    scheduled = true;
+      }
+}
+
+void __vpip_dump::run_run(void)
+{
+      scheduled = false;
+
+	/* Size the value buffer first, so that the vector pointers
+	   into it remain valid while the changes are filled in. */
+      size_t nvalues = 0;
+      for (size_t idx = 0 ; idx < changed.size() ; idx += 1) {
+	    dump_callback*cur = items[changed[idx]];
+	    if (cur->type != vpiRealVar && cur->type != vpiNamedEvent)
+		  nvalues += (cur->sig->value_size() + 31) / 32;
+      }
+      if (values.size() < nvalues)
+	    values.resize(nvalues);
+      changes.resize(changed.size());
+
+	/* The changes are passed most recent first. */
+      size_t vdx = 0;
+      for (size_t idx = 0 ; idx < changed.size() ; idx += 1) {
+	    unsigned index = changed[changed.size()-idx-1];
+	    dump_callback*cur = items[index];
+	    s_vpip_dump_change&chg = changes[idx];
+	    dirty[index] = false;
+
+	    chg.user_data = cur->cb_data.user_data;
+	    chg.type = cur->type;
+	    chg.size = 0;
+	    chg.vector = 0;
+	    chg.real = 0.0;
+	    switch (cur->type) {
+		case vpiRealVar:
+		  chg.real = cur->sig->real_value();
+		  break;
+		case vpiNamedEvent:
+		  break;
+		default:
+		  cur->sig->vec4_value(tmp);
+		  chg.size = tmp.size();
+		  chg.vector = &values[vdx];
+		  tmp.get_vecval(chg.vector);
+		  vdx += (tmp.size() + 31) / 32;
+		  break;
+	    }
+      }
+      changed.clear();
+
+      if (! enabled)
+	    return;
+
+      assert(vpi_mode_flag == VPI_MODE_NONE);
+      vpi_mode_flag = VPI_MODE_ROSYNC;
+      rtn(schedule_simtime(), &changes[0], changes.size(), cd);
+      vpi_mode_flag = VPI_MODE_NONE;
+}
+
+vpip_dump_t vpip_dump_create(vpip_dump_rtn_t rtn, void*cd)
+{
+      return new __vpip_dump(rtn, cd);
+}
+
+PLI_INT32 vpip_dump_add(vpip_dump_t dump, vpiHandle obj, void*user_data)
+{
+      assert(dump);
+      if (vpi_get(vpiAutomatic, obj))
+	    return 0;
+
+      int type = obj->get_type_code();
+      vvp_net_t*net = 0;
+      __vpiNamedEvent*nev = 0;
+      switch (type) {
+	  case vpiReg:
+	  case vpiNet:
+	  case vpiIntegerVar:
+	  case vpiBitVar:
+	  case vpiByteVar:
+	  case vpiShortIntVar:
+	  case vpiIntVar:
+	  case vpiLongIntVar:
+	    if (__vpiSignal*sig = dynamic_cast<__vpiSignal*>(obj))
+		  net = sig->node;
+	    break;
+	  case vpiRealVar:
+	    if (__vpiRealVar*rfp = dynamic_cast<__vpiRealVar*>(obj))
+		  net = rfp->net;
+	    break;
+	  case vpiNamedEvent:
+	    nev = dynamic_cast<__vpiNamedEvent*>(obj);
+	    break;
+	  default:
+	      /* Array words, part selects and the like are left to
+		 the normal value change callbacks. */
+	    break;
+      }
+
+      vvp_net_fil_t*fil = 0;
+      vvp_signal_value*sig = 0;
+      if (net) {
+	    fil = dynamic_cast<vvp_net_fil_t*>(net->fil);
+	    sig = dynamic_cast<vvp_signal_value*>(net->fil);
+	    if (fil == 0 || sig == 0)
+		  return 0;
+      } else if (nev == 0) {
+	    return 0;
+      }
+
+      struct t_cb_data cb;
+      cb.reason = cbValueChange;
+      cb.cb_rtn = dump_callback_rtn;
+      cb.obj = obj;
+      cb.time = 0;
+      cb.value = 0;
+      cb.index = 0;
+      cb.user_data = (PLI_BYTE8*)user_data;
+
+      dump_callback*cbh = new dump_callback(&cb, dump, dump->items.size(),
+					    type, sig);
+      dump->items.push_back(cbh);
+      dump->dirty.push_back(false);
+      if (nev)
+	    nev->add_vpi_callback(cbh);
+      else
+	    fil->add_vpi_callback(cbh);
+      return 1;
+}
+
+void vpip_dump_enable(vpip_dump_t dump, PLI_INT32 flag)
+{
+      assert(dump);
+      dump->enabled = flag != 0;
 }
 
 void vvp_signal_value::get_signal_value(struct t_vpi_value*vp)
@@ -739,12 +1085,13 @@ void vvp_signal_value::get_signal_value(struct t_vpi_value*vp)
 	  case vpiVectorVal:
 	  case vpiStringVal:
 	  case vpiRealVal: {
-	    unsigned wid = value_size();
-	    vvp_vector4_t vec4(wid);
-	    for (unsigned idx = 0; idx < wid; idx += 1) {
-		  vec4.set_bit(idx, value(idx));
+	    if (const vvp_vector4_t*ref = vec4_value_ref()) {
+		  vpip_vec4_get_value(*ref, ref->size(), false, vp);
+		  break;
 	    }
-	    vpip_vec4_get_value(vec4, wid, false, vp);
+	    vvp_vector4_t vec4;
+	    vec4_value(vec4);
+	    vpip_vec4_get_value(vec4, vec4.size(), false, vp);
 	    break;
 	  }
 
@@ -850,6 +1197,11 @@ void vvp_wire_vec4::get_value(struct t_vpi_value*val)
       get_signal_value(val);
 }
 
+void vvp_wire_vec2::get_value(struct t_vpi_value*val)
+{
+      get_signal_value(val);
+}
+
 void vvp_wire_vec8::get_value(struct t_vpi_value*val)
 {
       get_signal_value(val);
@@ -109,7 +109,12 @@ void __vpiNamedEvent::run_vpi_callbacks()
 	    next = cur->next;
 
 	    if (cur->cb_data.cb_rtn != 0) {
-		  callback_execute(cur);
+		    /* These are all value change callbacks, which
+		       may be collected for a dump instead of being
+		       called. */
+		  value_callback*vcb = static_cast<value_callback*>(cur);
+		  if (vcb->test_value_callback_ready())
+			callback_execute(cur);
 		  prev = cur;
 
 	    } else if (prev == 0) {
@@ -31,6 +31,7 @@
 # include  <cstdlib>
 # include  <cmath>
 # include  <iostream>
+# include  "ivl_alloc.h"
 
 using namespace std;
 vpi_mode_t vpi_mode_flag = VPI_MODE_NONE;
@@ -623,6 +624,21 @@ static void vec4_get_value_string(const vvp_vector4_t&word_val, unsigned width,
       vp->value.str = rbuf;
 }
 
+const s_vpi_vecval* vpip_vec4_vecval(const vvp_vector4_t&bits)
+{
+      static s_vpi_vecval*vec = 0;
+      static unsigned vec_size = 0;
+
+      unsigned words = (bits.size() + 31) / 32;
+      if (words > vec_size) {
+	    vec_size = words;
+	    vec = (s_vpi_vecval*)realloc(vec, vec_size*sizeof(s_vpi_vecval));
+      }
+
+      bits.get_vecval(vec);
+      return vec;
+}
+
 /*
  * This is a generic function to convert a vvp_vector4_t value into a
  * vpi_value structure. The format is selected by the format of the
@@ -645,6 +661,11 @@ void vpip_vec4_get_value(const vvp_vector4_t&word_val, unsigned width,
 
 	  case vpiBinStrVal:
 	    rbuf = (char *) need_result_buf(width+1, RBUF_VAL);
+	    if (width == word_val.size()) {
+		  vpip_vec4_to_bin_str(word_val, rbuf, width+1);
+		  vp->value.str = rbuf;
+		  break;
+	    }
 	    for (unsigned idx = 0 ;  idx < width ;  idx += 1) {
 		  vvp_bit4_t bit = word_val.value(idx);
 		  rbuf[width-idx-1] = vvp_bit4_to_ascii(bit);
@@ -726,6 +747,11 @@ void vpip_vec4_get_value(const vvp_vector4_t&word_val, unsigned width,
 			need_result_buf(hwid * sizeof(s_vpi_vecval), RBUF_VAL);
 		vp->value.vector = op;
 
+		if (width == word_val.size()) {
+		      word_val.get_vecval(op);
+		      break;
+		}
+
 		op->aval = op->bval = 0;
 		for (unsigned idx = 0 ;  idx < width ;  idx += 1) {
 		      switch (word_val.value(idx)) {
@@ -1252,50 +1278,50 @@ vpiHandle vpi_handle_by_index(vpiHandle ref, PLI_INT32 idx)
 
 static vpiHandle find_name(const char *name, vpiHandle handle)
 {
-      vpiHandle rtn = 0;
       struct __vpiScope*ref = dynamic_cast<__vpiScope*>(handle);
 
-      /* check module names */
-      if (!strcmp(name, vpi_get_str(vpiName, handle)))
-	    rtn = handle;
-
-      /* brute force search for the name in all objects in this scope */
-      for (unsigned i = 0 ;  i < ref->nintern ;  i += 1) {
-	      /* The standard says that since a port does not have a full
-	       * name it cannot be found by name. Because of this we need
-	       * to skip ports here so the correct handle can be located. */
-	    if (vpi_get(vpiType, ref->intern[i]) == vpiPort) continue;
-	    char *nm = vpi_get_str(vpiName, ref->intern[i]);
-	    if (!strcmp(name, nm)) {
-		  rtn = ref->intern[i];
-		  break;
-	    } else if (vpi_get(vpiType, ref->intern[i]) == vpiMemory ||
-	               vpi_get(vpiType, ref->intern[i]) == vpiNetArray) {
-		  /* We need to iterate on the words */
-		  vpiHandle word_i, word_h;
-		  word_i = vpi_iterate(vpiMemoryWord, ref->intern[i]);
-		  while (word_i && (word_h = vpi_scan(word_i))) {
-			nm = vpi_get_str(vpiName, word_h);
-			if (!strcmp(name, nm)) {
-			      rtn = word_h;
-			      vpi_free_object(word_i);
-			      break;
+	/* check module names. A name that matches the scope itself
+	   finds the scope, except that the first object of the scope
+	   (ports aside), or a word of it, with the same name is found
+	   first. */
+      if (!strcmp(name, vpi_get_str(vpiName, handle))) {
+	    for (unsigned i = 0 ;  i < ref->nintern ;  i += 1) {
+		  vpiHandle cur = ref->intern[i];
+		  if (vpi_get(vpiType, cur) == vpiPort) continue;
+		  if (!strcmp(name, vpi_get_str(vpiName, cur)))
+			return cur;
+		  if (vpi_get(vpiType, cur) == vpiMemory ||
+		      vpi_get(vpiType, cur) == vpiNetArray) {
+			vpiHandle word_i, word_h;
+			word_i = vpi_iterate(vpiMemoryWord, cur);
+			while (word_i && (word_h = vpi_scan(word_i))) {
+			      if (!strcmp(name, vpi_get_str(vpiName, word_h))) {
+				    vpi_free_object(word_i);
+				    return word_h;
+			      }
 			}
 		  }
+		  break;
 	    }
-	    /* found it yet? */
-	    if (rtn) break;
+	    return handle;
       }
 
-      return rtn;
+	/* Look for the name in the objects of this scope. The scope
+	   keeps an index of these names, so this does not need to
+	   search all the objects. */
+      return vpip_find_scope_item(ref, name);
 }
 
+/*
+ * Find the scope with the dotted path name within the given scope,
+ * or within the root scopes if the handle is nil. Each component of
+ * the path is looked up in the name index of the scope above it.
+ */
 static vpiHandle find_scope(const char *name, vpiHandle handle, int depth)
 {
-
-      vpiHandle iter = handle==0
-	    ? vpi_iterate(vpiModule, NULL)
-	    : vpi_iterate(vpiInternalScope, handle);
+      struct __vpiScope*ref = dynamic_cast<__vpiScope*>(handle);
+      if (handle && ref == 0)
+	    return 0;
 
       vector<char> name_buf (strlen(name)+1);
       strcpy(&name_buf[0], name);
@@ -1305,24 +1331,9 @@ static vpiHandle find_scope(const char *name, vpiHandle handle, int depth)
 	    *nm_rest++ = 0;
       }
 
-      vpiHandle rtn = 0;
-      vpiHandle hand;
-      while (iter && (hand = vpi_scan(iter))) {
-	    char *nm = vpi_get_str(vpiName, hand);
-
-	    if (strcmp(nm_first,nm)==0) {
-		  if (nm_rest)
-			rtn=find_scope(nm_rest, hand, depth+1);
-		  else
-			rtn = hand;
-	    }
-
-	    /* found it yet ? */
-	    if (rtn) {
-		  vpi_free_object(iter);
-		  break;
-	    }
-      }
+      vpiHandle rtn = vpip_find_scope_child(ref, nm_first);
+      if (rtn && nm_rest)
+	    rtn = find_scope(nm_rest, rtn, depth+1);
 
       return rtn;
 }
@@ -189,6 +189,12 @@ class value_callback : public __vpiCallback {
 	// Return true if the callback really is ready to be called
       virtual bool test_value_callback_ready(void);
 
+	// The value change lists of vvp_vpi_callback objects hold
+	// nothing but value_callback objects, so the link can be
+	// followed without a dynamic_cast.
+      value_callback*next_value() const
+      { return static_cast<value_callback*>(next); }
+
     public:
 	// user supplied callback data
       struct t_vpi_time cb_time;
@@ -259,6 +265,8 @@ struct __vpiScope : public __vpiHandle {
 	/* Keep an array of internal scope items. */
       class __vpiHandle**intern;
       unsigned nintern;
+	/* Index of the intern items by name, made when first needed. */
+      struct scope_names_s*names;
 	/* Set of types */
       std::map<std::string,class_type*> classes;
         /* Keep an array of items to be automatically allocated */
@@ -268,8 +276,9 @@ struct __vpiScope : public __vpiHandle {
       vvp_context_t live_contexts;
         /* Keep a list of freed contexts. */
       vvp_context_t free_contexts;
-	/* Keep a list of threads in the scope. */
-      std::set<vthread_t> threads;
+	/* Keep a list of threads in the scope. The threads are linked
+	   together by the vthread code. */
+      vthread_t threads;
       signed int time_units :8;
       signed int time_precision :8;
 
@@ -280,6 +289,16 @@ struct __vpiScope : public __vpiHandle {
 extern struct __vpiScope* vpip_peek_current_scope(void);
 extern void vpip_attach_to_scope(struct __vpiScope*scope, vpiHandle obj);
 extern void vpip_attach_to_current_scope(vpiHandle obj);
+/*
+ * Look up an item of the scope by its vpiName, or a child scope of
+ * the scope by its name. A nil scope for vpip_find_scope_child means
+ * the root scopes. These are what vpi_handle_by_name uses to walk a
+ * hierarchical name.
+ */
+extern vpiHandle vpip_find_scope_item(struct __vpiScope*scope,
+				      const char*name);
+extern vpiHandle vpip_find_scope_child(struct __vpiScope*scope,
+				       const char*name);
 extern struct __vpiScope* vpip_peek_context_scope(void);
 extern unsigned vpip_add_item_to_context(automatic_hooks_s*item,
                                          struct __vpiScope*scope);
@@ -918,6 +937,32 @@ extern void vpip_vec4_to_hex_str(const vvp_vector4_t&bits, char*buf,
 extern void vpip_vec4_to_oct_str(const vvp_vector4_t&bits, char*buf,
 				 unsigned nbuf);
 
+extern void vpip_vec4_to_bin_str(const vvp_vector4_t&bits, char*buf,
+				 unsigned nbuf);
+
+/*
+ * The string formatters above work from the bits of the vector in the
+ * vpiVectorVal encoding, so that they can take the bits a word at a
+ * time instead of one at a time. This function gets those words into
+ * a buffer that is reused by the next call.
+ */
+extern const s_vpi_vecval* vpip_vec4_vecval(const vvp_vector4_t&bits);
+
+/*
+ * Convert up to 4 bits from the aval/bval words of a vecval to an
+ * index into the hex_digits and oct_digits tables. The tables use 2
+ * bits per bit, with 0 and 1 for themselves, 2 for x and 3 for z.
+ */
+inline unsigned vpip_vecval_spread_(unsigned bits)
+{
+      return (bits&1) | ((bits&2)<<1) | ((bits&4)<<2) | ((bits&8)<<3);
+}
+
+inline unsigned vpip_vecval_digit_index(unsigned aval, unsigned bval)
+{
+      return vpip_vecval_spread_(aval^bval) | (vpip_vecval_spread_(bval) << 1);
+}
+
 extern void vpip_bin_str_to_vec4(vvp_vector4_t&val, const char*buf);
 extern void vpip_oct_str_to_vec4(vvp_vector4_t&val, const char*str);
 extern void vpip_dec_str_to_vec4(vvp_vector4_t&val, const char*str);
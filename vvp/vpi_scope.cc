@@ -34,6 +34,23 @@
 static vpiHandle *vpip_root_table_ptr = 0;
 static unsigned   vpip_root_table_cnt = 0;
 
+/*
+ * The name index of a scope maps the vpiName of each of the intern
+ * items to the item, and the name of each child scope to the scope.
+ * Items can be added to a scope after the index is made, so the index
+ * remembers how many of the intern items it holds and picks up any
+ * new ones the next time it is used. Where two items have the same
+ * name, the first one wins, as it would in a search of the intern
+ * list. Ports have no full name, so cannot be found by name.
+ */
+struct scope_names_s {
+      symbol_map_s<__vpiHandle> items;
+      symbol_map_s<__vpiHandle> scopes;
+      unsigned count;
+};
+
+static struct scope_names_s*root_names = 0;
+
 vpiHandle vpip_make_root_iterator(void)
 {
       assert(vpip_root_table_ptr);
@@ -134,6 +151,7 @@ static void delete_sub_scopes(struct __vpiScope *scope)
 	    }
       }
       free(scope->intern);
+      delete scope->names;
 
 	/* Save any class definitions to clean up later. */
       map<std::string, class_type*>::iterator citer;
@@ -158,6 +176,8 @@ void root_table_delete(void)
       free(vpip_root_table_ptr);
       vpip_root_table_ptr = 0;
       vpip_root_table_cnt = 0;
+      delete root_names;
+      root_names = 0;
 
 	/* Clean up all the class definitions. */
       for (unsigned idx = 0; idx < class_list_count; idx += 1) {
@@ -436,6 +456,100 @@ void vpip_attach_to_scope(struct __vpiScope*scope, vpiHandle obj)
       scope->intern[idx] = obj;
 }
 
+static void add_scope_name(symbol_map_s<__vpiHandle>&map, vpiHandle obj,
+			   const char*name)
+{
+      if (name == 0 || map.sym_peek_value(name))
+	    return;
+      map.sym_set_value(name, obj);
+}
+
+static struct scope_names_s* scope_names(struct __vpiScope*scope)
+{
+      if (scope == 0) {
+	    if (root_names == 0) {
+		  root_names = new scope_names_s;
+		  root_names->count = 0;
+	    }
+	    for ( ; root_names->count < vpip_root_table_cnt
+		    ; root_names->count += 1) {
+		  struct __vpiScope*cur = static_cast<__vpiScope*>
+			(vpip_root_table_ptr[root_names->count]);
+		  add_scope_name(root_names->scopes, cur, cur->name);
+	    }
+	    return root_names;
+      }
+
+      if (scope->names == 0) {
+	    scope->names = new scope_names_s;
+	    scope->names->count = 0;
+      }
+
+      struct scope_names_s*names = scope->names;
+      for ( ; names->count < scope->nintern ; names->count += 1) {
+	    vpiHandle cur = scope->intern[names->count];
+	    int type = cur->get_type_code();
+	    if (type == vpiPort)
+		  continue;
+	    add_scope_name(names->items, cur, cur->vpi_get_str(vpiName));
+	    if (compare_types(vpiInternalScope, type))
+		  add_scope_name(names->scopes, cur, cur->vpi_get_str(vpiName));
+      }
+
+      return names;
+}
+
+vpiHandle vpip_find_scope_child(struct __vpiScope*scope, const char*name)
+{
+      return scope_names(scope)->scopes.sym_peek_value(name);
+}
+
+vpiHandle vpip_find_scope_item(struct __vpiScope*scope, const char*name)
+{
+      assert(scope);
+      struct scope_names_s*names = scope_names(scope);
+
+      vpiHandle obj = names->items.sym_peek_value(name);
+      if (obj)
+	    return obj;
+
+	/* The name may be a word of a memory or net array, for
+	   example "mem[3]". The words are not in the index, so look
+	   up the array and then the word by its address. */
+      const char*bracket = strrchr(name, '[');
+      if (bracket == 0 || bracket == name)
+	    return 0;
+
+      size_t len = bracket - name;
+      char*base = new char[len+1];
+      memcpy(base, name, len);
+      base[len] = 0;
+      obj = names->items.sym_peek_value(base);
+      delete[]base;
+      if (obj == 0)
+	    return 0;
+
+      int type = obj->get_type_code();
+      if (type != vpiMemory && type != vpiNetArray)
+	    return 0;
+
+      char*ep;
+      long addr = strtol(bracket+1, &ep, 10);
+      if (ep == bracket+1 || ep[0] != ']' || ep[1] != 0)
+	    return 0;
+
+      vpiHandle word = obj->vpi_index(addr);
+      if (word == 0)
+	    return 0;
+
+	/* Make sure the word really has the name that was asked for,
+	   and not just the same address spelled differently. */
+      if (strcmp(word->vpi_get_str(vpiName), name) != 0)
+	    return 0;
+
+      return word;
+}
+
 /*
  * When the compiler encounters a scope declaration, this function
  * creates and initializes a __vpiScope object with the requested name
@@ -491,10 +605,12 @@ compile_scope_decl(char*label, char*type, char*name, char*tname,
       scope->is_automatic = is_automatic;
       scope->intern = 0;
       scope->nintern = 0;
+      scope->names = 0;
       scope->item = 0;
       scope->nitem = 0;
       scope->live_contexts = 0;
       scope->free_contexts = 0;
+      scope->threads = 0;
 
       if (is_cell) scope->is_cell = true;
       else scope->is_cell = false;
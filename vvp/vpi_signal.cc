@@ -43,20 +43,6 @@
 #endif
 # include  "ivl_alloc.h"
 
-/*
- * Hex digits that represent 4-value bits of Verilog are not as
- * trivially obvious to display as if the bits were the usual 2-value
- * bits. So, although it is possible to write a function that
- * generates a correct character for 4*4-value bits, it is easier to
- * just perform the lookup in a table. This only takes 256 bytes,
- * which is not many executable instructions:-)
- *
- * The table is calculated at compile time, therefore, by the
- * draw_tt.c program.
- */
-extern const char hex_digits[256];
-extern const char oct_digits[64];
-
 /*
  * The string values need a result buf to hold the results. This
  * buffer can be reused for that purpose. Whenever I have a need, the
@@ -135,6 +121,37 @@ static vpiHandle fill_in_net4(struct __vpiSignal*obj,
 			      const char*name, int msb, int lsb,
 			      bool signed_flag, vvp_net_t*node);
 
+/*
+ * Get the part [base +: wid] of the signal value as a vector, with x
+ * for the bits that are outside the signal. In the usual case where
+ * the whole signal is wanted, the signal may be able to hand out a
+ * reference to its own vector, and then nothing is copied at all.
+ */
+static const vvp_vector4_t& signal_vec4_value(vvp_signal_value*sig,
+					     int base, unsigned wid,
+					     vvp_vector4_t&tmp)
+{
+      const vvp_vector4_t*ref = sig->vec4_value_ref();
+      if (ref == 0) {
+	    sig->vec4_value(tmp);
+	    ref = &tmp;
+      }
+
+      long ssize = (signed)ref->size();
+      if (base == 0 && (long)wid == ssize)
+	    return *ref;
+
+      long lo = base < 0? 0 : base;
+      long hi = base + (signed)wid;
+      if (hi > ssize) hi = ssize;
+
+      vvp_vector4_t part (wid, BIT4_X);
+      if (lo < hi)
+	    part.set_vec(lo-base, ref->subvalue(lo, hi-lo));
+      tmp = part;
+      return tmp;
+}
+
 /*
  * The standard formating/conversion routines.
  * They work with full or partial signals.
@@ -144,18 +161,8 @@ static void format_vpiBinStrVal(vvp_signal_value*sig, int base, unsigned wid,
                                 s_vpi_value*vp)
 {
       char *rbuf = (char *) need_result_buf(wid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long offset = end - 1;
-      long ssize = (signed)sig->value_size();
-
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    if (idx < 0 || idx >= ssize) {
-                  rbuf[offset-idx] = 'x';
-	    } else {
-                  rbuf[offset-idx] = vvp_bit4_to_ascii(sig->value(idx));
-	    }
-      }
-      rbuf[wid] = 0;
+      vvp_vector4_t tmp;
+      vpip_vec4_to_bin_str(signal_vec4_value(sig, base, wid, tmp), rbuf, wid+1);
 
       vp->value.str = rbuf;
 }
@@ -165,53 +172,8 @@ static void format_vpiOctStrVal(vvp_signal_value*sig, int base, unsigned wid,
 {
       unsigned dwid = (wid + 2) / 3;
       char *rbuf = (char *) need_result_buf(dwid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long ssize = (signed)sig->value_size();
-      unsigned val = 0;
-
-      rbuf[dwid] = 0;
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    unsigned bit = 0;
-	    if (idx < 0 || idx >= ssize) {
-                  bit = 2; // BIT4_X
-	    } else {
-                  switch (sig->value(idx)) {
-		      case BIT4_0:
-			bit = 0;
-			break;
-		      case BIT4_1:
-			bit = 1;
-			break;
-		      case BIT4_X:
-			bit = 2;
-			break;
-		      case BIT4_Z:
-			bit = 3;
-			break;
-                  }
-	    }
-	    val |= bit << 2*((idx-base) % 3);
-
-	    if ((idx-base) % 3 == 2) {
-		dwid -= 1;
-		rbuf[dwid] = oct_digits[val];
-		val = 0;
-	    }
-      }
-
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (wid % 3) {
-	  case 1:
-	    if (val == 2) val = 42;
-	    else if (val == 3) val = 63;
-	    break;
-	  case 2:
-	    if (val == 10) val = 42;
-	    else if (val == 15) val = 63;
-	    break;
-      }
-
-      if (dwid > 0) rbuf[0] = oct_digits[val];
+      vvp_vector4_t tmp;
+      vpip_vec4_to_oct_str(signal_vec4_value(sig, base, wid, tmp), rbuf, dwid+1);
 
       vp->value.str = rbuf;
 }
@@ -221,57 +183,8 @@ static void format_vpiHexStrVal(vvp_signal_value*sig, int base, unsigned wid,
 {
       unsigned dwid = (wid + 3) / 4;
       char *rbuf = (char *) need_result_buf(dwid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long ssize = (signed)sig->value_size();
-      unsigned val = 0;
-
-      rbuf[dwid] = 0;
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    unsigned bit = 0;
-	    if (idx < 0 || idx >= ssize) {
-                  bit = 2; // BIT4_X
-	    } else {
-                  switch (sig->value(idx)) {
-		      case BIT4_0:
-			bit = 0;
-			break;
-		      case BIT4_1:
-			bit = 1;
-			break;
-		      case BIT4_X:
-			bit = 2;
-			break;
-		      case BIT4_Z:
-			bit = 3;
-			break;
-                  }
-	    }
-	    val |= bit << 2*((idx-base) % 4);
-
-	    if ((idx-base) % 4 == 3) {
-		dwid -= 1;
-		rbuf[dwid] = hex_digits[val];
-		val = 0;
-	    }
-      }
-
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (wid % 4) {
-	  case 1:
-	    if (val == 2) val = 170;
-	    else if (val == 3) val = 255;
-	    break;
-	  case 2:
-	    if (val == 10) val = 170;
-	    else if (val == 15) val = 255;
-	    break;
-	  case 3:
-	    if (val == 42) val = 170;
-	    else if (val == 63) val = 255;
-	    break;
-      }
-
-      if (dwid > 0) rbuf[0] = hex_digits[val];
+      vvp_vector4_t tmp;
+      vpip_vec4_to_hex_str(signal_vec4_value(sig, base, wid, tmp), rbuf, dwid+1);
 
       vp->value.str = rbuf;
 }
@@ -477,48 +390,14 @@ static void format_vpiStrengthVal(vvp_signal_value*sig, int base,
 static void format_vpiVectorVal(vvp_signal_value*sig, int base, unsigned wid,
                                 s_vpi_value*vp)
 {
-      long end = base + (signed)wid;
-      unsigned int obit = 0;
       unsigned hwid = (wid + 31)/32;
 
       s_vpi_vecval *op = (p_vpi_vecval)
                          need_result_buf(hwid * sizeof(s_vpi_vecval), RBUF_VAL);
       vp->value.vector = op;
 
-      op->aval = op->bval = 0;
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    if (base >= 0 && base < (signed)sig->value_size()) {
-		switch (sig->value(idx)) {
-		case BIT4_0:
-		  op->aval &= ~(1 << obit);
-		  op->bval &= ~(1 << obit);
-		  break;
-		case BIT4_1:
-		  op->aval |= (1 << obit);
-		  op->bval &= ~(1 << obit);
-		  break;
-		case BIT4_X:
-		  op->aval |= (1 << obit);
-		  op->bval |= (1 << obit);
-		  break;
-		case BIT4_Z:
-		  op->aval &= ~(1 << obit);
-		  op->bval |= (1 << obit);
-		  break;
-		}
-	    } else {  /* BIT4_X */
-		  op->aval |= (1 << obit);
-		  op->bval |= (1 << obit);
-	    }
-
-	    obit++;
-	    if (!(obit % 32)) {
-		  op += 1;
-		  if ((op - vp->value.vector) < (ptrdiff_t)hwid)
-			op->aval = op->bval = 0;
-		  obit = 0;
-	    }
-      }
+      vvp_vector4_t tmp;
+      signal_vec4_value(sig, base, wid, tmp).get_vecval(op);
 }
 
 /*
@@ -859,15 +738,7 @@ vvp_vector4_t vec4_from_vpi_value(s_vpi_value*vp, unsigned wid)
 	  }
 
 	  case vpiVectorVal:
-	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
-		  unsigned long aval = vp->value.vector[idx/32].aval;
-		  unsigned long bval = vp->value.vector[idx/32].bval;
-		  aval >>= idx%32;
-		  bval >>= idx%32;
-		  int bitmask = (aval&1) | ((bval<<1)&2);
-		  vvp_bit4_t bit = scalar_to_bit4(bitmask);
-		  val.set_bit(idx, bit);
-	    }
+	    val.set_vecval(vp->value.vector);
 	    break;
 	  case vpiBinStrVal:
 	    vpip_bin_str_to_vec4(val, vp->value.str);
@@ -110,3 +110,26 @@ void vpip_bin_str_to_vec4(vvp_vector4_t&vec4, const char*buf)
 	    else vec4.set_bit(jdx, pad);
       }
 }
+
+void vpip_vec4_to_bin_str(const vvp_vector4_t&bits, char*buf, unsigned nbuf)
+{
+      static const char bin_digits[4] = { '0', '1', 'z', 'x' };
+      unsigned size = bits.size();
+      assert(size < nbuf);
+
+      buf[size] = 0;
+
+      const s_vpi_vecval*vec = vpip_vec4_vecval(bits);
+      char*cp = buf + size;
+      for (unsigned wdx = 0 ;  wdx < (size+31)/32 ;  wdx += 1) {
+	    PLI_UINT32 aval = vec[wdx].aval;
+	    PLI_UINT32 bval = vec[wdx].bval;
+	    unsigned cnt = size - wdx*32;
+	    if (cnt > 32) cnt = 32;
+	    for (unsigned idx = 0 ;  idx < cnt ;  idx += 1) {
+		  *--cp = bin_digits[((bval&1) << 1) | (aval&1)];
+		  aval >>= 1;
+		  bval >>= 1;
+	    }
+      }
+}
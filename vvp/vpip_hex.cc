@@ -25,6 +25,17 @@
 # include  <cstdlib>
 # include  <cassert>
 
+/*
+ * Hex digits that represent 4-value bits of Verilog are not as
+ * trivially obvious to display as if the bits were the usual 2-value
+ * bits. So, although it is possible to write a function that
+ * generates a correct character for 4*4-value bits, it is easier to
+ * just perform the lookup in a table. This only takes 256 bytes,
+ * which is not many executable instructions:-)
+ *
+ * The table is calculated at compile time, therefore, by the
+ * draw_tt.c program.
+ */
 extern const char hex_digits[256];
 
 void vpip_hex_str_to_vec4(vvp_vector4_t&val, const char*str)
@@ -140,52 +151,29 @@ void vpip_hex_str_to_vec4(vvp_vector4_t&val, const char*str)
 
 void vpip_vec4_to_hex_str(const vvp_vector4_t&bits, char*buf, unsigned nbuf)
 {
-      unsigned slen = (bits.size() + 3) / 4;
+      unsigned size = bits.size();
+      unsigned slen = (size + 3) / 4;
       assert(slen < nbuf);
 
       buf[slen] = 0;
 
-      unsigned val = 0;
-      for (unsigned idx = 0 ;  idx < bits.size() ;  idx += 1) {
-	    unsigned vs = (idx%4) * 2;
-
-	    switch (bits.value(idx)) {
-		case BIT4_0:
-		  break;
-		case BIT4_1:
-		  val |= 1 << vs;
-		  break;
-		case BIT4_X:
-		  val |= 2 << vs;
-		  break;
-		case BIT4_Z:
-		  val |= 3 << vs;
+	/* The digits never straddle the 32 bit vecval words, so
+	   each digit comes from a nibble of the aval/bval words. */
+      const s_vpi_vecval*vec = vpip_vec4_vecval(bits);
+      for (unsigned idx = 0 ;  idx < size ;  idx += 4) {
+	    unsigned sh = idx % 32;
+	    unsigned aval = ((PLI_UINT32)vec[idx/32].aval >> sh) & 0xf;
+	    unsigned bval = ((PLI_UINT32)vec[idx/32].bval >> sh) & 0xf;
+	    unsigned val = vpip_vecval_digit_index(aval, bval);
+
+	      /* Fill in X or Z if they are the only thing in the
+		 partial most significant digit. */
+	    if (idx+4 > size) {
+		  unsigned mask = (1U << (size-idx)) - 1;
+		  if (bval == mask && aval == mask) val = 170;
+		  else if (bval == mask && aval == 0) val = 255;
 	    }
 
-	    if (vs == 6) {
-		  slen -= 1;
-		  buf[slen] = hex_digits[val];
-		  val = 0;
-	    }
-      }
-
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (bits.size() % 4) {
-	  case 1:
-	    if (val == 2) val = 170;
-	    else if (val == 3) val = 255;
-	    break;
-	  case 2:
-	    if (val == 10) val = 170;
-	    else if (val == 15) val = 255;
-	    break;
-	  case 3:
-	    if (val == 42) val = 170;
-	    else if (val == 63) val = 255;
-	    break;
-      }
-
-      if (slen > 0) {
 	    slen -= 1;
 	    buf[slen] = hex_digits[val];
       }
@@ -121,48 +121,35 @@ void vpip_oct_str_to_vec4(vvp_vector4_t&val, const char*str)
 
 void vpip_vec4_to_oct_str(const vvp_vector4_t&bits, char*buf, unsigned nbuf)
 {
-      unsigned slen = (bits.size() + 2) / 3;
+      unsigned size = bits.size();
+      unsigned slen = (size + 2) / 3;
       assert(slen < nbuf);
 
       buf[slen] = 0;
 
-      unsigned val = 0;
-      for (unsigned idx = 0 ;  idx < bits.size() ;  idx += 1) {
-	    unsigned vs = (idx%3) * 2;
-
-	    switch (bits.value(idx)) {
-		case BIT4_0:
-		  break;
-		case BIT4_1:
-		  val |= 1 << vs;
-		  break;
-		case BIT4_X:
-		  val |= 2 << vs;
-		  break;
-		case BIT4_Z:
-		  val |= 3 << vs;
+      const s_vpi_vecval*vec = vpip_vec4_vecval(bits);
+      for (unsigned idx = 0 ;  idx < size ;  idx += 3) {
+	    unsigned wdx = idx / 32;
+	    unsigned sh = idx % 32;
+	    PLI_UINT32 aval = (PLI_UINT32)vec[wdx].aval >> sh;
+	    PLI_UINT32 bval = (PLI_UINT32)vec[wdx].bval >> sh;
+	      /* A digit may straddle two vecval words. */
+	    if (sh > 29 && (wdx+1)*32 < size) {
+		  aval |= (PLI_UINT32)vec[wdx+1].aval << (32-sh);
+		  bval |= (PLI_UINT32)vec[wdx+1].bval << (32-sh);
 	    }
-
-	    if (vs == 4) {
-		  slen -= 1;
-		  buf[slen] = oct_digits[val];
-		  val = 0;
+	    aval &= 7;
+	    bval &= 7;
+	    unsigned val = vpip_vecval_digit_index(aval, bval);
+
+	      /* Fill in X or Z if they are the only thing in the
+		 partial most significant digit. */
+	    if (idx+3 > size) {
+		  unsigned mask = (1U << (size-idx)) - 1;
+		  if (bval == mask && aval == mask) val = 42;
+		  else if (bval == mask && aval == 0) val = 63;
 	    }
-      }
-
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (bits.size() % 3) {
-	  case 1:
-	    if (val == 2) val = 42;
-	    else if (val == 3) val = 63;
-	    break;
-	  case 2:
-	    if (val == 10) val = 42;
-	    else if (val == 15) val = 63;
-	    break;
-      }
 
-      if (slen > 0) {
 	    slen -= 1;
 	    buf[slen] = oct_digits[val];
       }
@@ -28,10 +28,12 @@
 # include  "vvp_cobject.h"
 # include  "vvp_darray.h"
 # include  "class_type.h"
+# include  "statistics.h"
+# include  "profile.h"
+# include  "case_table.h"
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
-# include  <set>
 # include  <typeinfo>
 # include  <vector>
 # include  <cstdlib>
@@ -66,14 +68,20 @@ using namespace std;
  * Children that are detached with %join/detach need to have a different
  * parent/child relationship since the parent can still effect them if
  * it uses the %disable/fork or %wait/fork opcodes. The i_am_detached
- * flag and detached_children set are used for this relationship.
+ * flag and detached_children list are used for this relationship.
  *
  * Children placed into a task or function scope are given special
  * treatment, which is required to make task/function calls that they
- * represent work correctly. These task/function children are copied
- * into a task_func_children set to mark them for this handling. %join
- * operations will guarantee that task/function threads are joined first,
- * before any non-task/function threads.
+ * represent work correctly. These task/function children are marked
+ * with the i_am_task_func flag, and the parent counts them in its
+ * task_func_children. %join operations will guarantee that
+ * task/function threads are joined first, before any non-task/function
+ * threads.
+ *
+ * The children and detached_children lists are intrusive lists that
+ * are linked through the sib_link of each child, so a child is on at
+ * most one of them. The threads of a scope are likewise linked through
+ * the scope_link of each thread.
  *
  * It is a programming error for a thread that created threads to not
  * %join (or %join/detach) as many as it created before it %ends. The
@@ -94,6 +102,13 @@ using namespace std;
  * to reap the child immediately.
  */
 
+struct vthread_s;
+
+struct vthread_link_s {
+      struct vthread_s*next;
+      struct vthread_s*prev;
+};
+
 struct vthread_s {
       vthread_s();
 
@@ -111,38 +126,66 @@ struct vthread_s {
 	    uint64_t w_uint;
       } words[WORDS_COUNT];
 
+	/* The vec4 stack is an arena of vvp_vector4_t slots. The
+	   stack_vec4_ vector holds all the slots that this thread
+	   has ever used, and stack_vec4_size_ is the number that are
+	   actually on the stack. Popping a value leaves the slot
+	   (and any bit array it holds) in place so that the next
+	   push to that depth can reuse the storage instead of going
+	   to the heap. Note that this means a reference to a popped
+	   value remains valid until the next push. */
     private:
       vector<vvp_vector4_t>stack_vec4_;
+      size_t stack_vec4_size_;
     public:
       inline vvp_vector4_t pop_vec4(void)
       {
-	    assert(! stack_vec4_.empty());
-	    vvp_vector4_t val = stack_vec4_.back();
-	    stack_vec4_.pop_back();
-	    return val;
+	    assert(stack_vec4_size_ > 0);
+	    stack_vec4_size_ -= 1;
+	    return stack_vec4_[stack_vec4_size_];
+      }
+	// Pop the top of the stack into the dst. The dst gets the
+	// slot contents by exchange, so this does not copy bits.
+      inline void pop_vec4(vvp_vector4_t&dst)
+      {
+	    assert(stack_vec4_size_ > 0);
+	    stack_vec4_size_ -= 1;
+	    dst.swap(stack_vec4_[stack_vec4_size_]);
       }
       inline void push_vec4(const vvp_vector4_t&val)
       {
-	    stack_vec4_.push_back(val);
+	    if (stack_vec4_size_ < stack_vec4_.size())
+		  stack_vec4_[stack_vec4_size_] = val;
+	    else
+		  stack_vec4_.push_back(val);
+	    stack_vec4_size_ += 1;
+      }
+	// Push a slot onto the stack, and return a reference to it
+	// so that the caller can write the value in place. The
+	// contents of the slot are undefined.
+      inline vvp_vector4_t& push_vec4(void)
+      {
+	    if (stack_vec4_size_ == stack_vec4_.size())
+		  stack_vec4_.push_back(vvp_vector4_t());
+	    stack_vec4_size_ += 1;
+	    return stack_vec4_[stack_vec4_size_-1];
       }
-      inline const vvp_vector4_t& peek_vec4(unsigned depth)
+      inline vvp_vector4_t& peek_vec4(unsigned depth)
       {
-	    assert(depth < stack_vec4_.size());
-	    unsigned use_index = stack_vec4_.size()-1-depth;
+	    assert(depth < stack_vec4_size_);
+	    unsigned use_index = stack_vec4_size_-1-depth;
 	    return stack_vec4_[use_index];
       }
       inline vvp_vector4_t& peek_vec4(void)
       {
-	    assert(! stack_vec4_.empty());
-	    unsigned use_index = stack_vec4_.size()-1;
+	    assert(stack_vec4_size_ > 0);
+	    unsigned use_index = stack_vec4_size_-1;
 	    return stack_vec4_[use_index];
       }
       inline void pop_vec4(unsigned cnt)
       {
-	    while (cnt > 0) {
-		  stack_vec4_.pop_back();
-		  cnt -= 1;
-	    }
+	    assert(cnt <= stack_vec4_size_);
+	    stack_vec4_size_ -= cnt;
       }
 
 
@@ -181,30 +224,34 @@ struct vthread_s {
 	   (back()) only. */
     private:
       vector<string> stack_str_;
+      size_t stack_str_size_;
     public:
       inline string pop_str(void)
       {
-	    assert(! stack_str_.empty());
-	    string val = stack_str_.back();
-	    stack_str_.pop_back();
-	    return val;
+	    assert(stack_str_size_ > 0);
+	    stack_str_size_ -= 1;
+	    return stack_str_[stack_str_size_];
       }
       inline void push_str(const string&val)
       {
-	    stack_str_.push_back(val);
+	      // Like the vec4 stack, popped slots are kept so that
+	      // the assignment can reuse the string buffer.
+	    if (stack_str_size_ < stack_str_.size())
+		  stack_str_[stack_str_size_] = val;
+	    else
+		  stack_str_.push_back(val);
+	    stack_str_size_ += 1;
       }
       inline string&peek_str(unsigned depth)
       {
-	    assert(depth<stack_str_.size());
-	    unsigned use_index = stack_str_.size()-1-depth;
+	    assert(depth<stack_str_size_);
+	    unsigned use_index = stack_str_size_-1-depth;
 	    return stack_str_[use_index];
       }
       inline void pop_str(unsigned cnt)
       {
-	    while (cnt > 0) {
-		  stack_str_.pop_back();
-		  cnt -= 1;
-	    }
+	    assert(cnt <= stack_str_size_);
+	    stack_str_size_ -= cnt;
       }
 
 	/* Objects are also operated on in a stack. */
@@ -252,12 +299,17 @@ struct vthread_s {
       unsigned waiting_for_event :1;
       unsigned is_scheduled      :1;
       unsigned delay_delete      :1;
+      unsigned i_am_task_func    :1;
 	/* This points to the children of the thread. */
-      set<struct vthread_s*>children;
+      struct vthread_s*children;
 	/* This points to the detached children of the thread. */
-      set<struct vthread_s*>detached_children;
+      struct vthread_s*detached_children;
 	/* No more than 1 of the children are tasks or functions. */
-      set<vthread_s*>task_func_children;
+      unsigned task_func_children;
+	/* My place in the children list of my parent, and in the
+	   threads list of my scope. */
+      vthread_link_s sib_link;
+      vthread_link_s scope_link;
 	/* This points to my parent, if I have one. */
       struct vthread_s*parent;
 	/* This points to the containing scope. */
@@ -273,23 +325,93 @@ struct vthread_s {
       inline void cleanup()
       {
 	    if (i_was_disabled) {
-		  stack_vec4_.clear();
+		  stack_vec4_size_ = 0;
 		  stack_real_.clear();
-		  stack_str_.clear();
+		  stack_str_size_ = 0;
 		  pop_object(stack_obj_size_);
 	    }
-	    assert(stack_vec4_.empty());
+	    assert(stack_vec4_size_ == 0);
 	    assert(stack_real_.empty());
-	    assert(stack_str_.empty());
+	    assert(stack_str_size_ == 0);
 	    assert(stack_obj_size_ == 0);
       }
 };
 
 inline vthread_s::vthread_s()
 {
+      stack_vec4_size_ = 0;
+      stack_str_size_ = 0;
       stack_obj_size_ = 0;
 }
 
+/*
+ * These manage the intrusive thread lists. A list is circular, and
+ * the head pointer points to the first thread, so the last thread is
+ * head->prev. Threads are added at the end, so the list is in the
+ * order that the threads were added. A thread that is not on a list
+ * has nil links.
+ */
+static inline void thread_list_add(vthread_t&head, vthread_t thr,
+				   vthread_link_s vthread_s::*link)
+{
+      assert((thr->*link).next == 0);
+      if (head == 0) {
+	    (thr->*link).next = thr;
+	    (thr->*link).prev = thr;
+	    head = thr;
+      } else {
+	    vthread_t tail = (head->*link).prev;
+	    (thr->*link).next = head;
+	    (thr->*link).prev = tail;
+	    (tail->*link).next = thr;
+	    (head->*link).prev = thr;
+      }
+}
+
+static inline void thread_list_remove(vthread_t&head, vthread_t thr,
+				      vthread_link_s vthread_s::*link)
+{
+      assert((thr->*link).next);
+      if ((thr->*link).next == thr) {
+	    assert(head == thr);
+	    head = 0;
+      } else {
+	    vthread_t next = (thr->*link).next;
+	    vthread_t prev = (thr->*link).prev;
+	    (prev->*link).next = next;
+	    (next->*link).prev = prev;
+	    if (head == thr)
+		  head = next;
+      }
+      (thr->*link).next = 0;
+      (thr->*link).prev = 0;
+}
+
+static inline bool thread_list_test(vthread_t thr, vthread_link_s vthread_s::*link)
+{
+      return (thr->*link).next != 0;
+}
+
+static inline size_t thread_list_count(vthread_t head, vthread_link_s vthread_s::*link)
+{
+      size_t count = 0;
+      if (head) {
+	    vthread_t cur = head;
+	    do {
+		  count += 1;
+		  cur = (cur->*link).next;
+	    } while (cur != head);
+      }
+      return count;
+}
+
+/*
+ * Threads that are deleted are kept here to be used again by
+ * vthread_new, so that thread heavy designs do not go to the heap for
+ * every %fork. The kept threads are linked through their sib_link.
+ */
+static vthread_t thread_pool = 0;
+
 void vthread_s::debug_dump(ostream&fd, const char*label)
 {
       fd << "**** " << label << endl;
@@ -298,9 +420,9 @@ void vthread_s::debug_dump(ostream&fd, const char*label)
 	    fd << flags[idx];
       fd << endl;
       fd << "**** vec4 stack..." << endl;
-      for (size_t idx = stack_vec4_.size() ; idx > 0 ; idx -= 1)
-	    fd << "    " << (stack_vec4_.size()-idx) << ": " << stack_vec4_[idx-1] << endl;
-      fd << "**** str stack (" << stack_str_.size() << ")..." << endl;
+      for (size_t idx = stack_vec4_size_ ; idx > 0 ; idx -= 1)
+	    fd << "    " << (stack_vec4_size_-idx) << ": " << stack_vec4_[idx-1] << endl;
+      fd << "**** str stack (" << stack_str_size_ << ")..." << endl;
       fd << "**** obj stack (" << stack_obj_size_ << ")..." << endl;
       fd << "**** Done ****" << endl;
 }
@@ -398,25 +520,6 @@ template vvp_vector4_t coerce_to_width(const vvp_vector4_t&that,
                                        unsigned width);
 
 
-static void multiply_array_imm(unsigned long*res, unsigned long*val,
-			       unsigned words, unsigned long imm)
-{
-      for (unsigned idx = 0 ; idx < words ; idx += 1)
-	    res[idx] = 0;
-
-      for (unsigned mul_idx = 0 ; mul_idx < words ; mul_idx += 1) {
-	    unsigned long sum;
-	    unsigned long tmp = multiply_with_carry(val[mul_idx], imm, sum);
-
-	    unsigned long carry = 0;
-	    res[mul_idx] = add_with_carry(res[mul_idx], tmp, carry);
-	    for (unsigned add_idx = mul_idx+1 ; add_idx < words ; add_idx += 1) {
-		  res[add_idx] = add_with_carry(res[add_idx], sum, carry);
-		  sum = 0;
-	    }
-      }
-}
-
 /*
  * Allocate a context for use by a child thread. By preference, use
  * the last freed context. If none available, create a new one. Add
@@ -492,7 +595,14 @@ void contexts_delete(struct __vpiScope*scope)
  */
 vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
 {
-      vthread_t thr = new struct vthread_s;
+      vthread_t thr;
+      if (thread_pool) {
+	    thr = thread_pool;
+	    thread_pool = thr->sib_link.next;
+      } else {
+	    thr = new struct vthread_s;
+      }
+
       thr->pc     = pc;
 	//thr->bits4  = vvp_vector4_t(32);
       thr->parent = 0;
@@ -508,10 +618,19 @@ vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
       thr->i_have_ended  = 0;
       thr->i_was_disabled = 0;
       thr->delay_delete  = 0;
+      thr->i_am_task_func = 0;
       thr->waiting_for_event = 0;
       thr->event  = 0;
       thr->ecount = 0;
 
+      thr->children = 0;
+      thr->detached_children = 0;
+      thr->task_func_children = 0;
+      thr->sib_link.next = 0;
+      thr->sib_link.prev = 0;
+      thr->scope_link.next = 0;
+      thr->scope_link.prev = 0;
+
       thr->flags[0] = BIT4_0;
       thr->flags[1] = BIT4_1;
       thr->flags[2] = BIT4_X;
@@ -519,7 +638,7 @@ vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
       for (int idx = 4 ; idx < 8 ; idx += 1)
 	    thr->flags[idx] = BIT4_X;
 
-      scope->threads .insert(thr);
+      thread_list_add(scope->threads, thr, &vthread_s::scope_link);
       return thr;
 }
 
@@ -553,11 +672,11 @@ static void child_delete(vthread_t base)
 
 void vthreads_delete(struct __vpiScope*scope)
 {
-      for (std::set<vthread_t>::iterator cur = scope->threads.begin()
-		 ; cur != scope->threads.end() ; ++ cur ) {
-	    delete *cur;
+      while (scope->threads) {
+	    vthread_t cur = scope->threads;
+	    thread_list_remove(scope->threads, cur, &vthread_s::scope_link);
+	    delete cur;
       }
-      scope->threads.clear();
 }
 #endif
 
@@ -567,41 +686,43 @@ void vthreads_delete(struct __vpiScope*scope)
  */
 static void vthread_reap(vthread_t thr)
 {
-      if (! thr->children.empty()) {
-	    for (set<vthread_t>::iterator cur = thr->children.begin()
-		       ; cur != thr->children.end() ; ++cur) {
-		  vthread_t child = *cur;
-		  assert(child);
-		  assert(child->parent == thr);
-		  child->parent = thr->parent;
-	    }
+	/* The lists of my children go away with me. The children
+	   are handed to my parent, but they are on no list. */
+      while (thr->children) {
+	    vthread_t child = thr->children;
+	    assert(child->parent == thr);
+	    thread_list_remove(thr->children, child, &vthread_s::sib_link);
+	    child->parent = thr->parent;
       }
-      if (! thr->detached_children.empty()) {
-	    for (set<vthread_t>::iterator cur = thr->detached_children.begin()
-		       ; cur != thr->detached_children.end() ; ++cur) {
-		  vthread_t child = *cur;
-		  assert(child);
-		  assert(child->parent == thr);
-		  assert(child->i_am_detached);
-		  child->parent = 0;
-		  child->i_am_detached = 0;
-	    }
+      while (thr->detached_children) {
+	    vthread_t child = thr->detached_children;
+	    assert(child->parent == thr);
+	    assert(child->i_am_detached);
+	    thread_list_remove(thr->detached_children, child, &vthread_s::sib_link);
+	    child->parent = 0;
+	    child->i_am_detached = 0;
       }
       if (thr->parent) {
-	      /* assert that the given element was removed. */
-	    if (thr->i_am_detached) {
-		  size_t res = thr->parent->detached_children.erase(thr);
-		  assert(res == 1);
-	    } else {
-		  size_t res = thr->parent->children.erase(thr);
-		  assert(res == 1);
+	    if (thr->i_am_detached)
+		  thread_list_remove(thr->parent->detached_children, thr,
+				     &vthread_s::sib_link);
+	    else
+		  thread_list_remove(thr->parent->children, thr,
+				     &vthread_s::sib_link);
+
+	    if (thr->i_am_task_func) {
+		  assert(thr->parent->task_func_children > 0);
+		  thr->parent->task_func_children -= 1;
+		  thr->i_am_task_func = 0;
 	    }
       }
 
       thr->parent = 0;
 
 	// Remove myself from the containing scope if needed.
-      thr->parent_scope->threads.erase(thr);
+      if (thread_list_test(thr, &vthread_s::scope_link))
+	    thread_list_remove(thr->parent_scope->threads, thr,
+			       &vthread_s::scope_link);
 
       thr->pc = codespace_null();
 
@@ -609,7 +730,7 @@ static void vthread_reap(vthread_t thr)
 	   it now. Otherwise, let the schedule event (which will
 	   execute the thread at of_ZOMBIE) delete the object. */
       if ((thr->is_scheduled == 0) && (thr->waiting_for_event == 0)) {
-	    assert(thr->children.empty());
+	    assert(thr->children == 0);
 	    assert(thr->wait_next == 0);
 	    if (thr->delay_delete)
 		  schedule_del_thr(thr);
@@ -621,7 +742,12 @@ static void vthread_reap(vthread_t thr)
 void vthread_delete(vthread_t thr)
 {
       thr->cleanup();
+#ifdef CHECK_WITH_VALGRIND
       delete thr;
+#else
+      thr->sib_link.next = thread_pool;
+      thread_pool = thr;
+#endif
 }
 
 void vthread_mark_scheduled(vthread_t thr)
@@ -643,8 +769,13 @@ void vthread_delay_delete()
  * This function runs each thread by fetching an instruction,
  * incrementing the PC, and executing the instruction. The thread may
  * be the head of a list, so each thread is run so far as possible.
+ *
+ * The PROFILE variant also counts each opcode and the instructions
+ * run for each scope. It is a separate instance of the loop, picked
+ * once by vthread_enable_profile(), so that the normal loop does not
+ * test for profiling on every instruction.
  */
-void vthread_run(vthread_t thr)
+template <bool PROFILE> static void vthread_run_(vthread_t thr)
 {
       while (thr != 0) {
 	    vthread_t tmp = thr->wait_next;
@@ -655,9 +786,17 @@ void vthread_run(vthread_t thr)
 
             running_thread = thr;
 
+	      /* Get the scope now, because the thread may be deleted
+		 by the time it is done running. */
+	    struct __vpiScope*scope = thr->parent_scope;
+
+	    unsigned long steps = 0;
 	    for (;;) {
 		  vvp_code_t cp = thr->pc;
 		  thr->pc += 1;
+		  steps += 1;
+		  if (PROFILE)
+			profile_opcode(cp->opcode);
 
 		    /* Run the opcode implementation. If the execution of
 		       the opcode returns false, then the thread is meant to
@@ -666,12 +805,27 @@ void vthread_run(vthread_t thr)
 		  if (rc == false)
 			break;
 	    }
+	    count_opcodes_run += steps;
+	    if (PROFILE)
+		  profile_thread(scope, steps);
 
 	    thr = tmp;
       }
       running_thread = 0;
 }
 
+void (*vthread_run)(vthread_t thr) = &vthread_run_<false>;
+
+void vthread_enable_profile(void)
+{
+      vthread_run = &vthread_run_<true>;
+}
+
+bool vthread_in_thread(void)
+{
+      return running_thread != 0;
+}
+
 /*
  * The CHUNK_LINK instruction is a special next pointer for linking
  * chunks of code space. It's like a simplified %jmp.
@@ -746,10 +900,11 @@ bool of_ALLOC(vthread_t thr, vvp_code_t cp)
 
 bool of_AND(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valb = thr->pop_vec4();
-      vvp_vector4_t&vala = thr->peek_vec4();
+      const vvp_vector4_t&valb = thr->peek_vec4(0);
+      vvp_vector4_t&vala = thr->peek_vec4(1);
       assert(vala.size() == valb.size());
       vala &= valb;
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -815,13 +970,14 @@ static void get_immediate_rval(vvp_code_t cp, vvp_vector4_t&val)
  */
 bool of_ADD(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t r = thr->pop_vec4();
-	// Rather then pop l, use it directly from the stack. When we
-	// assign to 'l', that will edit the top of the stack, which
-	// replaces a pop and a pull.
-      vvp_vector4_t&l = thr->peek_vec4();
+	// Rather then pop the operands, use them directly from the
+	// stack. When we assign to 'l', that will edit what becomes
+	// the top of the stack, which replaces a pop and a pull.
+      const vvp_vector4_t&r = thr->peek_vec4(0);
+      vvp_vector4_t&l = thr->peek_vec4(1);
 
       l.add(r);
+      thr->pop_vec4(1);
 
       return true;
 }
@@ -1387,25 +1543,28 @@ bool of_CASSIGN_WR(vthread_t thr, vvp_code_t cp)
       return true;
 }
 
+/*
+ * %case/vec4 <default>, <val0>, <dest0>, <val1>, <dest1>, ...
+ * %casex/vec4 ...
+ * %casez/vec4 ...
+ *
+ * Pop the case expression and jump to the destination of the first
+ * item that matches it, or to the default. The table does the work.
+ */
+bool of_CASE_VEC4(vthread_t thr, vvp_code_t cp)
+{
+      thr->pc = cp->case_table->lookup(thr->peek_vec4());
+      thr->pop_vec4(1);
+      return true;
+}
+
 /*
  * %cast2
  */
 bool of_CAST2(vthread_t thr, vvp_code_t)
 {
       vvp_vector4_t&val = thr->peek_vec4();
-      unsigned wid = val.size();
-
-      for (unsigned idx = 0 ; idx < wid ; idx += 1) {
-	    switch (val.value(idx)) {
-		case BIT4_0:
-		case BIT4_1:
-		  break;
-		default:
-		  val.set_bit(idx, BIT4_0);
-		  break;
-	    }
-      }
-
+      val.cast2();
       return true;
 }
 
@@ -1788,8 +1947,8 @@ bool of_CMPIU(vthread_t thr, vvp_code_t cp)
 bool of_CMPX(vthread_t thr, vvp_code_t)
 {
       vvp_bit4_t eq = BIT4_1;
-      vvp_vector4_t rval = thr->pop_vec4();
-      vvp_vector4_t lval = thr->pop_vec4();
+      const vvp_vector4_t&rval = thr->peek_vec4(0);
+      const vvp_vector4_t&lval = thr->peek_vec4(1);
 
       assert(rval.size() == lval.size());
       unsigned wid = lval.size();
@@ -1803,6 +1962,7 @@ bool of_CMPX(vthread_t thr, vvp_code_t)
 	    }
       }
 
+      thr->pop_vec4(2);
       thr->flags[4] = eq;
       return true;
 }
@@ -1855,8 +2015,8 @@ bool of_CMPWU(vthread_t thr, vvp_code_t cp)
 bool of_CMPZ(vthread_t thr, vvp_code_t)
 {
       vvp_bit4_t eq = BIT4_1;
-      vvp_vector4_t rval = thr->pop_vec4();
-      vvp_vector4_t lval = thr->pop_vec4();
+      const vvp_vector4_t&rval = thr->peek_vec4(0);
+      const vvp_vector4_t&lval = thr->peek_vec4(1);
 
       assert(rval.size() == lval.size());
       unsigned wid = lval.size();
@@ -1870,6 +2030,7 @@ bool of_CMPZ(vthread_t thr, vvp_code_t)
 	    }
       }
 
+      thr->pop_vec4(2);
       thr->flags[4] = eq;
       return true;
 }
@@ -1913,7 +2074,7 @@ bool of_CONCAT_VEC4(vthread_t thr, vvp_code_t)
 	// result. Do that by actually popping only 1 stack position
 	// and replacing the new top with the new value.
       thr->pop_vec4(1);
-      thr->peek_vec4() = res;
+      thr->peek_vec4().swap(res);
 
       return true;
 }
@@ -1973,7 +2134,7 @@ bool of_CONCATI_VEC4(vthread_t thr, vvp_code_t cp)
       res.set_vec(0, lsb);
       res.set_vec(lsb.size(), msb);
 
-      msb = res;
+      msb.swap(res);
       return true;
 }
 
@@ -2067,7 +2228,7 @@ bool of_DEASSIGN(vthread_t, vvp_code_t cp)
 
       vvp_signal_value*fil = dynamic_cast<vvp_signal_value*> (net->fil);
       assert(fil);
-      vvp_fun_signal_vec*sig = dynamic_cast<vvp_fun_signal_vec*>(net->fun);
+      vvp_fun_signal_base*sig = dynamic_cast<vvp_fun_signal_base*>(net->fun);
       assert(sig);
 
       if (base >= fil->value_size()) return true;
@@ -2176,7 +2337,9 @@ static bool do_disable(vthread_t thr, vthread_t match)
       bool flag = false;
 
 	/* Pull the target thread out of its scope if needed. */
-      thr->parent_scope->threads.erase(thr);
+      if (thread_list_test(thr, &vthread_s::scope_link))
+	    thread_list_remove(thr->parent_scope->threads, thr,
+			       &vthread_s::scope_link);
 
 	/* Turn the thread off by setting is program counter to
 	   zero and setting an OFF bit. */
@@ -2187,10 +2350,9 @@ static bool do_disable(vthread_t thr, vthread_t match)
 	/* Turn off all the children of the thread. Simulate a %join
 	   for as many times as needed to clear the results of all the
 	   %forks that this thread has done. */
-      while (! thr->children.empty()) {
+      while (thr->children) {
 
-	    vthread_t tmp = *(thr->children.begin());
-	    assert(tmp);
+	    vthread_t tmp = thr->children;
 	    assert(tmp->parent == thr);
 	    thr->i_am_joining = 0;
 	    if (do_disable(tmp, match))
@@ -2237,10 +2399,8 @@ bool of_DISABLE(vthread_t thr, vvp_code_t cp)
 
       bool disabled_myself_flag = false;
 
-      while (! scope->threads.empty()) {
-	    set<vthread_t>::iterator cur = scope->threads.begin();
-
-	    if (do_disable(*cur, thr))
+      while (scope->threads) {
+	    if (do_disable(scope->threads, thr))
 		  disabled_myself_flag = true;
       }
 
@@ -2258,12 +2418,11 @@ bool of_DISABLE_FORK(vthread_t thr, vvp_code_t)
       assert(! thr->i_am_joining);
 
 	/* There should be no active children to disable. */
-      assert(thr->children.empty());
+      assert(thr->children == 0);
 
 	/* Disable any detached children. */
-      while (! thr->detached_children.empty()) {
-	    vthread_t child = *(thr->detached_children.begin());
-	    assert(child);
+      while (thr->detached_children) {
+	    vthread_t child = thr->detached_children;
 	    assert(child->parent == thr);
 	      /* Disabling the children can never match the parent thread. */
 	    bool res = do_disable(child, thr);
@@ -2275,130 +2434,22 @@ bool of_DISABLE_FORK(vthread_t thr, vvp_code_t)
 }
 
 /*
- * This function divides a 2-word number {high, a} by a 1-word
- * number. Assume that high < b.
+ * Divide the wid bits of ap by bp, and return the quotient in a new
+ * array. The remainder is left in ap. Return nil for divide by zero.
  */
-static unsigned long divide2words(unsigned long a, unsigned long b,
-				  unsigned long high)
-{
-      unsigned long result = 0;
-      while (high > 0) {
-	    unsigned long tmp_result = ULONG_MAX / b;
-	    unsigned long remain = ULONG_MAX % b;
-
-	    remain += 1;
-	    if (remain >= b) {
-		  remain -= b;
-		  tmp_result += 1;
-	    }
-
-	      // Now 0x1_0...0 = b*tmp_result + remain
-	      // high*0x1_0...0 = high*(b*tmp_result + remain)
-	      // high*0x1_0...0 = high*b*tmp_result + high*remain
-
-	      // We know that high*0x1_0...0 >= high*b*tmp_result, and
-	      // we know that high*0x1_0...0 > high*remain. Use
-	      // high*remain as the remainder for another iteration,
-	      // and add tmp_result*high into the current estimate of
-	      // the result.
-	    result += tmp_result * high;
-
-	      // The new iteration starts with high*remain + a.
-	    remain = multiply_with_carry(high, remain, high);
-	    a += remain;
-            if(a < remain)
-              high += 1;
-
-	      // Now result*b + {high,a} == the input {high,a}. It is
-	      // possible that the new high >= 1. If so, it will
-	      // certainly be less than high from the previous
-	      // iteration. Do another iteration and it will shrink,
-	      // eventually to 0.
-      }
-
-	// high is now 0, so a is the remaining remainder, so we can
-	// finish off the integer divide with a simple a/b.
-
-      return result + a/b;
-}
-
 static unsigned long* divide_bits(unsigned long*ap, unsigned long*bp, unsigned wid)
 {
-	// Do all our work a cpu-word at a time. The "words" variable
-	// is the number of words of the wid.
       unsigned words = (wid+CPU_WORD_BITS-1) / CPU_WORD_BITS;
 
-      unsigned btop = words-1;
-      while (btop > 0 && bp[btop] == 0)
-	    btop -= 1;
-
-	// Detect divide by 0, and exit.
-      if (btop==0 && bp[0]==0)
+      unsigned long*result = new unsigned long[words];
+      if (! divide_words(result, ap, ap, bp, words)) {
+	    delete[]result;
 	    return 0;
-
-	// The result array will eventually accumulate the result. The
-	// diff array is a difference that we use in the intermediate.
-      unsigned long*diff  = new unsigned long[words];
-      unsigned long*result= new unsigned long[words];
-      for (unsigned idx = 0 ; idx < words ; idx += 1)
-	    result[idx] = 0;
-
-      for (unsigned cur = words-btop ; cur > 0 ; cur -= 1) {
-	    unsigned cur_ptr = cur-1;
-	    unsigned long cur_res;
-	    if (ap[cur_ptr+btop] >= bp[btop]) {
-		  unsigned long high = 0;
-		  if (cur_ptr+btop+1 < words)
-			high = ap[cur_ptr+btop+1];
-		  cur_res = divide2words(ap[cur_ptr+btop], bp[btop], high);
-
-	    } else if (cur_ptr+btop+1 >= words) {
-		  continue;
-
-	    } else if (ap[cur_ptr+btop+1] == 0) {
-		  continue;
-
-	    } else {
-		  cur_res = divide2words(ap[cur_ptr+btop], bp[btop],
-					 ap[cur_ptr+btop+1]);
-	    }
-
-	      // cur_res is a guesstimate of the result this far. It
-	      // may be 1 too big. (But it will also be >0) Try it,
-	      // and if the difference comes out negative, then adjust.
-
-	      // diff = (bp * cur_res)  << cur_ptr;
-	    multiply_array_imm(diff+cur_ptr, bp, words-cur_ptr, cur_res);
-	      // ap -= diff
-	    unsigned long carry = 1;
-	    for (unsigned idx = cur_ptr ; idx < words ; idx += 1)
-		  ap[idx] = add_with_carry(ap[idx], ~diff[idx], carry);
-
-	      // ap has the diff subtracted out of it. If cur_res was
-	      // too large, then ap will turn negative. (We easily
-	      // tell that ap turned negative by looking at
-	      // carry&1. If it is 0, then it is *negative*.) In that
-	      // case, we know that cur_res was too large by 1. Correct by
-	      // adding 1b back in and reducing cur_res.
-	    if ((carry&1) == 0) {
-		    // Keep adding b back in until the remainder
-		    // becomes positive again.
-		  do {
-			cur_res -= 1;
-			carry = 0;
-			for (unsigned idx = cur_ptr ; idx < words ; idx += 1)
-			      ap[idx] = add_with_carry(ap[idx], bp[idx-cur_ptr], carry);
-		  } while (carry == 0);
-	    }
-
-	    result[cur_ptr] = cur_res;
       }
 
 	// Now ap contains the remainder and result contains the
 	// desired result. We should find that:
 	//  input-a = bp * result + ap;
-
-      delete[]diff;
       return result;
 }
 
@@ -2597,19 +2648,18 @@ bool of_END(vthread_t thr, vvp_code_t)
       thr->pc = codespace_null();
 
 	/* Fully detach any detached children. */
-      while (! thr->detached_children.empty()) {
-	    vthread_t child = *(thr->detached_children.begin());
-	    assert(child);
+      while (thr->detached_children) {
+	    vthread_t child = thr->detached_children;
 	    assert(child->parent == thr);
 	    assert(child->i_am_detached);
 	    child->parent = 0;
 	    child->i_am_detached = 0;
-	    thr->detached_children.erase(thr->detached_children.begin());
+	    thread_list_remove(thr->detached_children, child, &vthread_s::sib_link);
       }
 
 	/* It is an error to still have active children running at this
 	 * point in time. They should have all been detached or joined. */
-      assert(thr->children.empty());
+      assert(thr->children == 0);
 
 	/* If I have a parent who is waiting for me, then mark that I
 	   have ended, and schedule that parent. Also, finish the
@@ -2636,12 +2686,11 @@ bool of_END(vthread_t thr, vvp_code_t)
       if (thr->i_am_detached) {
 	    vthread_t tmp = thr->parent;
 	    assert(tmp);
-	    size_t res = tmp->detached_children.erase(thr);
-	    assert(res == 1);
+	    thread_list_remove(tmp->detached_children, thr, &vthread_s::sib_link);
 	      /* If the parent is waiting for the detached children to
 	       * finish then the last detached child needs to tell the
 	       * parent to wake up when it is finished. */
-	    if (tmp->i_am_waiting && tmp->detached_children.empty()) {
+	    if (tmp->i_am_waiting && tmp->detached_children == 0) {
 		  tmp->i_am_waiting = 0;
 		  schedule_vthread(tmp, 0, true);
 	    }
@@ -2893,19 +2942,21 @@ bool of_FORK(vthread_t thr, vvp_code_t cp)
       }
 
       child->parent = thr;
-      thr->children.insert(child);
+      thread_list_add(thr->children, child, &vthread_s::sib_link);
 
 	/* If the child scope is not the same as the current scope,
 	   infer that this is a task or function call. */
       switch (cp->scope->get_type_code()) {
 	  case vpiFunction:
-	    thr->task_func_children.insert(child);
+	    child->i_am_task_func = 1;
+	    thr->task_func_children += 1;
 	    child->is_scheduled = 1;
 	    vthread_run(child);
 	    running_thread = thr;
 	    break;
 	  case vpiTask:
-	    thr->task_func_children.insert(child);
+	    child->i_am_task_func = 1;
+	    thr->task_func_children += 1;
 	    schedule_vthread(child, 0, true);
 	    break;
 	  default:
@@ -3218,6 +3269,222 @@ bool of_JMP1XZ(vthread_t thr, vvp_code_t cp)
       return true;
 }
 
+/*
+ * Superinstructions
+ *
+ * These handlers implement common sequences of instructions in a
+ * single dispatch. The codespace_fuse() pass installs them after the
+ * code is linked by replacing the opcode of the first instruction of
+ * the sequence. The rest of the sequence is left in place, so the
+ * fused handler reads its operands from there, and branches into the
+ * middle of the sequence still execute the original instructions.
+ *
+ * The fused compare/branch is %cmp{i}/{e,ne,s,u} followed by any of
+ * the conditional %jmp/{0,1,0xz,1xz} instructions. The fused
+ * load/compare/branch adds a leading %load/vec4, and compares the
+ * signal value directly so that it never touches the vec4 stack.
+ */
+enum fused_cmp_e { FC_E, FC_NE, FC_S, FC_U, FC_IE, FC_INE, FC_IS, FC_IU,
+		   FC_COUNT };
+enum fused_jmp_e { FJ_0, FJ_1, FJ_0XZ, FJ_1XZ, FJ_COUNT };
+
+static int fused_cmp_kind(vvp_code_fun op)
+{
+      if (op == &of_CMPE)   return FC_E;
+      if (op == &of_CMPNE)  return FC_NE;
+      if (op == &of_CMPS)   return FC_S;
+      if (op == &of_CMPU)   return FC_U;
+      if (op == &of_CMPIE)  return FC_IE;
+      if (op == &of_CMPINE) return FC_INE;
+      if (op == &of_CMPIS)  return FC_IS;
+      if (op == &of_CMPIU)  return FC_IU;
+      return -1;
+}
+
+static int fused_jmp_kind(vvp_code_fun op)
+{
+      if (op == &of_JMP0)   return FJ_0;
+      if (op == &of_JMP1)   return FJ_1;
+      if (op == &of_JMP0XZ) return FJ_0XZ;
+      if (op == &of_JMP1XZ) return FJ_1XZ;
+      return -1;
+}
+
+/*
+ * Execute the conditional jump at jp as if it were the next
+ * instruction to be executed.
+ */
+template <int JMP> static inline bool fused_jmp(vthread_t thr, vvp_code_t jp)
+{
+      vvp_bit4_t val = thr->flags[jp->bit_idx[0]];
+      bool take_flag = false;
+      switch (JMP) {
+	  case FJ_0:
+	    take_flag = val == BIT4_0;
+	    break;
+	  case FJ_1:
+	    take_flag = val == BIT4_1;
+	    break;
+	  case FJ_0XZ:
+	    take_flag = val != BIT4_1;
+	    break;
+	  case FJ_1XZ:
+	    take_flag = val != BIT4_0;
+	    break;
+      }
+
+      thr->pc = take_flag? jp->cptr : jp+1;
+
+	/* Check for a $stop just like the plain %jmp instructions. */
+      if (schedule_stopped()) {
+	    schedule_vthread(thr, 0, false);
+	    return false;
+      }
+
+      return true;
+}
+
+template <int CMP, int JMP> static bool of_CMP_JMP(vthread_t thr, vvp_code_t cp)
+{
+      switch (CMP) {
+	  case FC_E:
+	    of_CMPE(thr, cp);
+	    break;
+	  case FC_NE:
+	    of_CMPNE(thr, cp);
+	    break;
+	  case FC_S:
+	    of_CMPS(thr, cp);
+	    break;
+	  case FC_U:
+	    of_CMPU(thr, cp);
+	    break;
+	  case FC_IE:
+	    of_CMPIE(thr, cp);
+	    break;
+	  case FC_INE:
+	    of_CMPINE(thr, cp);
+	    break;
+	  case FC_IS:
+	    of_CMPIS(thr, cp);
+	    break;
+	  case FC_IU:
+	    of_CMPIU(thr, cp);
+	    break;
+      }
+
+      return fused_jmp<JMP>(thr, cp+1);
+}
+
+template <int CMP, int JMP> static bool of_LOAD_CMPI_JMP(vthread_t thr, vvp_code_t cp)
+{
+      vvp_signal_value*sig = dynamic_cast<vvp_signal_value*> (cp->net->fil);
+      assert(sig);
+
+      vvp_vector4_t lval;
+      sig->vec4_value(lval);
+
+      vvp_code_t ccp = cp+1;
+      vvp_vector4_t rval (ccp->number, BIT4_0);
+      get_immediate_rval (ccp, rval);
+
+      switch (CMP) {
+	  case FC_IE:
+	    do_CMPE(thr, lval, rval);
+	    break;
+	  case FC_INE:
+	    do_CMPE(thr, lval, rval);
+	    thr->flags[4] =  ~thr->flags[4];
+	    thr->flags[6] =  ~thr->flags[6];
+	    break;
+	  case FC_IS:
+	    do_CMPS(thr, lval, rval);
+	    break;
+	  case FC_IU:
+	    do_CMPU(thr, lval, rval);
+	    break;
+      }
+
+      return fused_jmp<JMP>(thr, cp+2);
+}
+
+#define FUSED_JMP_ROW(fun, cmp) \
+      { &fun<cmp,FJ_0>, &fun<cmp,FJ_1>, &fun<cmp,FJ_0XZ>, &fun<cmp,FJ_1XZ> }
+
+static const vvp_code_fun fused_cmp_jmp_tab[FC_COUNT][FJ_COUNT] = {
+      FUSED_JMP_ROW(of_CMP_JMP, FC_E),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_NE),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_S),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_U),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_IE),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_INE),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_IS),
+      FUSED_JMP_ROW(of_CMP_JMP, FC_IU)
+};
+
+static const vvp_code_fun fused_load_cmpi_jmp_tab[FC_COUNT][FJ_COUNT] = {
+      { 0, 0, 0, 0 },
+      { 0, 0, 0, 0 },
+      { 0, 0, 0, 0 },
+      { 0, 0, 0, 0 },
+      FUSED_JMP_ROW(of_LOAD_CMPI_JMP, FC_IE),
+      FUSED_JMP_ROW(of_LOAD_CMPI_JMP, FC_INE),
+      FUSED_JMP_ROW(of_LOAD_CMPI_JMP, FC_IS),
+      FUSED_JMP_ROW(of_LOAD_CMPI_JMP, FC_IU)
+};
+
+#undef FUSED_JMP_ROW
+
+bool vthread_fuse_code(vvp_code_t cp, unsigned avail)
+{
+      if (avail >= 3 && cp[0].opcode == &of_LOAD_VEC4) {
+	    int cmp = fused_cmp_kind(cp[1].opcode);
+	    int jmp = cmp >= 0? fused_jmp_kind(cp[2].opcode) : -1;
+	    if (jmp >= 0 && fused_load_cmpi_jmp_tab[cmp][jmp]) {
+		  cp[0].opcode = fused_load_cmpi_jmp_tab[cmp][jmp];
+		  return true;
+	    }
+      }
+
+      if (avail >= 2) {
+	    int cmp = fused_cmp_kind(cp[0].opcode);
+	    int jmp = cmp >= 0? fused_jmp_kind(cp[1].opcode) : -1;
+	    if (jmp >= 0) {
+		  cp[0].opcode = fused_cmp_jmp_tab[cmp][jmp];
+		  return true;
+	    }
+      }
+
+      return false;
+}
+
+const char* vthread_fused_name(vvp_code_fun op)
+{
+      static const char*cmp_names[FC_COUNT] = {
+	    "%cmp/e", "%cmp/ne", "%cmp/s", "%cmp/u",
+	    "%cmpi/e", "%cmpi/ne", "%cmpi/s", "%cmpi/u" };
+      static const char*jmp_names[FJ_COUNT] = {
+	    "%jmp/0", "%jmp/1", "%jmp/0xz", "%jmp/1xz" };
+      static char name[64];
+
+      for (int cmp = 0 ; cmp < FC_COUNT ; cmp += 1) {
+	    for (int jmp = 0 ; jmp < FJ_COUNT ; jmp += 1) {
+		  if (fused_cmp_jmp_tab[cmp][jmp] == op) {
+			snprintf(name, sizeof name, "%s+%s",
+				 cmp_names[cmp], jmp_names[jmp]);
+			return name;
+		  }
+		  if (fused_load_cmpi_jmp_tab[cmp][jmp] == op) {
+			snprintf(name, sizeof name, "%%load/vec4+%s+%s",
+				 cmp_names[cmp], jmp_names[jmp]);
+			return name;
+		  }
+	    }
+      }
+
+      return 0;
+}
+
 /*
  * The %join instruction causes the thread to wait for one child
  * to die.  If a child is already dead (and a zombie) then I reap
@@ -3227,8 +3494,7 @@ bool of_JMP1XZ(vthread_t thr, vvp_code_t cp)
 
 static bool test_joinable(vthread_t thr, vthread_t child)
 {
-      set<vthread_t>::iterator cur = thr->task_func_children.find(child);
-      if (! thr->task_func_children.empty() && cur == thr->task_func_children.end())
+      if (thr->task_func_children > 0 && ! child->i_am_task_func)
 	    return false;
 
       return true;
@@ -3238,8 +3504,12 @@ static void do_join(vthread_t thr, vthread_t child)
 {
       assert(child->parent == thr);
 
-	/* Remove the thread from the task/function set if needed. */
-      thr->task_func_children.erase(child);
+	/* Remove the thread from the task/function count if needed. */
+      if (child->i_am_task_func) {
+	    assert(thr->task_func_children > 0);
+	    thr->task_func_children -= 1;
+	    child->i_am_task_func = 0;
+      }
 
         /* If the immediate child thread is in an automatic scope... */
       if (child->wt_context) {
@@ -3261,23 +3531,19 @@ static void do_join(vthread_t thr, vthread_t child)
 bool of_JOIN(vthread_t thr, vvp_code_t)
 {
       assert( !thr->i_am_joining );
-      assert( !thr->children.empty());
+      assert(thr->children);
 
 	// Are there any children that have already ended? If so, then
 	// join with that one.
-      for (set<vthread_t>::iterator cur = thr->children.begin()
-		 ; cur != thr->children.end() ; ++cur) {
-	    vthread_t curp = *cur;
-	    if (! curp->i_have_ended)
-		  continue;
-
-	    if (! test_joinable(thr, curp))
-		  continue;
-
-	      // found something!
-	    do_join(thr, curp);
-	    return true;
-      }
+      vthread_t curp = thr->children;
+      do {
+	    if (curp->i_have_ended && test_joinable(thr, curp)) {
+		    // found something!
+		  do_join(thr, curp);
+		  return true;
+	    }
+	    curp = curp->sib_link.next;
+      } while (curp != thr->children);
 
 	// Otherwise, tell my children to awaken me when they end,
 	// then pause.
@@ -3293,11 +3559,11 @@ bool of_JOIN_DETACH(vthread_t thr, vvp_code_t cp)
 {
       unsigned long count = cp->number;
 
-      assert(thr->task_func_children.empty());
-      assert(count == thr->children.size());
+      assert(thr->task_func_children == 0);
+      assert(count == thread_list_count(thr->children, &vthread_s::sib_link));
 
-      while (! thr->children.empty()) {
-	    vthread_t child = *thr->children.begin();
+      while (thr->children) {
+	    vthread_t child = thr->children;
 	    assert(child->parent == thr);
 
 	      // We cannot detach automatic tasks/functions within an
@@ -3310,10 +3576,9 @@ bool of_JOIN_DETACH(vthread_t thr, vvp_code_t cp)
 		  vthread_reap(child);
 
 	    } else {
-		  size_t res = child->parent->children.erase(child);
-		  assert(res == 1);
+		  thread_list_remove(thr->children, child, &vthread_s::sib_link);
 		  child->i_am_detached = 1;
-		  thr->detached_children.insert(child);
+		  thread_list_add(thr->detached_children, child, &vthread_s::sib_link);
 	    }
       }
 
@@ -3493,11 +3758,11 @@ bool of_LOAD_STRA(vthread_t thr, vvp_code_t cp)
  */
 bool of_LOAD_VEC4(vthread_t thr, vvp_code_t cp)
 {
-	// Push a placeholder onto the stack in order to reserve the
-	// stack space. Use a reference for the stack top as a target
-	// for the load.
-      thr->push_vec4(vvp_vector4_t());
-      vvp_vector4_t&sig_value = thr->peek_vec4();
+	// Push a slot onto the stack in order to reserve the stack
+	// space. Use a reference for the stack top as a target for
+	// the load. The slot may still hold the array for an earlier
+	// value, which the load will reuse if it can.
+      vvp_vector4_t&sig_value = thr->push_vec4();
 
       vvp_net_t*net = cp->net;
 
@@ -3540,120 +3805,50 @@ bool of_LOAD_VEC4A(vthread_t thr, vvp_code_t cp)
       return true;
 }
 
+/*
+ * This is the modulus for values that do not fit in a long long. The
+ * operands are made positive if they are negative, and the result
+ * takes the sign of the left operand.
+ */
 static void do_verylong_mod(vvp_vector4_t&vala, const vvp_vector4_t&valb,
 			    bool left_is_neg, bool right_is_neg)
 {
-      bool out_is_neg = left_is_neg;
-      const int len=vala.size();
-      unsigned char *a, *z, *t;
-      a = new unsigned char[len+1];
-      z = new unsigned char[len+1];
-      t = new unsigned char[len+1];
-
-      unsigned char carry;
-      unsigned char temp;
-
-      int mxa = -1, mxz = -1;
-      int i;
-      int current, copylen;
-
-      unsigned lb_carry = left_is_neg? 1 : 0;
-      unsigned rb_carry = right_is_neg? 1 : 0;
-      for (int idx = 0 ;  idx < len ;  idx += 1) {
-	    unsigned lb = vala.value(idx);
-	    unsigned rb = valb.value(idx);
-
-	    if ((lb | rb) & 2) {
-		  delete []t;
-		  delete []z;
-		  delete []a;
-		  vvp_vector4_t tmp(len, BIT4_X);
-		  vala = tmp;
-		  return;
-	    }
+      const unsigned wid = vala.size();
+      const unsigned words = (wid + CPU_WORD_BITS - 1) / CPU_WORD_BITS;
+      const unsigned long mask = -1UL >> (words*CPU_WORD_BITS - wid);
 
-	    if (left_is_neg) {
-		  lb = (1-lb) + lb_carry;
-		  lb_carry = (lb & ~1)? 1 : 0;
-		  lb &= 1;
-	    }
-	    if (right_is_neg) {
-		  rb = (1-rb) + rb_carry;
-		  rb_carry = (rb & ~1)? 1 : 0;
-		  rb &= 1;
-	    }
-
-	    z[idx]=lb;
-	    a[idx]=1-rb;	// for 2s complement add..
+      unsigned long*ap = vala.subarray(0, wid);
+      unsigned long*bp = ap? valb.subarray(0, wid) : 0;
+      if (bp == 0) {
+	    delete[]ap;
+	    vala = vvp_vector4_t(wid, BIT4_X);
+	    return;
       }
 
-      z[len]=0;
-      a[len]=1;
-
-      for(i=len-1;i>=0;i--) {
-	    if(! a[i]) {
-		  mxa=i;
-		  break;
-	    }
+      if (left_is_neg) {
+	    negate_words(ap, words);
+	    ap[words-1] &= mask;
       }
-
-      for(i=len-1;i>=0;i--) {
-	    if(z[i]) {
-		  mxz=i;
-		  break;
-	    }
+      if (right_is_neg) {
+	    negate_words(bp, words);
+	    bp[words-1] &= mask;
       }
 
-      if((mxa>mxz)||(mxa==-1)) {
-	    if(mxa==-1) {
-		  delete []t;
-		  delete []z;
-		  delete []a;
-		  vvp_vector4_t tmpx (len, BIT4_X);
-		  vala = tmpx;
-		  return;
-	    }
-
-	    goto tally;
+      if (! divide_words(0, ap, ap, bp, words)) {
+	    delete[]ap;
+	    delete[]bp;
+	    vala = vvp_vector4_t(wid, BIT4_X);
+	    return;
       }
 
-      copylen = mxa + 2;
-      current = mxz - mxa;
-
-      while(current > -1) {
-	    carry = 1;
-	    for(i=0;i<copylen;i++) {
-		  temp = z[i+current] + a[i] + carry;
-		  t[i] = (temp&1);
-		  carry = (temp>>1);
-	    }
-
-	    if(carry) {
-		  for(i=0;i<copylen;i++) {
-			z[i+current] = t[i];
-		  }
-	    }
-
-	    current--;
+      if (left_is_neg) {
+	    negate_words(ap, words);
+	    ap[words-1] &= mask;
       }
 
- tally:
-
-      vvp_vector4_t tmp (len, BIT4_X);
-      carry = out_is_neg? 1 : 0;
-      for (int idx = 0 ;  idx < len ;  idx += 1) {
-	    unsigned ob = z[idx];
-	    if (out_is_neg) {
-		  ob = (1-ob) + carry;
-		  carry = (ob & ~1)? 1 : 0;
-		  ob = ob & 1;
-	    }
-	    tmp.set_bit(idx, ob?BIT4_1:BIT4_0);
-      }
-      vala = tmp;
-      delete []t;
-      delete []z;
-      delete []a;
+      vala.setarray(0, wid, ap);
+      delete[]ap;
+      delete[]bp;
 }
 
 bool of_MAX_WR(vthread_t thr, vvp_code_t)
@@ -3974,13 +4169,14 @@ bool of_MOV_WU(vthread_t thr, vvp_code_t cp)
  */
 bool of_MUL(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t r = thr->pop_vec4();
-	// Rather then pop l, use it directly from the stack. When we
-	// assign to 'l', that will edit the top of the stack, which
-	// replaces a pop and a pull.
-      vvp_vector4_t&l = thr->peek_vec4();
+	// Rather then pop the operands, use them directly from the
+	// stack. When we assign to 'l', that will edit what becomes
+	// the top of the stack, which replaces a pop and a pull.
+      const vvp_vector4_t&r = thr->peek_vec4(0);
+      vvp_vector4_t&l = thr->peek_vec4(1);
 
       l.mul(r);
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -4017,8 +4213,8 @@ bool of_MUL_WR(vthread_t thr, vvp_code_t)
 
 bool of_NAND(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valr = thr->pop_vec4();
-      vvp_vector4_t&vall = thr->peek_vec4();
+      const vvp_vector4_t&valr = thr->peek_vec4(0);
+      vvp_vector4_t&vall = thr->peek_vec4(1);
       assert(vall.size() == valr.size());
       unsigned wid = vall.size();
 
@@ -4028,6 +4224,7 @@ bool of_NAND(vthread_t thr, vvp_code_t)
 	    vall.set_bit(idx, ~(lb&rb));
       }
 
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -4042,7 +4239,7 @@ bool of_NEW_COBJ(vthread_t thr, vvp_code_t cp)
       const class_type*defn = dynamic_cast<const class_type*> (cp->handle);
       assert(defn);
 
-      vvp_object_t tmp (new vvp_cobject(defn));
+      vvp_object_t tmp (new (defn) vvp_cobject(defn));
       thr->push_object(tmp);
       return true;
 }
@@ -4094,7 +4291,7 @@ bool of_NOOP(vthread_t, vvp_code_t)
  */
 bool of_NORR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_1;
 
@@ -4110,8 +4307,7 @@ bool of_NORR(vthread_t thr, vvp_code_t)
 		  lb = BIT4_X;
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
 
       return true;
 }
@@ -4131,7 +4327,7 @@ bool of_NULL(vthread_t thr, vvp_code_t)
  */
 bool of_ANDR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_1;
 
@@ -4146,8 +4342,7 @@ bool of_ANDR(vthread_t thr, vvp_code_t)
 		  lb = BIT4_X;
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
 
       return true;
 }
@@ -4157,7 +4352,7 @@ bool of_ANDR(vthread_t thr, vvp_code_t)
  */
 bool of_NANDR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_0;
       for (unsigned idx = 0 ; idx < val.size() ; idx += 1) {
@@ -4172,8 +4367,7 @@ bool of_NANDR(vthread_t thr, vvp_code_t)
 		  lb = BIT4_X;
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
 
       return true;
 }
@@ -4183,7 +4377,7 @@ bool of_NANDR(vthread_t thr, vvp_code_t)
  */
 bool of_ORR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_0;
       for (unsigned idx = 0 ; idx < val.size() ; idx += 1) {
@@ -4197,8 +4391,7 @@ bool of_ORR(vthread_t thr, vvp_code_t)
 		  lb = BIT4_X;
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
       return true;
 }
 
@@ -4207,7 +4400,7 @@ bool of_ORR(vthread_t thr, vvp_code_t)
  */
 bool of_XORR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_0;
       for (unsigned idx = 0 ; idx < val.size() ; idx += 1) {
@@ -4221,8 +4414,7 @@ bool of_XORR(vthread_t thr, vvp_code_t)
 	    }
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
       return true;
 }
 
@@ -4231,7 +4423,7 @@ bool of_XORR(vthread_t thr, vvp_code_t)
  */
 bool of_XNORR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t val = thr->pop_vec4();
+      const vvp_vector4_t&val = thr->peek_vec4();
 
       vvp_bit4_t lb = BIT4_1;
       for (unsigned idx = 0 ; idx < val.size() ; idx += 1) {
@@ -4245,8 +4437,7 @@ bool of_XNORR(vthread_t thr, vvp_code_t)
 	    }
       }
 
-      vvp_vector4_t res (1, lb);
-      thr->push_vec4(res);
+      thr->peek_vec4() = vvp_vector4_t(1, lb);
       return true;
 }
 
@@ -4255,9 +4446,10 @@ bool of_XNORR(vthread_t thr, vvp_code_t)
  */
 bool of_OR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valb = thr->pop_vec4();
-      vvp_vector4_t&vala = thr->peek_vec4();
+      const vvp_vector4_t&valb = thr->peek_vec4(0);
+      vvp_vector4_t&vala = thr->peek_vec4(1);
       vala |= valb;
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -4266,8 +4458,8 @@ bool of_OR(vthread_t thr, vvp_code_t)
  */
 bool of_NOR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valr = thr->pop_vec4();
-      vvp_vector4_t&vall = thr->peek_vec4();
+      const vvp_vector4_t&valr = thr->peek_vec4(0);
+      vvp_vector4_t&vall = thr->peek_vec4(1);
       assert(vall.size() == valr.size());
       unsigned wid = vall.size();
 
@@ -4277,6 +4469,7 @@ bool of_NOR(vthread_t thr, vvp_code_t)
 	    vall.set_bit(idx, ~(lb|rb));
       }
 
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -4814,14 +5007,14 @@ bool of_RELEASE_WR(vthread_t, vvp_code_t cp)
 bool of_REPLICATE(vthread_t thr, vvp_code_t cp)
 {
       int rept = cp->number;
-      vvp_vector4_t val = thr->pop_vec4();
+      vvp_vector4_t&val = thr->peek_vec4();
       vvp_vector4_t res (val.size() * rept, BIT4_X);
 
       for (int idx = 0 ; idx < rept ; idx += 1) {
 	    res.set_vec(idx * val.size(), val);
       }
 
-      thr->push_vec4(res);
+      val.swap(res);
 
       return true;
 }
@@ -5279,9 +5472,16 @@ bool of_STORE_QF_R(vthread_t, vvp_code_t)
 /*
  * %store/qf/str <var-label>
  */
-bool of_STORE_QF_STR(vthread_t, vvp_code_t)
+bool of_STORE_QF_STR(vthread_t thr, vvp_code_t cp)
 {
-      fprintf(stderr, "XXXX %%store/qf/str NOT IMPLEMENTED\n");
+	// Pop the string to be stored...
+      string value = thr->pop_str();
+
+      vvp_net_t*net = cp->net;
+      vvp_queue*dqueue = get_queue_object<vvp_queue_string>(thr, net);
+
+      assert(dqueue);
+      dqueue->push_front(value);
       return true;
 }
 
@@ -5467,10 +5667,11 @@ bool of_STORE_VEC4A(vthread_t thr, vvp_code_t cp)
  */
 bool of_SUB(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t r = thr->pop_vec4();
-      vvp_vector4_t&l = thr->peek_vec4();
+      const vvp_vector4_t&r = thr->peek_vec4(0);
+      vvp_vector4_t&l = thr->peek_vec4(1);
 
       l.sub(r);
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -5694,11 +5895,11 @@ bool of_WAIT_FORK(vthread_t thr, vvp_code_t)
       assert(! thr->i_am_waiting);
 
 	/* There should be no active children when waiting. */
-      assert(thr->children.empty());
+      assert(thr->children == 0);
 
 	/* If there are no detached children then there is nothing to
 	 * wait for. */
-      if (thr->detached_children.empty()) return true;
+      if (thr->detached_children == 0) return true;
 
 	/* Flag that this process is waiting for the detached children
 	 * to finish and suspend it. */
@@ -5711,8 +5912,8 @@ bool of_WAIT_FORK(vthread_t thr, vvp_code_t)
  */
 bool of_XNOR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valr = thr->pop_vec4();
-      vvp_vector4_t&vall = thr->peek_vec4();
+      const vvp_vector4_t&valr = thr->peek_vec4(0);
+      vvp_vector4_t&vall = thr->peek_vec4(1);
       assert(vall.size() == valr.size());
       unsigned wid = vall.size();
 
@@ -5723,6 +5924,7 @@ bool of_XNOR(vthread_t thr, vvp_code_t)
 	    vall.set_bit(idx, ~(lb ^ rb));
       }
 
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -5731,8 +5933,8 @@ bool of_XNOR(vthread_t thr, vvp_code_t)
  */
 bool of_XOR(vthread_t thr, vvp_code_t)
 {
-      vvp_vector4_t valr = thr->pop_vec4();
-      vvp_vector4_t&vall = thr->peek_vec4();
+      const vvp_vector4_t&valr = thr->peek_vec4(0);
+      vvp_vector4_t&vall = thr->peek_vec4(1);
       assert(vall.size() == valr.size());
       unsigned wid = vall.size();
 
@@ -5743,6 +5945,7 @@ bool of_XOR(vthread_t thr, vvp_code_t)
 	    vall.set_bit(idx, lb ^ rb);
       }
 
+      thr->pop_vec4(1);
       return true;
 }
 
@@ -5750,7 +5953,7 @@ bool of_XOR(vthread_t thr, vvp_code_t)
 bool of_ZOMBIE(vthread_t thr, vvp_code_t)
 {
       thr->pc = codespace_null();
-      if ((thr->parent == 0) && (thr->children.empty())) {
+      if ((thr->parent == 0) && (thr->children == 0)) {
 	    if (thr->delay_delete)
 		  schedule_del_thr(thr);
 	    else
@@ -5771,7 +5974,7 @@ bool of_EXEC_UFUNC(vthread_t thr, vvp_code_t cp)
       struct __vpiScope*child_scope = cp->ufunc_core_ptr->func_scope();
       assert(child_scope);
 
-      assert(thr->children.empty());
+      assert(thr->children == 0);
 
         /* We can take a number of shortcuts because we know that a
            continuous assignment can only occur in a static scope. */
@@ -5803,11 +6006,61 @@ bool of_EXEC_UFUNC(vthread_t thr, vvp_code_t cp)
             return true;
 
       child->parent = thr;
-      thr->children.insert(child);
+      thread_list_add(thr->children, child, &vthread_s::sib_link);
       thr->i_am_joining = 1;
       return false;
 }
 
+/*
+ * A .ufunc/i core calls this instead of scheduling a thread with the
+ * %exec_ufunc/%reap_ufunc phantom code. The function body runs in a
+ * thread of its own, as with %exec_ufunc, but there is no parent
+ * thread and nothing is scheduled. The body ends without blocking, so
+ * the result can be collected as soon as the run returns. The result
+ * is collected with the ufunc_caller standing in as the running
+ * thread, so that the context of an automatic function is readable,
+ * as it would be by the phantom thread in %reap_ufunc.
+ */
+static vthread_s ufunc_caller;
+
+void vthread_run_ufunc(ufunc_core*core, vvp_code_t body)
+{
+      struct __vpiScope*child_scope = core->func_scope();
+      assert(child_scope);
+
+      vvp_context_t child_context = 0;
+      if (child_scope->is_automatic)
+	    child_context = vthread_alloc_context(child_scope);
+
+      core->assign_bits_to_ports(child_context);
+
+      vthread_t child = vthread_new(body, child_scope);
+      child->wt_context = child_context;
+      child->rd_context = child_context;
+
+      vthread_t save = running_thread;
+      child->is_scheduled = 1;
+      vthread_run(child);
+
+	/* The body cannot block, so the child has ended and, having no
+	   parent, has been reaped. */
+
+      vvp_context_t save_wt = ufunc_caller.wt_context;
+      vvp_context_t save_rd = ufunc_caller.rd_context;
+      ufunc_caller.wt_context = child_context;
+      ufunc_caller.rd_context = child_context;
+      running_thread = &ufunc_caller;
+
+      core->finish_thread();
+
+      ufunc_caller.wt_context = save_wt;
+      ufunc_caller.rd_context = save_rd;
+      running_thread = save;
+
+      if (child_scope->is_automatic)
+	    vthread_free_context(child_context, child_scope);
+}
+
 /*
  * This is a phantom opcode used to harvest the result of calling a user
  * defined function. It is used in code generated by the .ufunc statement.
@@ -60,9 +60,24 @@ extern void vthread_delay_delete();
 
 /*
  * Cause this thread to execute instructions until in is put to sleep
- * by executing some sort of delay or wait instruction.
+ * by executing some sort of delay or wait instruction. This is a
+ * pointer so that the profiler can switch to the counting version of
+ * the loop, with vthread_enable_profile(), before the simulation
+ * starts.
  */
-extern void vthread_run(vthread_t thr);
+extern void (*vthread_run)(vthread_t thr);
+extern void vthread_enable_profile(void);
+
+/*
+ * This is the inline version of the %exec_ufunc/%reap_ufunc pair of
+ * phantom instructions. It runs the function body of the .ufunc core
+ * right away, from within the caller, and delivers the result. The
+ * body must not block. The vthread_in_thread() function returns true
+ * if a thread is running, so that the caller can tell whether it is
+ * being called from within thread code or from the scheduler.
+ */
+extern void vthread_run_ufunc(class ufunc_core*core, vvp_code_t body);
+extern bool vthread_in_thread(void);
 
 /*
  * This function schedules all the threads in the list to be scheduled
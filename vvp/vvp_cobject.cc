@@ -24,25 +24,31 @@
 
 using namespace std;
 
-vvp_cobject::vvp_cobject(const class_type*defn)
-: defn_(defn), properties_(defn->instance_new())
+void* vvp_cobject::operator new(size_t size, const class_type*defn)
 {
+      assert(size == sizeof(vvp_cobject));
+      return defn->object_alloc();
 }
 
-vvp_cobject::~vvp_cobject()
+void vvp_cobject::operator delete(void*ptr)
 {
-      defn_->instance_delete(properties_);
-      properties_ = 0;
+      class_type::object_free(ptr);
 }
 
-void vvp_cobject::set_vec4(size_t pid, const vvp_vector4_t&val)
+void vvp_cobject::operator delete(void*ptr, const class_type*)
 {
-      defn_->set_vec4(properties_, pid, val);
+      class_type::object_free(ptr);
 }
 
-void vvp_cobject::get_vec4(size_t pid, vvp_vector4_t&val)
+vvp_cobject::vvp_cobject(const class_type*defn)
+: defn_(defn), properties_(defn->instance_new(this))
 {
-      defn_->get_vec4(properties_, pid, val);
+}
+
+vvp_cobject::~vvp_cobject()
+{
+      defn_->instance_delete(properties_);
+      properties_ = 0;
 }
 
 void vvp_cobject::set_real(size_t pid, double val)
@@ -32,8 +32,17 @@ class vvp_cobject : public vvp_object {
       explicit vvp_cobject(const class_type*defn);
       ~vvp_cobject();
 
-      void set_vec4(size_t pid, const vvp_vector4_t&val);
-      void get_vec4(size_t pid, vvp_vector4_t&val);
+	// Class objects are allocated by their class type, which
+	// keeps the object and its properties together in one block.
+	// Make them like this: new (defn) vvp_cobject(defn)
+      static void* operator new(size_t size, const class_type*defn);
+      static void operator delete(void*ptr);
+      static void operator delete(void*ptr, const class_type*defn);
+
+      inline void set_vec4(size_t pid, const vvp_vector4_t&val)
+      { defn_->set_vec4(properties_, pid, val); }
+      inline void get_vec4(size_t pid, vvp_vector4_t&val)
+      { defn_->get_vec4(properties_, pid, val); }
 
       void set_real(size_t pid, double val);
       double get_real(size_t pid);
@@ -237,18 +237,17 @@ void vvp_queue_string::push_back(const string&val)
       array_.push_back(val);
 }
 
+void vvp_queue_string::push_front(const string&val)
+{
+      array_.push_front(val);
+}
+
 void vvp_queue_string::set_word(unsigned adr, const string&value)
 {
       if (adr >= array_.size())
 	    return;
 
-      list<string>::iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      *cur = value;
+      array_[adr] = value;
 }
 
 void vvp_queue_string::get_word(unsigned adr, string&value)
@@ -258,13 +257,7 @@ void vvp_queue_string::get_word(unsigned adr, string&value)
 	    return;
       }
 
-      list<string>::const_iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      value = *cur;
+      value = array_[adr];
 }
 
 void vvp_queue_string::pop_back(void)
@@ -291,13 +284,7 @@ void vvp_queue_vec4::set_word(unsigned adr, const vvp_vector4_t&value)
       if (adr >= array_.size())
 	    return;
 
-      list<vvp_vector4_t>::iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      *cur = value;
+      array_[adr] = value;
 }
 
 void vvp_queue_vec4::get_word(unsigned adr, vvp_vector4_t&value)
@@ -307,13 +294,7 @@ void vvp_queue_vec4::get_word(unsigned adr, vvp_vector4_t&value)
 	    return;
       }
 
-      list<vvp_vector4_t>::const_iterator cur = array_.begin();
-      while (adr > 0) {
-	    ++ cur;
-	    adr -= 1;
-      }
-
-      value = *cur;
+      value = array_[adr];
 }
 
 void vvp_queue_vec4::push_back(const vvp_vector4_t&val)
@@ -20,7 +20,6 @@
  */
 
 # include  "vvp_object.h"
-# include  <list>
 # include  <string>
 # include  <vector>
 
@@ -103,6 +102,79 @@ class vvp_darray_object : public vvp_darray {
       std::vector<vvp_object_t> array_;
 };
 
+/*
+ * The queue items are kept in a circular buffer so that items can be
+ * added or removed at either end in (amortized) constant time, and
+ * indexed in constant time. The buffer capacity is always a power of
+ * 2, so the index wraps with a mask, and it doubles when it fills.
+ * Popped slots are not cleared, so a later push can reuse them.
+ */
+template <class TYPE> class vvp_queue_ring {
+
+    public:
+      inline vvp_queue_ring() : head_(0), size_(0) { }
+
+      inline size_t size() const { return size_; }
+
+      inline TYPE& operator[] (size_t idx)
+      { return buf_[(head_+idx) & (buf_.size()-1)]; }
+
+	// Make sure there is room for at least cnt items.
+      void reserve(size_t cnt);
+
+      inline void push_back(const TYPE&val)
+      {
+	    if (size_ == buf_.size())
+		  reserve(size_+1);
+	    size_ += 1;
+	    (*this)[size_-1] = val;
+      }
+      inline void push_front(const TYPE&val)
+      {
+	    if (size_ == buf_.size())
+		  reserve(size_+1);
+	    head_ = (head_ + buf_.size() - 1) & (buf_.size()-1);
+	    size_ += 1;
+	    (*this)[0] = val;
+      }
+      inline void pop_back(void)
+      {
+	    if (size_ > 0)
+		  size_ -= 1;
+      }
+      inline void pop_front(void)
+      {
+	    if (size_ > 0) {
+		  head_ = (head_ + 1) & (buf_.size()-1);
+		  size_ -= 1;
+	    }
+      }
+
+    private:
+      std::vector<TYPE> buf_;
+      size_t head_;
+      size_t size_;
+};
+
+template <class TYPE> void vvp_queue_ring<TYPE>::reserve(size_t cnt)
+{
+      if (cnt <= buf_.size())
+	    return;
+
+      size_t new_cap = buf_.empty()? 8 : buf_.size();
+      while (new_cap < cnt)
+	    new_cap *= 2;
+
+	// Copy the items into the new buffer starting at the
+	// beginning, so that the head is at 0 again.
+      std::vector<TYPE> tmp (new_cap);
+      for (size_t idx = 0 ; idx < size_ ; idx += 1)
+	    tmp[idx] = (*this)[idx];
+
+      buf_.swap(tmp);
+      head_ = 0;
+}
+
 class vvp_queue : public vvp_darray {
 
     public:
@@ -136,7 +208,7 @@ class vvp_queue_vec4 : public vvp_queue {
       void pop_front(void);
 
     private:
-      std::list<vvp_vector4_t> array_;
+      vvp_queue_ring<vvp_vector4_t> array_;
 };
 
 
@@ -149,12 +221,12 @@ class vvp_queue_string : public vvp_queue {
       void set_word(unsigned adr, const std::string&value);
       void get_word(unsigned adr, std::string&value);
       void push_back(const std::string&value);
-	//void push_front(const std::string&value);
+      void push_front(const std::string&value);
       void pop_back(void);
       void pop_front(void);
 
     private:
-      std::list<std::string> array_;
+      vvp_queue_ring<std::string> array_;
 };
 
 #endif /* IVL_vvp_darray_H */
@@ -25,6 +25,7 @@
 # include  "symbols.h"
 # include  "schedule.h"
 # include  <list>
+# include  <vector>
 # include  <cassert>
 
 /*
@@ -67,7 +68,7 @@ class vvp_island  : private vvp_gen_event_s {
 	// the input. The island will use this to create an active
 	// event. The run_run() method will then be called by the
 	// scheduler to process whatever happened.
-      void flag_island();
+      void flag_island(vvp_island_port*port);
 
 	// This is the method that is called, eventually, to process
 	// whatever happened. The derived island class implements this
@@ -84,6 +85,11 @@ class vvp_island  : private vvp_gen_event_s {
 	// scanning the mesh.
       vvp_island_branch*branches_;
 
+	// The ports that flagged the island since it last ran. Each
+	// port is listed once, and the derived class takes the list
+	// when it runs so that it can work on only what changed.
+      std::vector<vvp_island_port*> flagged_ports_;
+
     public: /* These methods are used during linking. */
 
 	// Add a port to the island. The key is added to the island
@@ -145,6 +151,12 @@ class vvp_island_port  : public vvp_net_fun_t {
       vvp_vector8_t outvalue;
       vvp_vector8_t value;
 
+	// The island may number its ports with this index. The
+	// flagged bit is set while the port is in the flagged_ports_
+	// list of the island.
+      unsigned index;
+      bool flagged;
+
     private:
       vvp_island*island_;
 
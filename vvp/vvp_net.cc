@@ -25,6 +25,8 @@
 # include  "resolv.h"
 # include  "schedule.h"
 # include  "statistics.h"
+# include  "part.h"
+# include  "logic.h"
 # include  <cstdio>
 # include  <cstring>
 # include  <cstdlib>
@@ -33,6 +35,7 @@
 # include  <climits>
 # include  <cmath>
 # include  <cassert>
+# include  <vector>
 #ifdef CHECK_WITH_VALGRIND
 # include  <valgrind/memcheck.h>
 # include  <map>
@@ -57,6 +60,9 @@ static vvp_net_t **vvp_net_pool = NULL;
 static unsigned vvp_net_pool_count = 0;
 #endif
 static size_t vvp_net_alloc_remaining = 0;
+// Keep a list of the chunks so that vvp_net_flatten can visit all
+// the nets that have been allocated.
+static std::vector<vvp_net_t*> vvp_net_chunks;
 // For statistics, count the vvp_nets allocated and the bytes of alloc
 // chunks allocated.
 unsigned long count_vvp_nets = 0;
@@ -69,6 +75,7 @@ void* vvp_net_t::operator new (size_t size)
 	    vvp_net_alloc_table = ::new vvp_net_t[VVP_NET_CHUNK];
 	    vvp_net_alloc_remaining = VVP_NET_CHUNK;
 	    size_vvp_nets += size*VVP_NET_CHUNK;
+	    vvp_net_chunks.push_back(vvp_net_alloc_table);
 #ifdef CHECK_WITH_VALGRIND
 	    VALGRIND_MAKE_MEM_NOACCESS(vvp_net_alloc_table, size*VVP_NET_CHUNK);
 	    VALGRIND_CREATE_MEMPOOL(vvp_net_alloc_table, 0, 0);
@@ -187,6 +194,288 @@ void vvp_net_t::operator delete(void*)
       assert(0);
 }
 
+/*
+ * The net flattening pass describes each candidate node by the
+ * source of each of its output bits, in the form used by
+ * vvp_fun_permute. The sched mask marks the ports that pass through a
+ * vvp_fun_part_sa, and the used mask marks the ports that any output
+ * bit actually comes from.
+ */
+struct flatten_desc_s {
+      std::vector<unsigned> src;
+      unsigned sched;
+      unsigned used;
+};
+
+struct flatten_drv_s {
+      flatten_drv_s() { drv[0] = drv[1] = drv[2] = drv[3] = 0; }
+      vvp_net_t*drv[4];
+};
+
+typedef std::map<vvp_net_t*,flatten_drv_s> flatten_drv_map_t;
+
+static const unsigned FLATTEN_PORT_MASK = (1U << vvp_fun_permute::PORT_SHIFT) - 1;
+
+/*
+ * Only these exact types are understood. Derived types (for example
+ * vvp_fun_buft) have different behavior so typeid is used instead of
+ * dynamic_cast. The vvp_fun_buf is not here because it changes Z bits
+ * to X.
+ */
+static bool flatten_type_ok_(const vvp_net_fun_t*fun)
+{
+      if (fun == 0)
+	    return false;
+
+      const std::type_info&type = typeid(*fun);
+      return type == typeid(vvp_fun_part_sa)
+	    || type == typeid(vvp_fun_concat)
+	    || type == typeid(vvp_fun_repeat)
+	    || type == typeid(vvp_fun_extend_signed)
+	    || type == typeid(vvp_fun_bufz)
+	    || type == typeid(vvp_fun_permute);
+}
+
+static bool flatten_describe_(vvp_net_t*net, flatten_drv_map_t&drivers,
+			      flatten_desc_s&desc, bool as_dest, unsigned depth);
+
+/*
+ * Get the output width of the node, if it can be known at compile
+ * time. Return 0 if it cannot.
+ */
+static unsigned flatten_width_(vvp_net_t*net, flatten_drv_map_t&drivers,
+			       unsigned depth)
+{
+      if (net == 0 || depth > 64)
+	    return 0;
+
+      flatten_desc_s tmp;
+      if (! flatten_describe_(net, drivers, tmp, false, depth+1))
+	    return 0;
+
+      return tmp.src.size();
+}
+
+/*
+ * Describe the node. The sign extension and bufz nodes have output
+ * widths that depend on their input, so they can only be described
+ * if the input comes from a node whose width is known. The bufz also
+ * passes strengths and real values, so it may not be replaced, but it
+ * may be merged into a node that does not carry those either.
+ */
+static bool flatten_describe_(vvp_net_t*net, flatten_drv_map_t&drivers,
+			      flatten_desc_s&desc, bool as_dest, unsigned depth)
+{
+      vvp_net_fun_t*fun = net->fun;
+      if (! flatten_type_ok_(fun))
+	    return false;
+
+      const std::type_info&type = typeid(*fun);
+      desc.src.clear();
+      desc.sched = 0;
+      desc.used = 0;
+
+      if (type == typeid(vvp_fun_part_sa)) {
+	    vvp_fun_part_sa*tmp = static_cast<vvp_fun_part_sa*>(fun);
+	    for (unsigned idx = 0 ; idx < tmp->width() ; idx += 1)
+		  desc.src.push_back(tmp->base() + idx);
+	    desc.sched = 1;
+
+      } else if (type == typeid(vvp_fun_concat)) {
+	    vvp_fun_concat*tmp = static_cast<vvp_fun_concat*>(fun);
+	    for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+		  for (unsigned idx = 0 ; idx < tmp->port_width(pdx) ; idx += 1)
+			desc.src.push_back((pdx << vvp_fun_permute::PORT_SHIFT) | idx);
+	    }
+
+      } else if (type == typeid(vvp_fun_repeat)) {
+	    vvp_fun_repeat*tmp = static_cast<vvp_fun_repeat*>(fun);
+	    if (tmp->repeat() == 0)
+		  return false;
+	    unsigned wid = tmp->width() / tmp->repeat();
+	    for (unsigned rdx = 0 ; rdx < tmp->repeat() ; rdx += 1) {
+		  for (unsigned idx = 0 ; idx < wid ; idx += 1)
+			desc.src.push_back(idx);
+	    }
+
+      } else if (type == typeid(vvp_fun_extend_signed)) {
+	    vvp_fun_extend_signed*tmp = static_cast<vvp_fun_extend_signed*>(fun);
+	    unsigned iwid = flatten_width_(drivers[net].drv[0], drivers, depth);
+	    if (iwid == 0)
+		  return false;
+	    for (unsigned idx = 0 ; idx < iwid ; idx += 1)
+		  desc.src.push_back(idx);
+	    for (unsigned idx = iwid ; idx < tmp->width() ; idx += 1)
+		  desc.src.push_back(iwid-1);
+
+      } else if (type == typeid(vvp_fun_bufz)) {
+	    if (as_dest)
+		  return false;
+	    unsigned iwid = flatten_width_(drivers[net].drv[0], drivers, depth);
+	    if (iwid == 0)
+		  return false;
+	    for (unsigned idx = 0 ; idx < iwid ; idx += 1)
+		  desc.src.push_back(idx);
+
+      } else {
+	    vvp_fun_permute*tmp = static_cast<vvp_fun_permute*>(fun);
+	    tmp->get_map(desc.src);
+	    desc.sched = tmp->sched_mask();
+      }
+
+      for (size_t idx = 0 ; idx < desc.src.size() ; idx += 1) {
+	    if (desc.src[idx] != vvp_fun_permute::SRC_X)
+		  desc.used |= 1U << (desc.src[idx] >> vvp_fun_permute::PORT_SHIFT);
+      }
+
+      return true;
+}
+
+/*
+ * Merge the node src, whose only output goes to port dport of the
+ * node dst, into dst. The inputs of src are moved to free ports of
+ * dst, and dst gets a vvp_fun_permute that does the work of both. The
+ * src node is left unlinked. Its functor is not deleted, because the
+ * functor heap does not support that.
+ */
+static bool flatten_merge_(vvp_net_t*src, vvp_net_t*dst, unsigned dport,
+			   flatten_drv_map_t&drivers, unsigned dst_const)
+{
+      flatten_desc_s sdesc, ddesc;
+      if (! flatten_describe_(src, drivers, sdesc, false, 0))
+	    return false;
+      if (! flatten_describe_(dst, drivers, ddesc, true, 0))
+	    return false;
+
+      flatten_drv_s&sdrv = drivers[src];
+      flatten_drv_s&ddrv = drivers[dst];
+
+	// The port that src drives is free, as is any port of dst
+	// that is not used and not driven.
+      unsigned free_ports[4];
+      unsigned nfree = 0;
+      free_ports[nfree++] = dport;
+      for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+	    if (pdx == dport || (ddesc.used & (1U << pdx)))
+		  continue;
+	    if (ddrv.drv[pdx] || (dst_const & (1U << pdx)))
+		  continue;
+	    free_ports[nfree++] = pdx;
+      }
+
+      unsigned new_port[4];
+      unsigned nused = 0;
+      for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+	    if (! (sdesc.used & (1U << pdx)))
+		  continue;
+	    vvp_net_t*drv = sdrv.drv[pdx];
+	    if (drv == 0 || drv == src || drv == dst)
+		  return false;
+	    if (nused >= nfree)
+		  return false;
+	    new_port[pdx] = free_ports[nused++];
+      }
+
+      std::vector<unsigned> map (ddesc.src.size());
+      for (size_t idx = 0 ; idx < map.size() ; idx += 1) {
+	    unsigned cur = ddesc.src[idx];
+	    if (cur == vvp_fun_permute::SRC_X
+		|| (cur >> vvp_fun_permute::PORT_SHIFT) != dport) {
+		  map[idx] = cur;
+		  continue;
+	    }
+
+	    unsigned bit = cur & FLATTEN_PORT_MASK;
+	    if (bit >= sdesc.src.size()
+		|| sdesc.src[bit] == vvp_fun_permute::SRC_X) {
+		  map[idx] = vvp_fun_permute::SRC_X;
+		  continue;
+	    }
+
+	    cur = sdesc.src[bit];
+	    map[idx] = (new_port[cur >> vvp_fun_permute::PORT_SHIFT]
+			<< vvp_fun_permute::PORT_SHIFT)
+		  | (cur & FLATTEN_PORT_MASK);
+      }
+
+      unsigned sched = ddesc.sched & ~(1U << dport);
+      for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+	    if (! (sdesc.used & (1U << pdx)))
+		  continue;
+	    if ((ddesc.sched & (1U << dport)) || (sdesc.sched & (1U << pdx)))
+		  sched |= 1U << new_port[pdx];
+      }
+
+	// Now relink the inputs of src to dst.
+      src->unlink(vvp_net_ptr_t(dst, dport));
+      ddrv.drv[dport] = 0;
+      for (unsigned pdx = 0 ; pdx < 4 ; pdx += 1) {
+	    if (! (sdesc.used & (1U << pdx)))
+		  continue;
+	    vvp_net_t*drv = sdrv.drv[pdx];
+	    drv->unlink(vvp_net_ptr_t(src, pdx));
+	    drv->link(vvp_net_ptr_t(dst, new_port[pdx]));
+	    sdrv.drv[pdx] = 0;
+	    ddrv.drv[new_port[pdx]] = drv;
+      }
+
+      dst->fun = new vvp_fun_permute(map, sched);
+      return true;
+}
+
+void vvp_net_flatten(const std::set<vvp_net_t*>&pinned,
+		     const std::map<vvp_net_t*,unsigned>&const_ports)
+{
+      unsigned long nnets = count_vvp_nets;
+
+	// Collect the drivers of the ports of the candidate nodes. A
+	// port is a link in the fan-out list of its driver, so it can
+	// have at most one.
+      flatten_drv_map_t drivers;
+      for (unsigned long idx = 0 ; idx < nnets ; idx += 1) {
+	    vvp_net_t*net = vvp_net_chunks[idx/VVP_NET_CHUNK] + idx%VVP_NET_CHUNK;
+
+	    for (vvp_net_ptr_t cur = net->out_ ; ! cur.nil()
+		       ; cur = cur.ptr()->port[cur.port()]) {
+		  if (flatten_type_ok_(cur.ptr()->fun))
+			drivers[cur.ptr()].drv[cur.port()] = net;
+	    }
+      }
+
+	// Merge each candidate with a single fan-out into the node
+	// that it drives, until there are no more to merge.
+      bool progress = true;
+      while (progress) {
+	    progress = false;
+	    for (unsigned long idx = 0 ; idx < nnets ; idx += 1) {
+		  vvp_net_t*net = vvp_net_chunks[idx/VVP_NET_CHUNK] + idx%VVP_NET_CHUNK;
+
+		  if (net->fil || ! flatten_type_ok_(net->fun))
+			continue;
+		  if (pinned.count(net))
+			continue;
+
+		  vvp_net_ptr_t out = net->out_;
+		  if (out.nil())
+			continue;
+		  vvp_net_t*dst = out.ptr();
+		  if (dst == net || ! dst->port[out.port()].nil())
+			continue;
+		  if (pinned.count(dst))
+			continue;
+
+		  std::map<vvp_net_t*,unsigned>::const_iterator cp
+			= const_ports.find(dst);
+		  unsigned dst_const = cp == const_ports.end()? 0 : cp->second;
+
+		  if (flatten_merge_(net, dst, out.port(), drivers, dst_const)) {
+			count_functors_flattened += 1;
+			progress = true;
+		  }
+	    }
+      }
+}
+
 vvp_net_t::vvp_net_t()
 : out_(vvp_net_ptr_t(0,0))
 {
@@ -518,6 +807,12 @@ int edge(vvp_bit4_t from, vvp_bit4_t to)
 unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 				  unsigned long&carry)
 {
+#if defined(__SIZEOF_INT128__) && (__SIZEOF_LONG__ == 8)
+	// The compiler can do the double width multiply directly.
+      unsigned __int128 tmp = (unsigned __int128)a * b;
+      carry = (unsigned long)(tmp >> 64);
+      return (unsigned long)tmp;
+#else
       const unsigned long mask = (1UL << (CPU_WORD_BITS/2)) - 1;
       unsigned long a0 = a & mask;
       unsigned long a1 = (a >> (CPU_WORD_BITS/2)) & mask;
@@ -555,6 +850,288 @@ unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 
       carry = (r3 << (CPU_WORD_BITS/2)) + r2;
       return (r1 << (CPU_WORD_BITS/2)) + r00;
+#endif
+}
+
+/*
+ * Return the low word of a*b + c + d, and put the high word in
+ * high. This cannot overflow, because (2^N-1)^2 + 2*(2^N-1) is
+ * 2^2N - 1.
+ */
+static inline unsigned long multiply_add(unsigned long a, unsigned long b,
+					 unsigned long c, unsigned long d,
+					 unsigned long&high)
+{
+      unsigned long low = multiply_with_carry(a, b, high);
+      low += c;
+      if (low < c) high += 1;
+      low += d;
+      if (low < d) high += 1;
+      return low;
+}
+
+/*
+ * Below this many words, the multiply is done the schoolbook way.
+ * Above it, the Karatsuba split saves enough multiplies to pay for
+ * its extra additions and scratch space.
+ */
+static const unsigned KARATSUBA_WORDS = 24;
+
+  // res[0..na+nb) = a[0..na) * b[0..nb)
+static void multiply_full_school(unsigned long*res,
+				 const unsigned long*a, unsigned na,
+				 const unsigned long*b, unsigned nb)
+{
+      for (unsigned idx = 0 ; idx < na+nb ; idx += 1)
+	    res[idx] = 0;
+
+      for (unsigned adx = 0 ; adx < na ; adx += 1) {
+	    unsigned long carry = 0;
+	    if (a[adx] == 0)
+		  continue;
+	    for (unsigned bdx = 0 ; bdx < nb ; bdx += 1)
+		  res[adx+bdx] = multiply_add(a[adx], b[bdx], res[adx+bdx],
+					      carry, carry);
+	    res[adx+nb] = carry;
+      }
+}
+
+  // Add src[0..ns) into dst[0..nd), and return the carry out.
+static unsigned long add_words_into(unsigned long*dst, unsigned nd,
+				    const unsigned long*src, unsigned ns)
+{
+      unsigned long carry = 0;
+      unsigned idx = 0;
+      for ( ; idx < ns ; idx += 1)
+	    dst[idx] = add_with_carry(dst[idx], src[idx], carry);
+      for ( ; carry && idx < nd ; idx += 1)
+	    dst[idx] = add_with_carry(dst[idx], 0, carry);
+      return carry;
+}
+
+  // Subtract src[0..ns) from dst[0..nd). The caller knows that the
+  // result is not negative.
+static void sub_words_from(unsigned long*dst, unsigned nd,
+			   const unsigned long*src, unsigned ns)
+{
+      unsigned long carry = 1;
+      unsigned idx = 0;
+      for ( ; idx < ns ; idx += 1)
+	    dst[idx] = add_with_carry(dst[idx], ~src[idx], carry);
+      for ( ; !carry && idx < nd ; idx += 1)
+	    dst[idx] = add_with_carry(dst[idx], ~0UL, carry);
+}
+
+  // res[0..2n) = a[0..n) * b[0..n)
+static void multiply_full(unsigned long*res, const unsigned long*a,
+			  const unsigned long*b, unsigned n)
+{
+      if (n < KARATSUBA_WORDS) {
+	    multiply_full_school(res, a, n, b, n);
+	    return;
+      }
+
+	// Split the operands into a = a1*B^l + a0, and the same for
+	// b. Then a*b = z2*B^2l + z1*B^l + z0 where z0 = a0*b0, z2 =
+	// a1*b1 and z1 = (a0+a1)*(b0+b1) - z0 - z2.
+      unsigned l = (n + 1) / 2;
+      unsigned h = n - l;
+
+      multiply_full(res, a, b, l);
+      for (unsigned idx = 2*l ; idx < 2*n ; idx += 1)
+	    res[idx] = 0;
+      if (h == l) {
+	    multiply_full(res+2*l, a+l, b+l, h);
+      } else {
+	    multiply_full_school(res+2*l, a+l, h, b+l, h);
+      }
+
+      std::vector<unsigned long> sa (a, a+l), sb (b, b+l);
+      sa.push_back(add_words_into(&sa[0], l, a+l, h));
+      sb.push_back(add_words_into(&sb[0], l, b+l, h));
+
+      std::vector<unsigned long> z1 (2*(l+1));
+      multiply_full(&z1[0], &sa[0], &sb[0], l+1);
+      sub_words_from(&z1[0], 2*(l+1), res, 2*l);
+      sub_words_from(&z1[0], 2*(l+1), res+2*l, 2*h);
+
+      unsigned z1_words = 2*(l+1);
+      if (z1_words > 2*n - l) z1_words = 2*n - l;
+      add_words_into(res+l, 2*n-l, &z1[0], z1_words);
+}
+
+  // res[0..n) = (a[0..n) * b[0..n)) mod B^n
+static void multiply_low(unsigned long*res, const unsigned long*a,
+			 const unsigned long*b, unsigned n)
+{
+      if (n < KARATSUBA_WORDS) {
+	    for (unsigned idx = 0 ; idx < n ; idx += 1)
+		  res[idx] = 0;
+
+	    for (unsigned adx = 0 ; adx < n ; adx += 1) {
+		  unsigned long carry = 0;
+		  if (a[adx] == 0)
+			continue;
+		  for (unsigned bdx = 0 ; bdx < n-adx ; bdx += 1)
+			res[adx+bdx] = multiply_add(a[adx], b[bdx],
+						    res[adx+bdx],
+						    carry, carry);
+	    }
+	    return;
+      }
+
+	// Only the low words of the product are needed, so only the
+	// a0*b0 part is needed in full. The a0*b1 and a1*b0 parts
+	// are only needed for their low h words.
+      unsigned l = (n + 1) / 2;
+      unsigned h = n - l;
+
+      std::vector<unsigned long> z0 (2*l);
+      multiply_full(&z0[0], a, b, l);
+      for (unsigned idx = 0 ; idx < n ; idx += 1)
+	    res[idx] = z0[idx];
+
+      std::vector<unsigned long> tmp (h);
+      multiply_low(&tmp[0], a, b+l, h);
+      add_words_into(res+l, h, &tmp[0], h);
+      multiply_low(&tmp[0], a+l, b, h);
+      add_words_into(res+l, h, &tmp[0], h);
+}
+
+void multiply_words(unsigned long*res, const unsigned long*a,
+		    const unsigned long*b, unsigned words)
+{
+      multiply_low(res, a, b, words);
+}
+
+/*
+ * This is Knuth's algorithm D (The Art of Computer Programming,
+ * Volume 2, 4.3.1) for unsigned division. It works with 32 bit
+ * digits so that the trial quotient only needs a 64 bit divide.
+ */
+bool divide_words(unsigned long*quot, unsigned long*rem,
+		  const unsigned long*a, const unsigned long*b,
+		  unsigned words)
+{
+      const unsigned DIGITS_PER_WORD = CPU_WORD_BITS / 32;
+      const uint64_t BASE = 1ULL << 32;
+      unsigned digits = words * DIGITS_PER_WORD;
+
+      std::vector<uint32_t> u (digits+1), v (digits);
+      for (unsigned idx = 0 ; idx < digits ; idx += 1) {
+	    unsigned sh = 32 * (idx % DIGITS_PER_WORD);
+	    u[idx] = (uint32_t)(a[idx/DIGITS_PER_WORD] >> sh);
+	    v[idx] = (uint32_t)(b[idx/DIGITS_PER_WORD] >> sh);
+      }
+
+      unsigned n = digits;
+      while (n > 0 && v[n-1] == 0)
+	    n -= 1;
+      if (n == 0)
+	    return false;
+
+      unsigned m = digits;
+      while (m > 0 && u[m-1] == 0)
+	    m -= 1;
+
+      std::vector<uint32_t> q (digits);
+
+      if (m < n) {
+	      // The quotient is zero and the remainder is a.
+
+      } else if (n == 1) {
+	      // Dividing by a single digit is simple short division.
+	    uint64_t r = 0;
+	    for (unsigned idx = m ; idx > 0 ; idx -= 1) {
+		  uint64_t cur = (r << 32) | u[idx-1];
+		  q[idx-1] = (uint32_t)(cur / v[0]);
+		  r = cur % v[0];
+	    }
+	    for (unsigned idx = 0 ; idx < m ; idx += 1)
+		  u[idx] = 0;
+	    u[0] = (uint32_t)r;
+
+      } else {
+	      // Normalize so that the top bit of the divisor is set,
+	      // which makes the trial quotient off by at most 2.
+	    unsigned s = 0;
+	    while (((v[n-1] << s) & 0x80000000U) == 0)
+		  s += 1;
+	    if (s > 0) {
+		  for (unsigned idx = n ; idx > 1 ; idx -= 1)
+			v[idx-1] = (v[idx-1] << s) | (v[idx-2] >> (32-s));
+		  v[0] <<= s;
+		  u[m] = u[m-1] >> (32-s);
+		  for (unsigned idx = m ; idx > 1 ; idx -= 1)
+			u[idx-1] = (u[idx-1] << s) | (u[idx-2] >> (32-s));
+		  u[0] <<= s;
+	    }
+
+	    for (unsigned jdx = m - n + 1 ; jdx > 0 ; jdx -= 1) {
+		  unsigned j = jdx - 1;
+		  uint64_t num = ((uint64_t)u[j+n] << 32) | u[j+n-1];
+		  uint64_t qhat = num / v[n-1];
+		  uint64_t rhat = num % v[n-1];
+		  while (qhat >= BASE ||
+			 qhat * v[n-2] > ((rhat << 32) | u[j+n-2])) {
+			qhat -= 1;
+			rhat += v[n-1];
+			if (rhat >= BASE)
+			      break;
+		  }
+
+		    // Multiply and subtract qhat*v from u[j..j+n].
+		  int64_t borrow = 0;
+		  uint64_t carry = 0;
+		  for (unsigned idx = 0 ; idx < n ; idx += 1) {
+			uint64_t p = qhat * v[idx] + carry;
+			carry = p >> 32;
+			int64_t t = (int64_t)u[idx+j] - borrow
+			      - (int64_t)(p & 0xffffffffU);
+			u[idx+j] = (uint32_t)t;
+			borrow = t < 0? 1 : 0;
+		  }
+		  int64_t t = (int64_t)u[j+n] - borrow - (int64_t)carry;
+		  u[j+n] = (uint32_t)t;
+
+		    // If the result went negative, then qhat was one
+		    // too big, so add v back in.
+		  if (t < 0) {
+			qhat -= 1;
+			uint64_t c = 0;
+			for (unsigned idx = 0 ; idx < n ; idx += 1) {
+			      uint64_t sum = (uint64_t)u[idx+j] + v[idx] + c;
+			      u[idx+j] = (uint32_t)sum;
+			      c = sum >> 32;
+			}
+			u[j+n] += (uint32_t)c;
+		  }
+
+		  q[j] = (uint32_t)qhat;
+	    }
+
+	      // Unnormalize the remainder.
+	    if (s > 0) {
+		  for (unsigned idx = 0 ; idx < n-1 ; idx += 1)
+			u[idx] = (u[idx] >> s) | (u[idx+1] << (32-s));
+		  u[n-1] >>= s;
+	    }
+	    for (unsigned idx = n ; idx <= m ; idx += 1)
+		  u[idx] = 0;
+      }
+
+      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+	    unsigned long qw = 0, rw = 0;
+	    for (unsigned ddx = 0 ; ddx < DIGITS_PER_WORD ; ddx += 1) {
+		  unsigned dig = idx*DIGITS_PER_WORD + ddx;
+		  qw |= (unsigned long)q[dig] << (32*ddx);
+		  rw |= (unsigned long)u[dig] << (32*ddx);
+	    }
+	    if (quot) quot[idx] = qw;
+	    if (rem)  rem[idx]  = rw;
+      }
+
+      return true;
 }
 
 
@@ -1132,6 +1709,114 @@ unsigned long* vvp_vector4_t::subarray(unsigned adr, unsigned wid, bool xz_to_0)
       return 0;
 }
 
+void vvp_vector4_t::get_vecval(s_vpi_vecval*dst) const
+{
+      unsigned words = (size_ + 31) / 32;
+      if (words == 0)
+	    return;
+
+      const unsigned long*abits = &abits_val_;
+      const unsigned long*bbits = &bbits_val_;
+      if (size_ > BITS_PER_WORD) {
+	    abits = abits_ptr_;
+	    bbits = bbits_ptr_;
+      }
+
+	// The bit planes are copied 32 bits at a time, so the
+	// vpiVectorVal words are pulled out of the (possibly wider)
+	// words of the planes by shifting.
+      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+	    unsigned wdx = (idx*32) / BITS_PER_WORD;
+	    unsigned off = (idx*32) % BITS_PER_WORD;
+	    dst[idx].aval = (PLI_INT32)(PLI_UINT32)(abits[wdx] >> off);
+	    dst[idx].bval = (PLI_INT32)(PLI_UINT32)(bbits[wdx] >> off);
+      }
+
+	// Clear the bits past the end of the vector in the last word.
+      if (unsigned tail = size_ % 32) {
+	    PLI_UINT32 mask = (1UL << tail) - 1UL;
+	    dst[words-1].aval &= mask;
+	    dst[words-1].bval &= mask;
+      }
+}
+
+bool vvp_vector4_t::update_bits2(unsigned long*dst) const
+{
+      if (size_ <= BITS_PER_WORD) {
+	    unsigned long tmp = abits_val_ & ~bbits_val_;
+	    if (size_ < BITS_PER_WORD)
+		  tmp &= ~(-1UL << size_);
+	    bool rc = dst[0] != tmp;
+	    dst[0] = tmp;
+	    return rc;
+      }
+
+      unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+      bool rc = false;
+      for (unsigned idx = 0 ;  idx < words ;  idx += 1) {
+	    unsigned long tmp = abits_ptr_[idx] & ~bbits_ptr_[idx];
+	    if (idx == words-1 && (size_ % BITS_PER_WORD))
+		  tmp &= ~(-1UL << (size_ % BITS_PER_WORD));
+	    if (dst[idx] != tmp) {
+		  dst[idx] = tmp;
+		  rc = true;
+	    }
+      }
+      return rc;
+}
+
+void vvp_vector4_t::set_bits2(const unsigned long*src)
+{
+      if (size_ <= BITS_PER_WORD) {
+	    abits_val_ = src[0];
+	    bbits_val_ = 0;
+	    return;
+      }
+
+      unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+      for (unsigned idx = 0 ;  idx < words ;  idx += 1) {
+	    abits_ptr_[idx] = src[idx];
+	    bbits_ptr_[idx] = 0;
+      }
+}
+
+void vvp_vector4_t::set_vecval(const s_vpi_vecval*src)
+{
+      unsigned words = (size_ + 31) / 32;
+      if (words == 0)
+	    return;
+
+      unsigned long*abits = &abits_val_;
+      unsigned long*bbits = &bbits_val_;
+      unsigned cnt = 1;
+      if (size_ > BITS_PER_WORD) {
+	    abits = abits_ptr_;
+	    bbits = bbits_ptr_;
+	    cnt = (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+      }
+
+      for (unsigned idx = 0 ; idx < cnt ; idx += 1) {
+	    abits[idx] = 0;
+	    bbits[idx] = 0;
+      }
+
+	// This is the reverse of get_vecval: the 32 bit words are
+	// shifted into place in the (possibly wider) plane words.
+      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+	    unsigned wdx = (idx*32) / BITS_PER_WORD;
+	    unsigned off = (idx*32) % BITS_PER_WORD;
+	    abits[wdx] |= (unsigned long)(PLI_UINT32)src[idx].aval << off;
+	    bbits[wdx] |= (unsigned long)(PLI_UINT32)src[idx].bval << off;
+      }
+
+	// Clear the bits past the end of the vector in the last word.
+      if (unsigned tail = size_ % BITS_PER_WORD) {
+	    unsigned long mask = (1UL << tail) - 1UL;
+	    abits[cnt-1] &= mask;
+	    bbits[cnt-1] &= mask;
+      }
+}
+
 void vvp_vector4_t::setarray(unsigned adr, unsigned wid, const unsigned long*val)
 {
       assert(adr+wid <= size_);
@@ -1414,6 +2099,65 @@ bool vvp_vector4_t::set_vec(unsigned adr, const vvp_vector4_t&that)
       return diff_flag;
 }
 
+/*
+ * Set a part of that vector into the addressed part of this
+ * vector. This is like mov() but between two vectors, so the small
+ * vector cases are handled by pointing at the inline word.
+ */
+bool vvp_vector4_t::set_vec(unsigned dst, const vvp_vector4_t&that,
+			    unsigned src, unsigned cnt)
+{
+      assert(dst+cnt <= size_);
+      assert(src+cnt <= that.size_);
+
+      unsigned long*dabits = size_ <= BITS_PER_WORD? &abits_val_ : abits_ptr_;
+      unsigned long*dbbits = size_ <= BITS_PER_WORD? &bbits_val_ : bbits_ptr_;
+      const unsigned long*sabits = that.size_ <= BITS_PER_WORD? &that.abits_val_ : that.abits_ptr_;
+      const unsigned long*sbbits = that.size_ <= BITS_PER_WORD? &that.bbits_val_ : that.bbits_ptr_;
+
+      unsigned sptr = src / BITS_PER_WORD;
+      unsigned dptr = dst / BITS_PER_WORD;
+      unsigned soff = src % BITS_PER_WORD;
+      unsigned doff = dst % BITS_PER_WORD;
+      bool diff_flag = false;
+
+      while (cnt > 0) {
+	    unsigned trans = cnt;
+	    if ((soff+trans) > BITS_PER_WORD)
+		  trans = BITS_PER_WORD - soff;
+	    if ((doff+trans) > BITS_PER_WORD)
+		  trans = BITS_PER_WORD - doff;
+
+	    unsigned long vmask = trans == BITS_PER_WORD? -1UL : (1UL << trans) - 1;
+	    unsigned long tmp;
+
+	    tmp = ((sabits[sptr] >> soff) & vmask) << doff;
+	    if ((dabits[dptr] & (vmask << doff)) != tmp) {
+		  diff_flag = true;
+		  dabits[dptr] = (dabits[dptr] & ~(vmask << doff)) | tmp;
+	    }
+	    tmp = ((sbbits[sptr] >> soff) & vmask) << doff;
+	    if ((dbbits[dptr] & (vmask << doff)) != tmp) {
+		  diff_flag = true;
+		  dbbits[dptr] = (dbbits[dptr] & ~(vmask << doff)) | tmp;
+	    }
+
+	    cnt -= trans;
+	    soff += trans;
+	    if (soff >= BITS_PER_WORD) {
+		  soff = 0;
+		  sptr += 1;
+	    }
+	    doff += trans;
+	    if (doff >= BITS_PER_WORD) {
+		  doff = 0;
+		  dptr += 1;
+	    }
+      }
+
+      return diff_flag;
+}
+
 /*
  * Add that vector to this vector. Do it in the Verilog way, which
  * means if we detect any X or Z bits, change the entire results to
@@ -1670,34 +2414,21 @@ void vvp_vector4_t::mul(const vvp_vector4_t&that)
 	    }
       }
 
-	// Calculate the result into a res array. We need to keep is
-	// separate from the "this" array because we are making
-	// multiple passes.
-      unsigned long*res = new unsigned long[cnt];
-      for (int idx = 0 ; idx < cnt ; idx += 1)
-	    res[idx] = 0;
-
-      for (int mul_a = 0 ; mul_a < cnt ; mul_a += 1) {
-	    unsigned long lval = abits_ptr_[mul_a];
-	    if (mul_a == (cnt-1))
-		  lval &= mask;
-
-	    for (int mul_b = 0 ; mul_b < (cnt-mul_a) ; mul_b += 1) {
-		  unsigned long rval = that.abits_ptr_[mul_b];
-		  if (mul_b == (cnt-1))
-			rval &= mask;
-
-		  unsigned long sum;
-		  unsigned long tmp = multiply_with_carry(lval, rval, sum);
-		  int base = mul_a + mul_b;
-		  unsigned long carry = 0;
-		  res[base] = add_with_carry(res[base], tmp, carry);
-		  for (int add_idx = base+1 ; add_idx < cnt ; add_idx += 1) {
-			res[add_idx] = add_with_carry(res[add_idx], sum, carry);
-			sum = 0;
-		  }
-	    }
+	// Calculate the result into a res array. It must be separate
+	// from the operands because the multiply makes multiple
+	// passes. The operands are copied so that the bits past the
+	// end of the vector can be masked away.
+      unsigned long*res = new unsigned long[3*cnt];
+      unsigned long*lval = res + cnt;
+      unsigned long*rval = res + 2*cnt;
+      for (int idx = 0 ; idx < cnt ; idx += 1) {
+	    lval[idx] = abits_ptr_[idx];
+	    rval[idx] = that.abits_ptr_[idx];
       }
+      lval[cnt-1] &= mask;
+      rval[cnt-1] &= mask;
+
+      multiply_words(res, lval, rval, cnt);
 
 	// Replace the "this" value with the calculated result. We
 	// know a-priori that the bbits are zero and unchanged.
@@ -1706,9 +2437,6 @@ void vvp_vector4_t::mul(const vvp_vector4_t&that)
 	    abits_ptr_[idx] = res[idx];
 
       delete[]res;
-      return;
-
-
 }
 
 bool vvp_vector4_t::eeq(const vvp_vector4_t&that) const
@@ -1822,6 +2550,24 @@ void vvp_vector4_t::change_z2x()
       }
 }
 
+void vvp_vector4_t::cast2()
+{
+	// The X and Z bits are the ones with the bbit set. Clearing
+	// the abit wherever the bbit is set, then clearing the bbits,
+	// makes them all BIT4_0 and leaves the 0 and 1 bits alone.
+
+      if (size_ <= BITS_PER_WORD) {
+	    abits_val_ &= ~bbits_val_;
+	    bbits_val_ = 0;
+      } else {
+	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+	    for (unsigned idx = 0 ;  idx < words ;  idx += 1) {
+		  abits_ptr_[idx] &= ~bbits_ptr_[idx];
+		  bbits_ptr_[idx] = 0;
+	    }
+      }
+}
+
 void vvp_vector4_t::set_to_x()
 {
       if (size_ <= BITS_PER_WORD) {
@@ -2248,6 +2994,84 @@ vvp_vector4_t vvp_vector4array_sa::get_word(unsigned index) const
       return get_word_(cell);
 }
 
+unsigned long vvp_vector4array_sp::threshold = 1024*1024;
+
+vvp_vector4array_sp::vvp_vector4array_sp(unsigned width__, unsigned words__)
+: vvp_vector4array_t(width__, words__)
+{
+      cnt_ = (width_ + vvp_vector4_t::BITS_PER_WORD-1)/vvp_vector4_t::BITS_PER_WORD;
+      npages_ = (words_ + PAGE_WORDS-1) / PAGE_WORDS;
+      pages_ = new unsigned long*[npages_];
+      for (unsigned idx = 0 ; idx < npages_ ; idx += 1)
+	    pages_[idx] = 0;
+}
+
+vvp_vector4array_sp::~vvp_vector4array_sp()
+{
+      for (unsigned idx = 0 ; idx < npages_ ; idx += 1)
+	    delete[]pages_[idx];
+      delete[]pages_;
+}
+
+void vvp_vector4array_sp::set_word(unsigned index, const vvp_vector4_t&that)
+{
+      assert(index < words_);
+      assert(that.size_ == width_);
+
+      unsigned long*&page = pages_[index >> PAGE_BITS];
+      if (page == 0) {
+	    unsigned plane = PAGE_WORDS * cnt_;
+	    page = new unsigned long[2*plane];
+	    for (unsigned idx = 0 ; idx < plane ; idx += 1) {
+		  page[idx] = vvp_vector4_t::WORD_X_ABITS;
+		  page[plane+idx] = vvp_vector4_t::WORD_X_BBITS;
+	    }
+      }
+
+      unsigned long*abits = page + (index & (PAGE_WORDS-1)) * cnt_;
+      unsigned long*bbits = abits + PAGE_WORDS * cnt_;
+
+      if (cnt_ == 1) {
+	    abits[0] = that.abits_val_;
+	    bbits[0] = that.bbits_val_;
+	    return;
+      }
+
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1)
+	    abits[idx] = that.abits_ptr_[idx];
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1)
+	    bbits[idx] = that.bbits_ptr_[idx];
+}
+
+vvp_vector4_t vvp_vector4array_sp::get_word(unsigned index) const
+{
+      if (index >= words_)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      const unsigned long*page = pages_[index >> PAGE_BITS];
+      if (page == 0)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      const unsigned long*abits = page + (index & (PAGE_WORDS-1)) * cnt_;
+      const unsigned long*bbits = abits + PAGE_WORDS * cnt_;
+
+      if (cnt_ == 1) {
+	    vvp_vector4_t res;
+	    res.size_ = width_;
+	    res.abits_val_ = abits[0];
+	    res.bbits_val_ = bbits[0];
+	    return res;
+      }
+
+      vvp_vector4_t res (width_, BIT4_X);
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1)
+	    res.abits_ptr_[idx] = abits[idx];
+      for (unsigned idx = 0 ; idx < cnt_ ; idx += 1)
+	    res.bbits_ptr_[idx] = bbits[idx];
+
+      return res;
+}
+
 vvp_vector4array_aa::vvp_vector4array_aa(unsigned width__, unsigned words__)
 : vvp_vector4array_t(width__, words__)
 {
@@ -2709,124 +3533,34 @@ vvp_vector2_t pow(const vvp_vector2_t&x, vvp_vector2_t&y)
       return res;
 }
 
-static void multiply_long(unsigned long a, unsigned long b,
-			  unsigned long&low, unsigned long&high)
-{
-      assert(sizeof(unsigned long) %2 == 0);
-
-      const unsigned long word_mask = (1UL << 4UL*sizeof(a)) - 1UL;
-      unsigned long tmpa;
-      unsigned long tmpb;
-      unsigned long res[4];
-
-      tmpa = a & word_mask;
-      tmpb = b & word_mask;
-      res[0] = tmpa * tmpb;
-      res[1] = res[0] >> 4UL*sizeof(unsigned long);
-      res[0] &= word_mask;
-
-      tmpa = (a >> 4UL*sizeof(unsigned long)) & word_mask;
-      tmpb = b & word_mask;
-      res[1] += tmpa * tmpb;
-      res[2] = res[1] >> 4UL*sizeof(unsigned long);
-      res[1] &= word_mask;
-
-      tmpa = a & word_mask;
-      tmpb = (b >> 4UL*sizeof(unsigned long)) & word_mask;
-      res[1] += tmpa * tmpb;
-      res[2] += res[1] >> 4UL*sizeof(unsigned long);
-      res[3]  = res[2] >> 4UL*sizeof(unsigned long);
-      res[1] &= word_mask;
-      res[2] &= word_mask;
-
-      tmpa = (a >> 4UL*sizeof(unsigned long)) & word_mask;
-      tmpb = (b >> 4UL*sizeof(unsigned long)) & word_mask;
-      res[2] += tmpa * tmpb;
-      res[3] += res[2] >> 4UL*sizeof(unsigned long);
-      res[2] &= word_mask;
-
-      high = (res[3] << 4UL*sizeof(unsigned long)) | res[2];
-      low  = (res[1] << 4UL*sizeof(unsigned long)) | res[0];
-}
-
 vvp_vector2_t operator * (const vvp_vector2_t&a, const vvp_vector2_t&b)
 {
-      const unsigned bits_per_word = 8 * sizeof(a.vec_[0]);
-
 	// The compiler ensures that the two operands are of equal size.
       assert(a.size() == b.size());
       vvp_vector2_t r (0, a.size());
+      if (r.wid_ == 0)
+	    return r;
 
-      unsigned words = (r.wid_ + bits_per_word - 1) / bits_per_word;
-
-      for (unsigned bdx = 0 ;  bdx < words ;  bdx += 1) {
-	    unsigned long tmpb = b.vec_[bdx];
-	    if (tmpb == 0)
-		  continue;
-
-	    for (unsigned adx = 0 ;  adx < words ;  adx += 1) {
-		  unsigned long tmpa = a.vec_[adx];
-		  if (tmpa == 0)
-			continue;
-
-		  unsigned long low, hig;
-		  multiply_long(tmpa, tmpb, low, hig);
+      unsigned words = (r.wid_ + vvp_vector2_t::BITS_PER_WORD - 1) /
+	    vvp_vector2_t::BITS_PER_WORD;
+      multiply_words(r.vec_, a.vec_, b.vec_, words);
 
-		  unsigned long carry = 0;
-		  for (unsigned sdx = 0
-			     ; (adx+bdx+sdx) < words
-			     ;  sdx += 1) {
-
-			r.vec_[adx+bdx+sdx] = add_carry(r.vec_[adx+bdx+sdx],
-							low, carry);
-			low = hig;
-			hig = 0;
-		  }
-	    }
-      }
+	// Cleanup the tail bits.
+      if (unsigned tail = r.wid_ % vvp_vector2_t::BITS_PER_WORD)
+	    r.vec_[words-1] &= -1UL >> (vvp_vector2_t::BITS_PER_WORD - tail);
 
       return r;
 }
 
-static void div_mod (vvp_vector2_t dividend, vvp_vector2_t divisor,
-		     vvp_vector2_t&quotient, vvp_vector2_t&remainder)
+static void div_mod (unsigned long*quotient, unsigned long*remainder,
+		     const unsigned long*dividend, const unsigned long*divisor,
+		     unsigned words)
 {
-
-      quotient = vvp_vector2_t(0, dividend.size());
-
-      if (divisor == quotient) {
+      if (words == 0 ||
+	  ! divide_words(quotient, remainder, dividend, divisor, words)) {
 	    cerr << "ERROR: division by zero, exiting." << endl;
 	    exit(255);
       }
-
-      if (dividend < divisor) {
-	    remainder = dividend;
-	    return;
-      }
-
-      vvp_vector2_t mask (1, dividend.size());
-
-	// Make the dividend 1 bit larger to prevent overflow of
-	// divtmp in startup.
-      dividend = vvp_vector2_t(dividend, dividend.size()+1);
-      vvp_vector2_t divtmp (divisor, dividend.size());
-
-      while (divtmp < dividend) {
-	    divtmp <<= 1;
-	    mask <<= 1;
-      }
-
-      while (dividend >= divisor) {
-	    if (divtmp <= dividend) {
-		  dividend -= divtmp;
-		  quotient += mask;
-	    }
-
-	    divtmp >>= 1;
-	    mask >>= 1;
-      }
-
-      remainder = vvp_vector2_t(dividend, mask.size());
 }
 
 vvp_vector2_t operator - (const vvp_vector2_t&that)
@@ -2844,20 +3578,30 @@ vvp_vector2_t operator - (const vvp_vector2_t&that)
       return neg;
 }
 
+/*
+ * The division works on copies of the operands padded to the same
+ * number of words. The result has the width of the dividend.
+ */
 vvp_vector2_t operator / (const vvp_vector2_t&dividend,
 			  const vvp_vector2_t&divisor)
 {
-      vvp_vector2_t quot, rem;
-      div_mod(dividend, divisor, quot, rem);
-      return quot;
+      unsigned wid = max(dividend.size(), divisor.size());
+      unsigned words = (wid + vvp_vector2_t::BITS_PER_WORD - 1) /
+	    vvp_vector2_t::BITS_PER_WORD;
+      vvp_vector2_t a (dividend, wid), b (divisor, wid), quot (0, wid);
+      div_mod(quot.vec_, 0, a.vec_, b.vec_, words);
+      return vvp_vector2_t(quot, dividend.size());
 }
 
 vvp_vector2_t operator % (const vvp_vector2_t&dividend,
 			  const vvp_vector2_t&divisor)
 {
-      vvp_vector2_t quot, rem;
-      div_mod(dividend, divisor, quot, rem);
-      return rem;
+      unsigned wid = max(dividend.size(), divisor.size());
+      unsigned words = (wid + vvp_vector2_t::BITS_PER_WORD - 1) /
+	    vvp_vector2_t::BITS_PER_WORD;
+      vvp_vector2_t a (dividend, wid), b (divisor, wid), rem (0, wid);
+      div_mod(0, rem.vec_, a.vec_, b.vec_, words);
+      return vvp_vector2_t(rem, dividend.size());
 }
 
 bool operator > (const vvp_vector2_t&a, const vvp_vector2_t&b)
@@ -28,6 +28,8 @@
 # include  <cstdlib>
 # include  <cstring>
 # include  <new>
+# include  <set>
+# include  <map>
 # include  <cassert>
 
 #ifdef HAVE_IOSFWD
@@ -231,6 +233,19 @@ static inline unsigned long add_with_carry(unsigned long a, unsigned long b,
 extern unsigned long multiply_with_carry(unsigned long a, unsigned long b,
 					 unsigned long&carry);
 
+/*
+ * These are the wide multiply and divide for arrays of long, least
+ * significant word first. multiply_words puts the low words of a*b
+ * into res, which must not overlap a or b. divide_words puts a/b into
+ * quot and a%b into rem (either may be nil), and returns false if b
+ * is zero. The outputs may overlap the inputs.
+ */
+extern void multiply_words(unsigned long*res, const unsigned long*a,
+			   const unsigned long*b, unsigned words);
+extern bool divide_words(unsigned long*quot, unsigned long*rem,
+			 const unsigned long*a, const unsigned long*b,
+			 unsigned words);
+
 /*
  * This class represents scalar values collected into vectors. The
  * vector values can be accessed individually, or treated as a
@@ -245,6 +260,7 @@ class vvp_vector4_t {
       friend vvp_vector4_t operator ~(const vvp_vector4_t&that);
       friend class vvp_vector4array_t;
       friend class vvp_vector4array_sa;
+      friend class vvp_vector4array_sp;
       friend class vvp_vector4array_aa;
 
     public:
@@ -269,6 +285,11 @@ class vvp_vector4_t {
 
       ~vvp_vector4_t();
 
+	// Exchange the contents of this vector with that. This does
+	// not copy or allocate any bit storage, so it is the cheap
+	// way to move a value into a vector that will be reused.
+      void swap(vvp_vector4_t&that);
+
       inline unsigned size() const { return size_; }
       void resize(unsigned new_size, vvp_bit4_t pad_bit = BIT4_X);
 
@@ -281,11 +302,31 @@ class vvp_vector4_t {
 	// in the array.
       unsigned long*subarray(unsigned idx, unsigned size, bool xz_to_0 =false) const;
       void setarray(unsigned idx, unsigned size, const unsigned long*val);
+	// Get all the bits in the vpiVectorVal encoding, which is the
+	// same as the abits/bbits encoding here. The dst array must
+	// have room for (size()+31)/32 words.
+      void get_vecval(s_vpi_vecval*dst) const;
+	// Set all the bits from the vpiVectorVal encoding. The src
+	// array holds (size()+31)/32 words, and the bits in the last
+	// word past the end of the vector are ignored.
+      void set_vecval(const s_vpi_vecval*src);
+	// Get all the bits as 2-value bits, BITS_PER_WORD bits to a
+	// word, with X and Z bits becoming 0. The dst array must have
+	// room for all the bits, and the bits past the end of the
+	// vector are written as 0. Return true if any of the dst
+	// words were changed.
+      bool update_bits2(unsigned long*dst) const;
+	// Set all the bits from 2-value bits packed as above.
+      void set_bits2(const unsigned long*src);
 
 	// Set a 4-value bit or subvector into the vector. Return true
 	// if any bits of the vector change as a result of this operation.
       void set_bit(unsigned idx, vvp_bit4_t val);
       bool set_vec(unsigned idx, const vvp_vector4_t&that);
+	// Set the cnt bits of that starting at src into this vector
+	// starting at dst. Return true if any bits change.
+      bool set_vec(unsigned dst, const vvp_vector4_t&that,
+		   unsigned src, unsigned cnt);
 
         // Get the bits from another vector, but keep my size.
       void copy_bits(const vvp_vector4_t&that);
@@ -314,6 +355,9 @@ class vvp_vector4_t {
 	// Change all Z bits to X bits.
       void change_z2x();
 
+	// Change all X and Z bits to 0 bits, as for a 2-value cast.
+      void cast2();
+
 	// Change all bits to X bits.
       void set_to_x();
 
@@ -423,14 +467,66 @@ inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
       if (this == &that)
 	    return *this;
 
-      if (size_ > BITS_PER_WORD)
+      if (size_ > BITS_PER_WORD) {
+	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+	      // If the new value needs the same number of words as
+	      // the array I already have, then reuse my array instead
+	      // of going through the heap. This is the common case
+	      // for values that are repeatedly assigned, i.e. the
+	      // thread stack slots.
+	    if (that.size_ > BITS_PER_WORD
+		&& words == (that.size_+BITS_PER_WORD-1) / BITS_PER_WORD) {
+		  size_ = that.size_;
+		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+			abits_ptr_[idx] = that.abits_ptr_[idx];
+		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+			bbits_ptr_[idx] = that.bbits_ptr_[idx];
+		  return *this;
+	    }
 	    delete[] abits_ptr_;
+      }
 
       copy_from_(that);
 
       return *this;
 }
 
+inline void vvp_vector4_t::swap(vvp_vector4_t&that)
+{
+	// The abits/bbits members are unions of a value and a
+	// pointer, and these are not necessarily the same size, so
+	// move the member that is actually in use for each side.
+      unsigned long*tmp_aptr = 0, *tmp_bptr = 0;
+      unsigned long tmp_aval = 0, tmp_bval = 0;
+      if (size_ > BITS_PER_WORD) {
+	    tmp_aptr = abits_ptr_;
+	    tmp_bptr = bbits_ptr_;
+      } else {
+	    tmp_aval = abits_val_;
+	    tmp_bval = bbits_val_;
+      }
+
+      if (that.size_ > BITS_PER_WORD) {
+	    abits_ptr_ = that.abits_ptr_;
+	    bbits_ptr_ = that.bbits_ptr_;
+      } else {
+	    abits_val_ = that.abits_val_;
+	    bbits_val_ = that.bbits_val_;
+      }
+
+      if (size_ > BITS_PER_WORD) {
+	    that.abits_ptr_ = tmp_aptr;
+	    that.bbits_ptr_ = tmp_bptr;
+      } else {
+	    that.abits_val_ = tmp_aval;
+	    that.bbits_val_ = tmp_bval;
+      }
+
+      unsigned tmp_size = size_;
+      size_ = that.size_;
+      that.size_ = tmp_size;
+}
+
 inline void vvp_vector4_t::copy_from_(const vvp_vector4_t&that)
 {
       size_ = that.size_;
@@ -620,6 +716,35 @@ class vvp_vector4array_sa : public vvp_vector4array_t {
       v4cell* array_;
 };
 
+/*
+ * Sparse statically allocated vvp_vector4array_t. This is for very
+ * large memories, where most of the words may never be written. The
+ * words are kept in fixed size pages that are only allocated when a
+ * word in the page is first written. Words in pages that are not
+ * allocated read as X. Each page holds the abits of all its words
+ * followed by the bbits of all its words, in a single allocation.
+ */
+class vvp_vector4array_sp : public vvp_vector4array_t {
+
+    public:
+      vvp_vector4array_sp(unsigned width, unsigned words);
+      ~vvp_vector4array_sp();
+
+      vvp_vector4_t get_word(unsigned idx) const;
+      void set_word(unsigned idx, const vvp_vector4_t&that);
+
+	// Arrays with at least this many words are made sparse.
+      static unsigned long threshold;
+
+    private:
+      enum { PAGE_BITS = 10, PAGE_WORDS = 1 << PAGE_BITS };
+	// The number of unsigned longs in each of the bit planes of
+	// a single word.
+      unsigned cnt_;
+      unsigned npages_;
+      unsigned long**pages_;
+};
+
 /*
  * Automatically allocated vvp_vector4array_t
  */
@@ -651,6 +776,10 @@ class vvp_vector2_t {
 				       const vvp_vector2_t&);
       friend vvp_vector2_t operator * (const vvp_vector2_t&,
 				       const vvp_vector2_t&);
+      friend vvp_vector2_t operator / (const vvp_vector2_t&,
+				       const vvp_vector2_t&);
+      friend vvp_vector2_t operator % (const vvp_vector2_t&,
+				       const vvp_vector2_t&);
       friend bool operator >  (const vvp_vector2_t&, const vvp_vector2_t&);
       friend bool operator >= (const vvp_vector2_t&, const vvp_vector2_t&);
       friend bool operator <  (const vvp_vector2_t&, const vvp_vector2_t&);
@@ -1153,6 +1282,8 @@ class vvp_net_t {
 
     private:
       vvp_net_ptr_t out_;
+      friend void vvp_net_flatten(const std::set<vvp_net_t*>&pinned,
+				  const std::map<vvp_net_t*,unsigned>&const_ports);
 
     public: // Need a better new for these objects.
       static void* operator new(std::size_t size);
@@ -1162,6 +1293,18 @@ class vvp_net_t {
       static void operator delete[](void*);
 };
 
+/*
+ * Collapse chains of single fan-out part select, concatenation,
+ * repeat, sign extension and bufz nodes into vvp_fun_permute
+ * nodes. The pinned nets are referenced by something other than the
+ * netlist links (thread code, VPI or user functions) and must be left
+ * alone. The const_ports map gives, for each net, the mask of ports
+ * that receive compiled in constants. The number of nodes eliminated
+ * is left in the statistics.
+ */
+extern void vvp_net_flatten(const std::set<vvp_net_t*>&pinned,
+			    const std::map<vvp_net_t*,unsigned>&const_ports);
+
 /*
  * Instances of this class represent the functionality of a
  * node. vvp_net_t objects hold pointers to the vvp_net_fun_t
@@ -1372,6 +1515,8 @@ class vvp_fun_concat  : public vvp_net_fun_t {
 		     unsigned w2, unsigned w3);
       ~vvp_fun_concat();
 
+      unsigned port_width(unsigned idx) const { return wid_[idx]; }
+
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
 
@@ -1438,6 +1583,9 @@ class vvp_fun_repeat  : public vvp_net_fun_t {
       vvp_fun_repeat(unsigned width, unsigned repeat);
       ~vvp_fun_repeat();
 
+      unsigned width() const { return wid_; }
+      unsigned repeat() const { return rep_; }
+
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
 
@@ -1484,6 +1632,8 @@ class vvp_fun_extend_signed  : public vvp_net_fun_t {
       explicit vvp_fun_extend_signed(unsigned wid);
       ~vvp_fun_extend_signed();
 
+      unsigned width() const { return width_; }
+
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
 
@@ -1573,14 +1723,36 @@ class vvp_wide_fun_t : public vvp_net_fun_t {
       unsigned port_base_;
 };
 
+/*
+ * When profiling (the -P flag) the net propagation functions count
+ * the values received by each type of functor. See profile.cc. This
+ * is in the hottest path of the run time, so the count is only
+ * compiled in if configured with --enable-profile.
+ */
+#ifdef PROFILE_FUNCTORS
+extern bool profile_flag;
+extern void profile_recv_vec4(const vvp_net_fun_t*fun);
+#endif
+
+inline void vvp_profile_recv(const vvp_net_fun_t*fun)
+{
+#ifdef PROFILE_FUNCTORS
+      if (profile_flag)
+	    profile_recv_vec4(fun);
+#else
+      (void)fun;
+#endif
+}
 
 inline void vvp_send_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&val, vvp_context_t context)
 {
       while (class vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  vvp_profile_recv(cur->fun);
 		  cur->fun->recv_vec4(ptr, val, context);
+	    }
 
 	    ptr = next;
       }
@@ -1643,8 +1815,10 @@ inline void vvp_send_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&val,
       while (class vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  vvp_profile_recv(cur->fun);
 		  cur->fun->recv_vec4_pv(ptr, val, base, wid, vwid, context);
+	    }
 
 	    ptr = next;
       }
@@ -117,6 +117,11 @@ double vvp_signal_value::real_value() const
       return 0;
 }
 
+const vvp_vector4_t* vvp_signal_value::vec4_value_ref() const
+{
+      return 0;
+}
+
 void vvp_net_t::force_vec4(const vvp_vector4_t&val, vvp_vector2_t mask)
 {
       assert(fil);
@@ -332,6 +337,122 @@ const vvp_vector4_t& vvp_fun_signal4_sa::vec4_unfiltered_value() const
       return bits4_;
 }
 
+vvp_fun_signal2_sa::vvp_fun_signal2_sa(vvp_wire_vec2*wire)
+: wire_(wire)
+{
+}
+
+/*
+ * The filter keeps the value, and stops the propagation if the value
+ * does not change, so all this needs to do is make the value 2-state
+ * and send it on to the filter. Only the continuous assign needs the
+ * current value, to merge in the bits that are not assigned.
+ */
+void vvp_fun_signal2_sa::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                                   vvp_context_t)
+{
+      switch (ptr.port()) {
+	  case 0: // Normal input (feed from net, or set from process)
+	    if (assign_mask_.size() == 0) {
+		  assert(bit.size() == wire_->value_size());
+		  if (bit.has_xz()) {
+			vvp_vector4_t tmp (bit);
+			tmp.cast2();
+			ptr.ptr()->send_vec4(tmp, 0);
+		  } else {
+			ptr.ptr()->send_vec4(bit, 0);
+		  }
+	    } else {
+		  bool changed = false;
+		  vvp_vector4_t tmp;
+		  wire_->driven_vec4_value(tmp);
+		  assert(tmp.size() == assign_mask_.size());
+		  for (unsigned idx = 0 ;  idx < bit.size() ;  idx += 1) {
+			if (idx >= tmp.size()) break;
+			if (assign_mask_.value(idx)) continue;
+			tmp.set_bit(idx, bit.value(idx)==BIT4_1? BIT4_1 : BIT4_0);
+			changed = true;
+		  }
+		  if (changed)
+			ptr.ptr()->send_vec4(tmp, 0);
+	    }
+	    break;
+
+	  case 1: { // Continuous assign value
+	    vvp_vector4_t tmp = coerce_to_width(bit, wire_->value_size());
+	    tmp.cast2();
+	    assign_mask_ = vvp_vector2_t(vvp_vector2_t::FILL1, tmp.size());
+	    ptr.ptr()->send_vec4(tmp, 0);
+	    break;
+	  }
+
+	  default:
+	    fprintf(stderr, "Unsupported port type %u.\n", ptr.port());
+	    assert(0);
+	    break;
+      }
+}
+
+void vvp_fun_signal2_sa::recv_vec8(vvp_net_ptr_t ptr, const vvp_vector8_t&bit)
+{
+      recv_vec4(ptr, reduce4(bit), 0);
+}
+
+void vvp_fun_signal2_sa::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+				      unsigned base, unsigned wid, unsigned vwid,
+                                      vvp_context_t)
+{
+      assert(bit.size() == wid);
+      assert(wire_->value_size() == vwid);
+
+      vvp_vector4_t tmp;
+      wire_->driven_vec4_value(tmp);
+
+      switch (ptr.port()) {
+	  case 0: { // Normal input
+	    bool changed = false;
+	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
+		  if (base+idx >= tmp.size()) break;
+		  if (assign_mask_.size() && assign_mask_.value(base+idx))
+			continue;
+		  tmp.set_bit(base+idx, bit.value(idx)==BIT4_1? BIT4_1 : BIT4_0);
+		  changed = true;
+	    }
+	    if (changed || assign_mask_.size() == 0)
+		  ptr.ptr()->send_vec4(tmp, 0);
+	    break;
+	  }
+
+	  case 1: // Continuous assign value
+	    if (assign_mask_.size() == 0)
+		  assign_mask_ = vvp_vector2_t(vvp_vector2_t::FILL0, tmp.size());
+	    for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
+		  if (base+idx >= tmp.size())
+			break;
+		  tmp.set_bit(base+idx, bit.value(idx)==BIT4_1? BIT4_1 : BIT4_0);
+		  assign_mask_.set_bit(base+idx, 1);
+	    }
+	    ptr.ptr()->send_vec4(tmp, 0);
+	    break;
+
+	  default:
+	    fprintf(stderr, "Unsupported port type %u.\n", ptr.port());
+	    assert(0);
+	    break;
+      }
+}
+
+void vvp_fun_signal2_sa::recv_vec8_pv(vvp_net_ptr_t ptr, const vvp_vector8_t&bit,
+				      unsigned base, unsigned wid, unsigned vwid)
+{
+      recv_vec4_pv(ptr, reduce4(bit), base, wid, vwid, 0);
+}
+
+void vvp_fun_signal2_sa::vec4_unfiltered_value(vvp_vector4_t&val) const
+{
+      wire_->driven_vec4_value(val);
+}
+
 vvp_fun_signal4_aa::vvp_fun_signal4_aa(unsigned wid, vvp_bit4_t init)
 {
 	/* To make init work we would need to save it and then use the
@@ -436,6 +557,11 @@ void vvp_fun_signal4_aa::vec4_value(vvp_vector4_t&val) const
       val = *bits4;
 }
 
+const vvp_vector4_t* vvp_fun_signal4_aa::vec4_value_ref() const
+{
+      return &vec4_unfiltered_value();
+}
+
 const vvp_vector4_t&vvp_fun_signal4_aa::vec4_unfiltered_value() const
 {
       vvp_vector4_t*bits4 = static_cast<vvp_vector4_t*>
@@ -1044,6 +1170,18 @@ void vvp_wire_vec4::vec4_value(vvp_vector4_t&val) const
 	    val.set_bit(idx, filtered_value_(idx));
 }
 
+/*
+ * The tracked driven value is the value of the wire, unless some of
+ * the bits are forced.
+ */
+const vvp_vector4_t* vvp_wire_vec4::vec4_value_ref() const
+{
+      if (test_force_mask_is_zero())
+	    return &bits4_;
+      else
+	    return 0;
+}
+
 vvp_bit4_t vvp_wire_vec4::driven_value(unsigned idx) const
 {
       return bits4_.value(idx);
@@ -1054,6 +1192,205 @@ bool vvp_wire_vec4::is_forced(unsigned idx) const
       return test_force_mask(idx);
 }
 
+vvp_wire_vec2::vvp_wire_vec2(unsigned wid)
+: wid_(wid)
+{
+      needs_init_ = true;
+      if (wid_ <= BITS_PER_WORD) {
+	    bits_val_ = 0;
+      } else {
+	    unsigned words = (wid_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	    bits_ptr_ = new unsigned long[words];
+	    for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+		  bits_ptr_[idx] = 0;
+      }
+}
+
+vvp_wire_vec2::~vvp_wire_vec2()
+{
+      if (wid_ > BITS_PER_WORD)
+	    delete[]bits_ptr_;
+}
+
+bool vvp_wire_vec2::set_driven_bit_(unsigned idx, vvp_bit4_t val)
+{
+      unsigned long mask = 1UL << (idx%BITS_PER_WORD);
+      unsigned long&word = bits_()[idx/BITS_PER_WORD];
+      unsigned long old = word;
+      if (val == BIT4_1)
+	    word |= mask;
+      else
+	    word &= ~mask;
+      return word != old;
+}
+
+vvp_net_fil_t::prop_t vvp_wire_vec2::filter_vec4(const vvp_vector4_t&bit, vvp_vector4_t&rep,
+						 unsigned base, unsigned vwid)
+{
+      assert(wid_ == vwid);
+
+	// Keep track of the value being driven from this net, even if
+	// it is not ultimately what survives the force filter.
+      if (base==0 && bit.size()==vwid) {
+	    if (! bit.update_bits2(bits_()) && !needs_init_) return STOP;
+      } else {
+	    bool rc = false;
+	    for (unsigned idx = 0 ;  idx < bit.size() ;  idx += 1) {
+		  if (base+idx >= wid_) break;
+		  if (set_driven_bit_(base+idx, bit.value(idx)))
+			rc = true;
+	    }
+	    if (rc == false && !needs_init_) return STOP;
+      }
+
+      needs_init_ = false;
+      if (test_force_mask_is_zero()) {
+	    run_vpi_callbacks();
+	    return PROP;
+      }
+
+      return filter_mask_(bit, vector2_to_vector4(force2_, wid_), rep, base);
+}
+
+vvp_net_fil_t::prop_t vvp_wire_vec2::filter_vec8(const vvp_vector8_t&bit,
+                                                 vvp_vector8_t&rep,
+                                                 unsigned base,
+                                                 unsigned vwid)
+{
+      vvp_vector4_t rep4;
+      prop_t rc = filter_vec4(reduce4(bit), rep4, base, vwid);
+      if (rc == REPL)
+	    rep = vvp_vector8_t(rep4, 6, 6);
+      return rc;
+}
+
+unsigned vvp_wire_vec2::filter_size() const
+{
+      return wid_;
+}
+
+void vvp_wire_vec2::force_fil_vec4(const vvp_vector4_t&val, vvp_vector2_t mask)
+{
+      force_mask(mask);
+
+      if (force2_.size() == 0) {
+	    force2_ = val;
+      } else {
+	    for (unsigned idx = 0; idx < mask.size() ; idx += 1) {
+		  if (mask.value(idx) == 0)
+			continue;
+
+		  force2_.set_bit(idx, val.value(idx)==BIT4_1? 1 : 0);
+	    }
+      }
+      run_vpi_callbacks();
+}
+
+void vvp_wire_vec2::force_fil_vec8(const vvp_vector8_t&, vvp_vector2_t)
+{
+      assert(0);
+}
+
+void vvp_wire_vec2::force_fil_real(double, vvp_vector2_t)
+{
+      assert(0);
+}
+
+void vvp_wire_vec2::release(vvp_net_ptr_t ptr, bool net_flag)
+{
+      vvp_vector2_t mask (vvp_vector2_t::FILL1, wid_);
+      if (net_flag) {
+	      // Wires revert to their unforced value after release.
+	    vvp_vector4_t bits4;
+	    driven_vec4_value(bits4);
+            release_mask(mask);
+	    needs_init_ = ! vector2_to_vector4(force2_, wid_) .eeq(bits4);
+	    ptr.ptr()->send_vec4(bits4, 0);
+	    run_vpi_callbacks();
+      } else {
+	      // Variables keep the current value.
+	    vvp_vector4_t res;
+	    vec4_value(res);
+            release_mask(mask);
+	    ptr.ptr()->fun->recv_vec4(ptr, res, 0);
+      }
+}
+
+void vvp_wire_vec2::release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag)
+{
+      assert(wid_ >= base + wid);
+
+      vvp_vector2_t mask (vvp_vector2_t::FILL0, wid_);
+      for (unsigned idx = 0 ; idx < wid ; idx += 1)
+	    mask.set_bit(base+idx, 1);
+
+      if (net_flag) {
+	      // Wires revert to their unforced value after release.
+	    vvp_vector4_t bits4;
+	    driven_vec4_value(bits4);
+	    release_mask(mask);
+	    needs_init_ = ! vector2_to_vector4(force2_, wid_).subvalue(base,wid)
+		  .eeq(bits4.subvalue(base,wid));
+	    ptr.ptr()->send_vec4_pv(bits4.subvalue(base,wid),
+				    base, wid, wid_, 0);
+	    run_vpi_callbacks();
+      } else {
+	      // Variables keep the current value.
+	    vvp_vector4_t res (wid);
+	    for (unsigned idx=0; idx<wid; idx += 1)
+		  res.set_bit(idx,value(base+idx));
+	    release_mask(mask);
+	    ptr.ptr()->fun->recv_vec4_pv(ptr, res, base, wid, wid_, 0);
+      }
+}
+
+unsigned vvp_wire_vec2::value_size() const
+{
+      return wid_;
+}
+
+vvp_bit4_t vvp_wire_vec2::value(unsigned idx) const
+{
+      if (test_force_mask(idx))
+	    return force2_.value4(idx);
+      else
+	    return driven_value(idx);
+}
+
+vvp_scalar_t vvp_wire_vec2::scalar_value(unsigned idx) const
+{
+      return vvp_scalar_t(value(idx),6,6);
+}
+
+void vvp_wire_vec2::vec4_value(vvp_vector4_t&val) const
+{
+      driven_vec4_value(val);
+      if (test_force_mask_is_zero())
+	    return;
+
+      for (unsigned idx = 0 ; idx < wid_ ; idx += 1) {
+	    if (test_force_mask(idx))
+		  val.set_bit(idx, force2_.value4(idx));
+      }
+}
+
+void vvp_wire_vec2::driven_vec4_value(vvp_vector4_t&val) const
+{
+      if (val.size() != wid_)
+	    val = vvp_vector4_t(wid_, BIT4_0);
+      val.set_bits2(bits_());
+}
+
+vvp_bit4_t vvp_wire_vec2::driven_value(unsigned idx) const
+{
+      return driven_bit_(idx)? BIT4_1 : BIT4_0;
+}
+
+bool vvp_wire_vec2::is_forced(unsigned idx) const
+{
+      return test_force_mask(idx);
+}
+
 vvp_wire_vec8::vvp_wire_vec8(unsigned wid)
 : bits8_(wid)
 {
@@ -103,6 +103,12 @@ class vvp_signal_value {
       virtual vvp_scalar_t scalar_value(unsigned idx) const =0;
       virtual void vec4_value(vvp_vector4_t&) const =0;
       virtual double real_value() const;
+	// If the signal holds its value in a vvp_vector4_t that can
+	// be handed out as is, return a pointer to it. Otherwise,
+	// return nil and the caller must use vec4_value to get a
+	// copy. This lets the VPI formatters read the bits without
+	// copying or looking at them one at a time.
+      virtual const vvp_vector4_t* vec4_value_ref() const;
 
       virtual void get_signal_value(struct t_vpi_value*vp);
 };
@@ -157,6 +163,37 @@ class vvp_fun_signal4_sa : public vvp_fun_signal_vec {
       vvp_vector4_t bits4_;
 };
 
+/*
+ * Statically allocated 2-state variables (bit, byte, int and so on)
+ * use this functor with a vvp_wire_vec2 filter. The filter keeps the
+ * value of the variable, so unlike vvp_fun_signal4_sa, this functor
+ * has no copy of its own. It changes any X or Z bits that are written
+ * to the variable into 0 bits, so that everything downstream only
+ * ever sees 0 and 1 bits.
+ */
+class vvp_fun_signal2_sa : public vvp_fun_signal_base {
+
+    public:
+      explicit vvp_fun_signal2_sa(class vvp_wire_vec2*wire);
+
+      void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+                     vvp_context_t);
+      void recv_vec8(vvp_net_ptr_t port, const vvp_vector8_t&bit);
+
+	// Part select variants of above
+      void recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+			unsigned base, unsigned wid, unsigned vwid,
+                        vvp_context_t);
+      void recv_vec8_pv(vvp_net_ptr_t port, const vvp_vector8_t&bit,
+			unsigned base, unsigned wid, unsigned vwid);
+
+	// Get the value of the variable, ignoring any force.
+      void vec4_unfiltered_value(vvp_vector4_t&val) const;
+
+    private:
+      class vvp_wire_vec2*wire_;
+};
+
 /*
  * Automatically allocated vvp_fun_signal4.
  */
@@ -185,6 +222,7 @@ class vvp_fun_signal4_aa : public vvp_fun_signal_vec, public automatic_signal_ba
       vvp_bit4_t value(unsigned idx) const;
       vvp_scalar_t scalar_value(unsigned idx) const;
       void vec4_value(vvp_vector4_t&) const;
+      const vvp_vector4_t* vec4_value_ref() const;
       const vvp_vector4_t& vec4_unfiltered_value() const;
 
     public: // These objects are only permallocated.
@@ -446,6 +484,7 @@ class vvp_wire_vec4 : public vvp_wire_base {
       vvp_bit4_t value(unsigned idx) const;
       vvp_scalar_t scalar_value(unsigned idx) const;
       void vec4_value(vvp_vector4_t&) const;
+      const vvp_vector4_t* vec4_value_ref() const;
 
         // Support for $countdrivers
       vvp_bit4_t driven_value(unsigned idx) const;
@@ -460,6 +499,68 @@ class vvp_wire_vec4 : public vvp_wire_base {
       vvp_vector4_t force4_; // the value being forced
 };
 
+/*
+ * This is the filter for 2-state variables. It keeps the value as
+ * 2-value bits packed into words, which is half the size of a
+ * vvp_vector4_t, and vectors of up to a word are kept in place.
+ */
+class vvp_wire_vec2 : public vvp_wire_base {
+
+    public:
+      explicit vvp_wire_vec2(unsigned wid);
+      ~vvp_wire_vec2();
+
+      prop_t filter_vec4(const vvp_vector4_t&bit, vvp_vector4_t&rep,
+			 unsigned base, unsigned vwid);
+      prop_t filter_vec8(const vvp_vector8_t&val, vvp_vector8_t&rep,
+			 unsigned base, unsigned vwid);
+
+	// Abstract methods from vvp_vpi_callback
+      void get_value(struct t_vpi_value*value);
+	// Abstract methods from vvp_net_fit_t
+      unsigned filter_size() const;
+      void force_fil_vec4(const vvp_vector4_t&val, vvp_vector2_t mask);
+      void force_fil_vec8(const vvp_vector8_t&val, vvp_vector2_t mask);
+      void force_fil_real(double val, vvp_vector2_t mask);
+      void release(vvp_net_ptr_t ptr, bool net_flag);
+      void release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag);
+
+	// Implementation of vvp_signal_value methods
+      unsigned value_size() const;
+      vvp_bit4_t value(unsigned idx) const;
+      vvp_scalar_t scalar_value(unsigned idx) const;
+      void vec4_value(vvp_vector4_t&) const;
+
+	// Get the driven value, without the force filter applied.
+      void driven_vec4_value(vvp_vector4_t&val) const;
+
+        // Support for $countdrivers
+      vvp_bit4_t driven_value(unsigned idx) const;
+      bool is_forced(unsigned idx) const;
+
+    private:
+      enum { BITS_PER_WORD = 8 * sizeof(unsigned long) };
+      unsigned long*bits_()
+      { return wid_ <= BITS_PER_WORD? &bits_val_ : bits_ptr_; }
+      const unsigned long*bits_() const
+      { return wid_ <= BITS_PER_WORD? &bits_val_ : bits_ptr_; }
+      bool driven_bit_(unsigned idx) const
+      { return (bits_()[idx/BITS_PER_WORD] >> (idx%BITS_PER_WORD)) & 1; }
+      bool set_driven_bit_(unsigned idx, vvp_bit4_t val);
+
+    private:
+      vvp_wire_vec2(const vvp_wire_vec2&);
+      vvp_wire_vec2& operator= (const vvp_wire_vec2&);
+
+      bool needs_init_;
+      unsigned wid_;
+      union {
+	    unsigned long bits_val_;
+	    unsigned long*bits_ptr_;
+      };
+      vvp_vector2_t force2_; // the value being forced
+};
+
 class vvp_wire_vec8 : public vvp_wire_base {
 
     public:
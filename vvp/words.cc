@@ -187,8 +187,11 @@ void compile_variable(char*label, char*name,
 	    net->fil = tmp;
             net->fun = tmp;
       } else if (vpi_type_code == vpiIntVar) {
-	    net->fil = new vvp_wire_vec4(wid, BIT4_0);
-            net->fun = new vvp_fun_signal4_sa(wid);
+	      // 2-state variables keep only the one 2-state copy of
+	      // the value, in the filter.
+	    vvp_wire_vec2*tmp = new vvp_wire_vec2(wid);
+	    net->fil = tmp;
+            net->fun = new vvp_fun_signal2_sa(tmp);
       } else {
 	    net->fil = new vvp_wire_vec4(wid, BIT4_X);
             net->fun = new vvp_fun_signal4_sa(wid);